@@ -14,6 +14,7 @@
 #include "blackwidow/blackwidow.h"
 
 #include "include/pika_command.h"
+#include "include/pika_histogram.h"
 
 /*
  * Admin
@@ -220,18 +221,21 @@ class InfoCmd : public Cmd {
     kInfoClients,
     kInfoStats,
     kInfoExecCount,
+    kInfoCommandStats,
     kInfoCPU,
     kInfoReplication,
     kInfoKeyspace,
     kInfoLog,
     kInfoData,
+    kInfoHotKeys,
+    kInfoLatencyStats,
     kInfo,
     kInfoAll,
     kInfoDebug
   };
 
   InfoCmd(const std::string& name, int arity, uint16_t flag)
-      : Cmd(name, arity, flag), rescan_(false), off_(false) {}
+      : Cmd(name, arity, flag), rescan_(false), off_(false), approximate_(false) {}
   virtual void Do(std::shared_ptr<Partition> partition = nullptr);
   virtual Cmd* Clone() override {
     return new InfoCmd(*this);
@@ -241,6 +245,7 @@ class InfoCmd : public Cmd {
   InfoSection info_section_;
   bool rescan_; //whether to rescan the keyspace
   bool off_;
+  bool approximate_; // estimate the keyspace from sst properties
   std::set<std::string> keyspace_scan_tables_;
 
   const static std::string kInfoSection;
@@ -249,16 +254,20 @@ class InfoCmd : public Cmd {
   const static std::string kClientsSection;
   const static std::string kStatsSection;
   const static std::string kExecCountSection;
+  const static std::string kCommandStatsSection;
   const static std::string kCPUSection;
   const static std::string kReplicationSection;
   const static std::string kKeyspaceSection;
   const static std::string kDataSection;
   const static std::string kDebugSection;
+  const static std::string kHotKeysSection;
+  const static std::string kLatencyStatsSection;
 
   virtual void DoInitial() override;
   virtual void Clear() {
     rescan_ = false;
     off_ = false;
+    approximate_ = false;
     keyspace_scan_tables_.clear();
   }
 
@@ -266,12 +275,15 @@ class InfoCmd : public Cmd {
   void InfoClients(std::string& info);
   void InfoStats(std::string& info);
   void InfoExecCount(std::string& info);
+  void InfoCommandStats(std::string& info);
   void InfoCPU(std::string& info);
   void InfoShardingReplication(std::string& info);
   void InfoReplication(std::string& info);
   void InfoKeyspace(std::string& info);
   void InfoData(std::string& info);
   void InfoDebug(std::string& info);
+  void InfoHotKeys(std::string& info);
+  void InfoLatencyStats(std::string& info);
 };
 
 class ShutdownCmd : public Cmd {
@@ -407,6 +419,51 @@ class SlowlogCmd : public Cmd {
   }
 };
 
+class HotKeysCmd : public Cmd {
+ public:
+  enum HotKeysCondition{kGET, kRESET};
+  HotKeysCmd(const std::string& name, int arity, uint16_t flag)
+      : Cmd(name, arity, flag), condition_(kGET) {}
+  virtual void Do(std::shared_ptr<Partition> partition = nullptr);
+  virtual Cmd* Clone() override {
+    return new HotKeysCmd(*this);
+  }
+ private:
+  int64_t number_;
+  bool with_read_;
+  bool with_write_;
+  std::string table_name_filter_;
+  HotKeysCmd::HotKeysCondition condition_;
+  virtual void DoInitial() override;
+  virtual void Clear() {
+    number_ = 10;
+    with_read_ = true;
+    with_write_ = true;
+    table_name_filter_.clear();
+    condition_ = kGET;
+  }
+};
+
+class LatencyCmd : public Cmd {
+ public:
+  enum LatencyCondition{kHISTOGRAM, kSTAGES, kRESET};
+  LatencyCmd(const std::string& name, int arity, uint16_t flag)
+      : Cmd(name, arity, flag), condition_(kHISTOGRAM) {}
+  virtual void Do(std::shared_ptr<Partition> partition = nullptr);
+  virtual Cmd* Clone() override {
+    return new LatencyCmd(*this);
+  }
+ private:
+  std::set<std::string> cmd_names_;
+  LatencyCmd::LatencyCondition condition_;
+  virtual void DoInitial() override;
+  virtual void Clear() {
+    cmd_names_.clear();
+    condition_ = kHISTOGRAM;
+  }
+  void AppendSummary(const std::string& name, const LatencySummary& summary);
+};
+
 class PaddingCmd : public Cmd {
  public:
   PaddingCmd(const std::string& name, int arity, uint16_t flag)
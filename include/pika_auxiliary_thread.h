@@ -6,6 +6,8 @@
 #ifndef PIKA_AUXILIARY_THREAD_H_
 #define PIKA_AUXILIARY_THREAD_H_
 
+#include <atomic>
+
 #include "pink/include/pink_thread.h"
 
 #include "slash/include/slash_mutex.h"
@@ -14,12 +16,21 @@ class PikaAuxiliaryThread : public pink::Thread {
  public:
   PikaAuxiliaryThread() :
       mu_(),
-      cv_(&mu_) {}
+      cv_(&mu_),
+      pending_(false),
+      sleeping_(false) {}
   virtual ~PikaAuxiliaryThread();
+  // cheap enough to be called on every binlog write,
+  // only takes mu_ when the thread is really sleeping
+  void Wakeup();
   slash::Mutex mu_;
   slash::CondVar cv_;
  private:
   virtual void* ThreadMain();
+  void WaitForWork();
+
+  std::atomic<bool> pending_;
+  std::atomic<bool> sleeping_;
 };
 
 #endif
@@ -58,6 +58,14 @@ class Binlog {
   Status Put(const std::string &item);
   Status Put(const char* item, int len);
 
+  /*
+   * Append item without flushing, the appended items become
+   * durable after Sync(), used by group commit
+   */
+  Status Append(const std::string &item);
+  Status Append(const char* item, int len);
+  Status Sync();
+
   Status GetProducerStatus(uint32_t* filenum, uint64_t* pro_offset, uint64_t* logic_id = NULL);
   /*
    * Set Producer pro_num and pro_offset with lock
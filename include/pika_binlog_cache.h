@@ -0,0 +1,70 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_BINLOG_CACHE_H_
+#define PIKA_BINLOG_CACHE_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "slash/include/slash_mutex.h"
+#include "slash/include/slash_status.h"
+
+#include "include/pika_define.h"
+
+using slash::Status;
+
+struct BinlogCacheItem {
+  // producer offset before and after this item was written
+  BinlogOffset start_offset;
+  BinlogOffset end_offset;
+  std::string binlog;
+  BinlogCacheItem(const BinlogOffset& start, const BinlogOffset& end,
+                  const std::string& item)
+      : start_offset(start), end_offset(end), binlog(item) {}
+};
+
+/*
+ * Keep the most recently produced binlog items of a partition in memory,
+ * so that slaves which have caught up with the master can be served
+ * without reading the binlog file again.
+ *
+ * Items in the cache are always contiguous, an Append which does not
+ * start at the end offset of the last item drops the whole cache.
+ */
+class BinlogCache {
+ public:
+  // capacity in bytes, 0 means disabled
+  explicit BinlogCache(uint64_t capacity);
+  ~BinlogCache();
+
+  // Invoker need to hold logger Lock()
+  void Append(const BinlogOffset& start, const BinlogOffset& end,
+              const std::string& binlog);
+  // Fetch at most max_items following offset,
+  // NotFound if offset is not covered by the cache
+  Status Read(const BinlogOffset& offset, int max_items,
+              std::vector<BinlogCacheItem>* items);
+  bool Contains(const BinlogOffset& offset);
+  void Clear();
+
+  uint64_t capacity() const { return capacity_; }
+
+ private:
+  // invoker need to hold rwlock_
+  bool Locate(const BinlogOffset& offset, size_t* index);
+
+  const uint64_t capacity_;
+  uint64_t size_;
+  std::deque<BinlogCacheItem> items_;
+  pthread_rwlock_t rwlock_;
+
+  // No copying allowed
+  BinlogCache(const BinlogCache&);
+  void operator=(const BinlogCache&);
+};
+
+#endif  // PIKA_BINLOG_CACHE_H_
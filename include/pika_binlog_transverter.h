@@ -6,6 +6,7 @@
 #ifndef PIKA_BINLOG_TRANSVERTER_H_
 #define PIKA_BINLOG_TRANSVERTER_H_
 
+#include <string>
 #include <vector>
 #include <stdint.h>
 #include <iostream>
@@ -84,6 +85,16 @@ class PikaBinlogTransverter{
                                     const std::string& content,
                                     const std::vector<std::string>& extends);
 
+    // Encode the header and the RESP form of argv into one exactly
+    // sized buffer, no intermediate content string is built
+    static std::string BinlogEncodeArgv(BinlogType type,
+                                        uint32_t exec_time,
+                                        uint32_t server_id,
+                                        uint64_t logic_id,
+                                        uint32_t filenum,
+                                        uint64_t offset,
+                                        const std::vector<std::string>& argv);
+
     static bool BinlogDecode(BinlogType type,
                              const std::string& binlog,
                              BinlogItem* binlog_item);
@@ -0,0 +1,48 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_BITOPS_H_
+#define PIKA_BITOPS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Bitmap kernels of BITCOUNT, BITPOS and BITOP.
+ *
+ * Every kernel has a scalar version working on 64 bit words, a SSE4.2
+ * one (POPCNT and 128 bit registers) and an AVX2 one, which compilers
+ * older than gcc 4.9 can't build and leave out. The best one the CPU
+ * supports is picked at the first call, so the binary still runs on
+ * CPUs without them.
+ */
+enum BitmapKernel {
+  kBitmapKernelScalar = 0,
+  kBitmapKernelSSE42 = 1,
+  kBitmapKernelAVX2 = 2
+};
+
+BitmapKernel BitmapBestKernel();
+// Returns false if the CPU does not support kernel
+bool BitmapSetKernel(BitmapKernel kernel);
+const char* BitmapKernelName();
+// Kernel of name, one of auto (the best one), scalar, sse4.2 and avx2,
+// returns false for any other name
+bool BitmapKernelByName(const char* name, BitmapKernel* kernel);
+
+// Set bits of p[0, n)
+int64_t BitmapPopcount(const char* p, size_t n);
+// Position of the first bit of value bit in p[0, n), counted from the
+// most significant bit of p[0], or n * 8 if there is none
+int64_t BitmapFirstBit(const char* p, size_t n, int bit);
+
+// dst[i] = dst[i] op src[i] for i in [0, n)
+void BitmapAnd(char* dst, const char* src, size_t n);
+void BitmapOr(char* dst, const char* src, size_t n);
+void BitmapXor(char* dst, const char* src, size_t n);
+// dst[i] = ~src[i] for i in [0, n), dst may be src
+void BitmapNot(char* dst, const char* src, size_t n);
+
+#endif  // PIKA_BITOPS_H_
@@ -14,6 +14,7 @@ class PikaClientConn: public pink::RedisConn {
     std::shared_ptr<PikaClientConn> pcc;
     std::vector<pink::RedisCmdArgsType> redis_cmds;
     std::string* response;
+    uint64_t schedule_us;
   };
 
   // Auth related
@@ -48,6 +49,14 @@ class PikaClientConn: public pink::RedisConn {
   void SetIsPubSub(bool is_pubsub) { is_pubsub_ = is_pubsub; }
   void SetCurrentTable(const std::string& table_name) {current_table_ = table_name;}
 
+  // Streaming of large replies, only while a batch runs in a worker,
+  // the socket is not touched by the io thread then.
+  // StreamReply writes the replies of the batch so far and then chunk
+  // to the socket, waiting for the client to drain it. On failure the
+  // connection is closed once the batch ends
+  bool IsReplyStreamable() { return batch_response_ != nullptr && !reply_broken_; }
+  bool StreamReply(std::string* chunk);
+
   pink::ServerThread* server_thread() {
     return server_thread_;
   }
@@ -60,7 +69,11 @@ class PikaClientConn: public pink::RedisConn {
   pink::ServerThread* const server_thread_;
   std::string current_table_;
   bool is_pubsub_;
+  std::string* batch_response_;
+  bool reply_streamed_;
+  bool reply_broken_;
 
+  bool WriteSocket(const std::string& buf);
   std::string DoCmd(const PikaCmdArgsType& argv, const std::string& opt);
 
   void ProcessSlowlog(const PikaCmdArgsType& argv, uint64_t start_us);
@@ -6,25 +6,47 @@
 #ifndef PIKA_CMD_TABLE_MANAGER_H_
 #define PIKA_CMD_TABLE_MANAGER_H_
 
+#include "slash/include/slash_mutex.h"
+
 #include "include/pika_command.h"
 #include "include/pika_data_distribution.h"
 
+// Case insensitive hash and compare, so that command name
+// can be looked up without lower-casing a copy of it
+struct CmdNameHash {
+  size_t operator()(const std::string& name) const;
+};
+
+struct CmdNameEqual {
+  bool operator()(const std::string& lhs, const std::string& rhs) const;
+};
+
+typedef std::unordered_map<std::string, Cmd*, CmdNameHash, CmdNameEqual> CmdNameIndex;
 
 class PikaCmdTableManager {
  public:
   PikaCmdTableManager();
   virtual ~PikaCmdTableManager();
+  /*
+   * Return the cmd instance owned by the current thread, it is reused
+   * by the following requests, so invoker should release it before
+   * getting the same cmd again. opt is case insensitive
+   */
   std::shared_ptr<Cmd> GetCmd(const std::string& opt);
   uint32_t DistributeKey(const std::string& key, uint32_t partition_num);
  private:
-  std::shared_ptr<Cmd> NewCommand(const std::string& opt);
+  typedef std::vector<std::shared_ptr<Cmd>> CmdPool;
+  CmdPool* CurrentThreadCmdPool();
 
   void InsertCurrentThreadDistributionMap();
   bool CheckCurrentThreadDistributionMapExist(const pid_t& tid);
 
-  void TryChangeToAlias(std::string *internal_opt);
-
   CmdTable* cmds_;
+  // Built once in constructor, read only afterwards
+  CmdNameIndex cmd_index_;
+
+  slash::Mutex pools_mu_;
+  std::vector<CmdPool*> pools_;
 
   pthread_rwlock_t map_protector_;
   std::unordered_map<pid_t, PikaDataDistribution*> thread_distribution_map_;
@@ -15,6 +15,8 @@
 #include "include/pika_partition.h"
 #include "include/pika_binlog_transverter.h"
 
+class PikaClientConn;
+
 //Constant for command name
 //Admin
 const std::string kCmdNameSlaveof = "slaveof";
@@ -39,6 +41,8 @@ const std::string kCmdNameEcho = "echo";
 const std::string kCmdNameScandb = "scandb";
 const std::string kCmdNameSlowlog = "slowlog";
 const std::string kCmdNamePadding = "padding";
+const std::string kCmdNameHotKeys = "hotkeys";
+const std::string kCmdNameLatency = "latency";
 #ifdef TCMALLOC_EXTENSION
 const std::string kCmdNameTcmalloc = "tcmalloc";
 #endif
@@ -211,7 +215,6 @@ const std::string kCmdNamePkClusterSlotsSlaveof = "pkclusterslotsslaveof";
 
 const std::string kClusterPrefix = "pkcluster";
 typedef pink::RedisCmdArgsType PikaCmdArgsType;
-static const int RAW_ARGS_LEN = 1024 * 1024; 
 
 enum CmdFlagsMask {
   kCmdFlagsMaskRW            = 1,
@@ -386,6 +389,14 @@ public:
   void AppendStringRaw(const std::string& value) {
     message_.append(value);
   }
+  size_t raw_size() const {
+    return message_.size();
+  }
+  // Hand the reply built so far over to the streaming writer,
+  // see Cmd::FlushReply
+  void SwapRaw(std::string* raw) {
+    message_.swap(*raw);
+  }
   void SetRes(CmdRet _ret, const std::string content = "") {
     ret_ = _ret;
     if (!content.empty()) {
@@ -401,7 +412,8 @@ private:
 class Cmd {
  public:
   Cmd(const std::string& name, int arity, uint16_t flag)
-    : name_(name), arity_(arity), flag_(flag) {}
+    : name_(name), arity_(arity), flag_(flag), cmd_id_(0),
+      reply_streamable_(false) {}
   virtual ~Cmd() {}
 
   virtual std::vector<std::string> current_key() const;
@@ -411,11 +423,26 @@ class Cmd {
   virtual void ProcessSinglePartitionCmd();
   virtual void ProcessMultiPartitionCmd();
   virtual void ProcessDoNotSpecifyPartitionCmd();
+  // ProcessCommand for the invoker already holding the record locks
+  // of current_key() on partition
+  void ProcessCommandLocked(std::shared_ptr<Partition> partition);
   virtual void Do(std::shared_ptr<Partition> partition = nullptr) = 0;
   virtual Cmd* Clone() = 0;
 
+  // In sharding mode a multi key command may be split into one sub
+  // command per partition, each taking its keys from argv_[1],
+  // argv_[1 + step] ..., step being SplitKeyStep(), 0 if it can't be split.
+  // MergeSubCmd folds the result of the sub command of the keys at
+  // positions, ReplyMerged builds the reply once all are merged
+  virtual size_t SplitKeyStep() const { return 0; }
+  virtual void MergeSubCmd(const std::vector<size_t>& positions, Cmd* sub_cmd) {}
+  virtual void ReplyMerged() {}
+
   void Initial(const PikaCmdArgsType& argv,
                const std::string& table_name);
+  // Take over argv, the caller must not use it any more
+  void Initial(PikaCmdArgsType&& argv,
+               const std::string& table_name);
 
   bool is_write()            const;
   bool is_local()            const;
@@ -424,8 +451,12 @@ class Cmd {
   bool is_single_partition() const;
   bool is_multi_partition()  const;
 
-  std::string name() const;
+  const std::string& name() const;
   CmdRes& res();
+  const PikaCmdArgsType& argv() const { return argv_; }
+  // Dense index assigned by InitCmdTable, used by command statistic
+  uint32_t cmd_id() const { return cmd_id_; }
+  void set_cmd_id(uint32_t cmd_id) { cmd_id_ = cmd_id; }
 
   virtual std::string ToBinlog(uint32_t exec_time,
                                const std::string& server_id,
@@ -436,6 +467,13 @@ class Cmd {
 
   void SetConn(const std::shared_ptr<pink::PinkConn> conn);
   std::shared_ptr<pink::PinkConn> GetConn();
+  // Only the command a client connection runs itself may stream its
+  // reply, never a sub command run on its behalf. Reset by Initial
+  void SetReplyStreamable(bool streamable) { reply_streamable_ = streamable; }
+  // Write the reply parts handed over by FlushReply and AppendReplyRaw
+  // to the client, called once Execute returned and no lock is held.
+  // Returns false if the client is gone
+  bool StreamReplyChunks();
 
  protected:
   // enable copy, used default copy
@@ -445,10 +483,20 @@ class Cmd {
   void DoBinlog(std::shared_ptr<Partition> partition);
   bool CheckArg(int num) const;
   void LogCommand() const;
+  void ProcessSplitCmd();
+  // Hand the reply built so far over as a chunk once it outgrows
+  // reply-stream-budget, so a large multi bulk reply is never copied
+  // whole into the connection buffer. Do runs under the db lock, the
+  // chunks are only written by StreamReplyChunks
+  void FlushReply();
+  // Append a formatted part of the reply, kept as its own chunk without
+  // another copy when it outgrows reply-stream-budget
+  void AppendReplyRaw(std::string* raw);
 
   std::string name_;
   int arity_;
   uint16_t flag_;
+  uint32_t cmd_id_;
 
   CmdRes res_;
   PikaCmdArgsType argv_;
@@ -457,8 +505,16 @@ class Cmd {
   std::weak_ptr<pink::PinkConn> conn_;
 
  private:
+  bool reply_streamable_;
+  // parts of the reply to write before res_, see FlushReply
+  std::vector<std::string> reply_chunks_;
+
+  // the client the reply can be streamed to, null if it can't be
+  std::shared_ptr<PikaClientConn> ReplyStreamConn();
+
   virtual void DoInitial() = 0;
   virtual void Clear() {};
+  void InitialInternal(const std::string& table_name);
 
   Cmd& operator=(const Cmd&);
 };
@@ -0,0 +1,32 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_COMPRESS_H_
+#define PIKA_COMPRESS_H_
+
+#include <string>
+#include <vector>
+
+#include "src/pika_inner_message.pb.h"
+
+/*
+ * Compression of the BinlogSync response sent from master to slave,
+ * only the libraries found at build time (SNAPPY, ZSTD) are supported
+ */
+bool CompressionSupported(InnerMessage::CompressionType type);
+// All supported types except kNoCompression
+std::vector<InnerMessage::CompressionType> SupportedCompressions();
+// "none", "snappy" or "zstd", kNoCompression for anything else
+InnerMessage::CompressionType CompressionTypeFromString(const std::string& name);
+std::string CompressionTypeToString(InnerMessage::CompressionType type);
+
+bool Compress(InnerMessage::CompressionType type,
+              const std::string& input, std::string* output);
+// Fails without allocating if the input claims more than max_len bytes
+// once uncompressed
+bool Uncompress(InnerMessage::CompressionType type,
+                const std::string& input, size_t max_len, std::string* output);
+
+#endif  // PIKA_COMPRESS_H_
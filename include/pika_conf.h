@@ -19,7 +19,9 @@
 #include "include/pika_meta.h"
 
 #define kBinlogReadWinDefaultSize 9000
-#define kBinlogReadWinMaxSize 90000
+#define kBinlogReadWinMaxSize 900000
+#define kBinlogCacheDefaultSize (8 * 1024 * 1024)
+#define kKeyscanMaxConcurrency 64
 
 typedef slash::RWLock RWLock;
 
@@ -46,6 +48,7 @@ class PikaConf : public slash::BaseConf {
   int64_t write_buffer_size()                       { RWLock l(&rwlock_, false); return write_buffer_size_; }
   int64_t max_write_buffer_size()                   { RWLock l(&rwlock_, false); return max_write_buffer_size_; }
   int64_t max_client_response_size()                { RWLock L(&rwlock_, false); return max_client_response_size_;}
+  int64_t reply_stream_budget()                     { return reply_stream_budget_.load(); }
   int timeout()                                     { RWLock l(&rwlock_, false); return timeout_; }
   std::string server_id()                           { RWLock l(&rwlock_, false); return server_id_; }
   std::string requirepass()                         { RWLock l(&rwlock_, false); return requirepass_; }
@@ -60,6 +63,8 @@ class PikaConf : public slash::BaseConf {
   int databases()                                   { RWLock l(&rwlock_, false); return databases_;}
   int default_slot_num()                            { RWLock l(&rwlock_, false); return default_slot_num_;}
   const std::vector<TableStruct>& table_structs()   { RWLock l(&rwlock_, false); return table_structs_; }
+  // time spent loading the sharding meta at startup
+  uint64_t meta_load_us()                           { return meta_load_us_; }
   std::string default_table()                       { RWLock l(&rwlock_, false); return default_table_;}
   std::string compression()                         { RWLock l(&rwlock_, false); return compression_; }
   int target_file_size_base()                       { RWLock l(&rwlock_, false); return target_file_size_base_; }
@@ -84,14 +89,22 @@ class PikaConf : public slash::BaseConf {
   bool slowlog_write_errorlog()                     { return slowlog_write_errorlog_.load();}
   int slowlog_slower_than()                         { return slowlog_log_slower_than_.load(); }
   int slowlog_max_len()                             { RWLock L(&rwlock_, false); return slowlog_max_len_; }
+  int slowlog_max_arg_len()                         { return slowlog_max_arg_len_.load(); }
   std::string network_interface()                   { RWLock l(&rwlock_, false); return network_interface_; }
   int sync_window_size()                            { return sync_window_size_.load(); }
   int max_conn_rbuf_size()                          { return max_conn_rbuf_size_.load(); }
+  bool binlog_group_commit()                        { return binlog_group_commit_.load(); }
+  std::string replication_compression()             { RWLock l(&rwlock_, false); return replication_compression_; }
+  int keyscan_concurrency()                         { return keyscan_concurrency_.load(); }
+  int64_t keyscan_bytes_per_sec()                   { return keyscan_bytes_per_sec_.load(); }
+  int hotkey_sample_rate()                          { return hotkey_sample_rate_.load(); }
+  std::string bitops_kernel()                       { RWLock l(&rwlock_, false); return bitops_kernel_; }
 
   // Immutable config items, we don't use lock.
   bool daemonize()                                  { return daemonize_; }
   std::string pidfile()                             { return pidfile_; }
   int binlog_file_size()                            { return binlog_file_size_; }
+  int64_t binlog_cache_size()                       { return binlog_cache_size_; }
 
   // Setter
   void SetPort(const int value) {
@@ -141,6 +154,10 @@ class PikaConf : public slash::BaseConf {
     TryPushDiffCommands("max-client-response-size", std::to_string(value));
     max_client_response_size_ = value;
   }
+  void SetReplyStreamBudget(const int64_t value) {
+    TryPushDiffCommands("reply-stream-budget", std::to_string(value));
+    reply_stream_budget_.store(value);
+  }
   void SetBgsavePath(const std::string &value) {
     RWLock l(&rwlock_, true);
     bgsave_path_ = value;
@@ -216,6 +233,10 @@ class PikaConf : public slash::BaseConf {
     TryPushDiffCommands("slowlog-max-len", std::to_string(value));
     slowlog_max_len_ = value;
   }
+  void SetSlowlogMaxArgLen(const int value) {
+    TryPushDiffCommands("slowlog-max-arg-len", std::to_string(value));
+    slowlog_max_arg_len_.store(value);
+  }
   void SetDbSyncSpeed(const int value) {
     RWLock l(&rwlock_, true);
     TryPushDiffCommands("db-sync-speed", std::to_string(value));
@@ -235,6 +256,27 @@ class PikaConf : public slash::BaseConf {
     TryPushDiffCommands("sync-window-size", std::to_string(value));
     sync_window_size_.store(value);
   }
+  void SetKeyscanConcurrency(const int& value) {
+    TryPushDiffCommands("keyscan-concurrency", std::to_string(value));
+    keyscan_concurrency_.store(value);
+  }
+  void SetKeyscanBytesPerSec(const int64_t& value) {
+    TryPushDiffCommands("keyscan-bytes-per-sec", std::to_string(value));
+    keyscan_bytes_per_sec_.store(value);
+  }
+  void SetBinlogGroupCommit(const bool value) {
+    TryPushDiffCommands("binlog-group-commit", value ? "yes" : "no");
+    binlog_group_commit_.store(value);
+  }
+  void SetHotkeySampleRate(const int& value) {
+    TryPushDiffCommands("hotkey-sample-rate", std::to_string(value));
+    hotkey_sample_rate_.store(value);
+  }
+  void SetBitopsKernel(const std::string& value) {
+    RWLock l(&rwlock_, true);
+    TryPushDiffCommands("bitops-kernel", value);
+    bitops_kernel_ = value;
+  }
   void SetMaxConnRbufSize(const int& value) {
     TryPushDiffCommands("max-conn-rbuf-size", std::to_string(value));
     max_conn_rbuf_size_.store(value);
@@ -271,6 +313,7 @@ class PikaConf : public slash::BaseConf {
   int64_t write_buffer_size_;
   int64_t max_write_buffer_size_;
   int64_t max_client_response_size_;
+  std::atomic<int64_t> reply_stream_budget_;
   bool daemonize_;
   int timeout_;
   std::string server_id_;
@@ -293,6 +336,7 @@ class PikaConf : public slash::BaseConf {
   std::atomic<bool> slowlog_write_errorlog_;
   std::atomic<int> slowlog_log_slower_than_;
   int slowlog_max_len_;
+  std::atomic<int> slowlog_max_arg_len_;
   int expire_logs_days_;
   int expire_logs_nums_;
   bool slave_read_only_;
@@ -311,6 +355,12 @@ class PikaConf : public slash::BaseConf {
   bool level_compaction_dynamic_level_bytes_;
   std::atomic<int> sync_window_size_;
   std::atomic<int> max_conn_rbuf_size_;
+  std::atomic<bool> binlog_group_commit_;
+  std::string replication_compression_;
+  std::atomic<int> keyscan_concurrency_;
+  std::atomic<int64_t> keyscan_bytes_per_sec_;
+  std::atomic<int> hotkey_sample_rate_;
+  std::string bitops_kernel_;
 
   std::string network_interface_;
 
@@ -324,8 +374,10 @@ class PikaConf : public slash::BaseConf {
   bool write_binlog_;
   int target_file_size_base_;
   int binlog_file_size_;
+  int64_t binlog_cache_size_;
 
   PikaMeta* local_meta_;
+  uint64_t meta_load_us_;
 
   pthread_rwlock_t rwlock_;
 };
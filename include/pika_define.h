@@ -53,6 +53,13 @@ struct WorkerCronTask {
   std::string ip_port;
 };
 typedef WorkerCronTask MonitorCronTask;
+// monitor ring from workers to the monitor thread, in items
+const int kMonitorQueueSize = 16384;
+// unsent bytes a monitor client may hold before messages are dropped
+const size_t kMonitorClientMaxBuffer = 8 * 1024 * 1024;
+const int kMonitorIdleWaitMs = 100;
+// a streamed reply is abandoned when the client reads nothing for so long
+const int kReplyStreamTimeoutMs = 10000;
 //task define
 #define TASK_KILL 0
 #define TASK_KILLALL 1
@@ -117,6 +124,11 @@ struct BinlogOffset {
     }
     return false;
   }
+  // binlog order
+  bool operator<(const BinlogOffset& other) const {
+    return filenum < other.filenum
+      || (filenum == other.filenum && offset < other.offset);
+  }
 };
 
 //dbsync arg
@@ -360,6 +372,8 @@ struct WriteTask {
 //slowlog define
 #define SLOWLOG_ENTRY_MAX_ARGC 32
 #define SLOWLOG_ENTRY_MAX_STRING 128
+// upper bound of slowlog-max-len
+#define SLOWLOG_MAX_LEN (1 << 20)
 
 //slowlog entry
 struct SlowlogEntry {
@@ -0,0 +1,62 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_HISTOGRAM_H_
+#define PIKA_HISTOGRAM_H_
+
+#include <atomic>
+#include <string>
+
+struct LatencySummary {
+  uint64_t count;
+  uint64_t avg;
+  uint64_t p50;
+  uint64_t p99;
+  uint64_t p999;
+  uint64_t max;
+  LatencySummary() : count(0), avg(0), p50(0), p99(0), p999(0), max(0) {}
+};
+
+/*
+ * Lock free latency histogram, values are in microseconds.
+ *
+ * Each power of two range is split into 4 buckets, so a reported
+ * percentile is at most 25% above the real value.
+ */
+class LatencyHistogram {
+ public:
+  LatencyHistogram();
+
+  void Add(uint64_t value);
+  void Clear();
+  // add the samples of other, used to aggregate per thread histograms
+  void Merge(const LatencyHistogram& other);
+
+  uint64_t Count() const;
+  uint64_t Average() const;
+  uint64_t Max() const;
+  // p in (0, 100]
+  uint64_t Percentile(double p) const;
+
+  LatencySummary Summary() const;
+  // count=..,avg=..,p50=..,p99=..,p999=..,max=..
+  std::string ToString() const;
+
+ private:
+  static const size_t kNumBuckets = 252;
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketUpperBound(size_t index);
+
+  std::atomic<uint64_t> buckets_[kNumBuckets];
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> sum_;
+  std::atomic<uint64_t> max_;
+
+  // No copying allowed
+  LatencyHistogram(const LatencyHistogram&);
+  void operator=(const LatencyHistogram&);
+};
+
+#endif  // PIKA_HISTOGRAM_H_
@@ -0,0 +1,102 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_HOTKEY_H_
+#define PIKA_HOTKEY_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "slash/include/slash_mutex.h"
+
+// slots of per thread sampling state, threads share a slot beyond this
+#define kHotKeySlots 64
+// keys kept per table and per read/write after each merge
+#define kHotKeyTopK 32
+// candidate keys tracked by every slot between two merges
+#define kHotKeyCandidates 64
+#define kHotKeySketchDepth 4
+#define kHotKeySketchWidth 4096
+// keys of every table and read/write shown by INFO HOTKEYS
+#define kHotKeyInfoNum 3
+
+struct HotKeyItem {
+  std::string table_name;
+  uint32_t partition_id;
+  std::string key;
+  bool is_write;
+  // estimated commands per second in the last window
+  uint64_t ops_per_sec;
+  // estimated commands, halved at every window so old heat fades
+  uint64_t score;
+  HotKeyItem() : partition_id(0), is_write(false), ops_per_sec(0), score(0) {}
+};
+
+/*
+ * Sampling hot key tracker.
+ *
+ * Every worker samples about one command out of sample_rate, and counts
+ * the sampled keys in a count-min sketch of its own slot, keeping the
+ * keys with the highest estimate as candidates. Merge() is called
+ * periodically to fold the candidates of all slots into the top
+ * kHotKeyTopK keys of every table, for reads and writes separately.
+ */
+class HotKeyTracker {
+ public:
+  HotKeyTracker();
+  ~HotKeyTracker();
+
+  // Cheap enough to call for every command, sample_rate <= 0 disables
+  static bool ShouldSample(int sample_rate);
+  void Add(const std::string& table_name,
+           const std::vector<std::string>& keys, bool is_write);
+
+  // fold the slots sampled with sample_rate since the last merge
+  void Merge(int sample_rate);
+  void Reset();
+
+  // sorted by score, empty table_name means every table
+  void GetHotKeys(const std::string& table_name, size_t count,
+                  bool with_read, bool with_write,
+                  std::vector<HotKeyItem>* items);
+  uint64_t window_us();
+
+ private:
+  struct CountMinSketch {
+    uint32_t counters[kHotKeySketchDepth][kHotKeySketchWidth];
+    CountMinSketch();
+    // return the estimate after the increment
+    uint32_t Add(size_t hash);
+    void Clear();
+  };
+
+  struct Slot {
+    slash::Mutex mu;
+    // index 0 for reads, 1 for writes
+    std::unique_ptr<CountMinSketch> sketch[2];
+    std::unordered_map<std::string, uint64_t> candidates[2];
+    uint64_t candidates_min[2];
+    Slot();
+    void Add(const std::string& id, int type);
+  };
+
+  static size_t CurrentThreadSlot();
+
+  Slot slots_[kHotKeySlots];
+
+  slash::Mutex hot_keys_mu_;
+  uint64_t last_merge_us_;
+  uint64_t window_us_;
+  std::vector<HotKeyItem> hot_keys_;
+
+  // No copying allowed
+  HotKeyTracker(const HotKeyTracker&);
+  void operator=(const HotKeyTracker&);
+};
+
+#endif  // PIKA_HOTKEY_H_
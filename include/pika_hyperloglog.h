@@ -6,9 +6,61 @@
 #ifndef PIKA_HYPERLOGLOG_H_
 #define PIKA_HYPERLOGLOG_H_
 
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "slash/include/slash_mutex.h"
+
 #include "include/pika_command.h"
 #include "include/pika_partition.h"
 
+#define kPfCountCacheShards 16
+// estimates kept by every shard, a full shard is emptied
+#define kPfCountCacheShardEntries 4096
+
+/*
+ * Cardinality estimates of PFCOUNT.
+ *
+ * An estimate is kept with the fingerprints of the values of its keys
+ * it was computed from, and is used only while the keys still hold
+ * values of the same fingerprints. So a write of any kind to a key, or
+ * its expiration, makes the estimate of the key miss without having to
+ * be tracked, PFADD and PFMERGE just drop it early.
+ */
+class PfCountCache {
+ public:
+  PfCountCache() {}
+
+  static std::string CacheKey(std::shared_ptr<Partition> partition,
+                              const std::vector<std::string>& keys);
+  // Of the value of a key, 0 if the key does not exist
+  static uint64_t Fingerprint(const rocksdb::Status& s, const std::string& value);
+
+  bool Get(const std::string& cache_key,
+           const std::vector<uint64_t>& fingerprints, int64_t* count);
+  void Put(const std::string& cache_key,
+           const std::vector<uint64_t>& fingerprints, int64_t count);
+  void Erase(const std::string& cache_key);
+
+ private:
+  struct Entry {
+    std::vector<uint64_t> fingerprints;
+    int64_t count;
+  };
+  struct Shard {
+    slash::Mutex mu;
+    std::unordered_map<std::string, Entry> entries;
+  };
+  Shard* GetShard(const std::string& cache_key);
+
+  Shard shards_[kPfCountCacheShards];
+
+  // No copying allowed
+  PfCountCache(const PfCountCache&);
+  void operator=(const PfCountCache&);
+};
+
 /*
  * hyperloglog
  */
@@ -48,6 +100,9 @@ class PfCountCmd : public Cmd {
   virtual void Clear() {
     keys_.clear();
   }
+  // fingerprints of the values of keys_
+  rocksdb::Status Fingerprints(std::shared_ptr<Partition> partition,
+                               std::vector<uint64_t>* fingerprints);
 };
 
 class PfMergeCmd : public Cmd {
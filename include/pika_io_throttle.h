@@ -0,0 +1,58 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_IO_THROTTLE_H_
+#define PIKA_IO_THROTTLE_H_
+
+#include <atomic>
+#include <functional>
+
+#include "rocksdb/env.h"
+
+/*
+ * Limits the bytes a group of threads reads from sst files per second.
+ *
+ * Threads join the group with ScopedIoThrottle, the file reads they do
+ * through IoThrottleEnv() then sleep while the group runs ahead of the
+ * limit. Block cache hits cost nothing, and the reads of other threads
+ * on the same files are not affected.
+ */
+class IoThrottle {
+ public:
+  // limit is asked on every read so that it can be changed on the fly,
+  // <= 0 means no limit
+  explicit IoThrottle(const std::function<int64_t()>& limit);
+
+  void Charge(size_t bytes);
+  uint64_t BytesRead() const { return bytes_.load(); }
+
+ private:
+  std::function<int64_t()> limit_;
+  uint64_t start_us_;
+  std::atomic<uint64_t> bytes_;
+
+  // No copying allowed
+  IoThrottle(const IoThrottle&);
+  void operator=(const IoThrottle&);
+};
+
+// Charges the reads of the current thread to throttle while in scope
+class ScopedIoThrottle {
+ public:
+  explicit ScopedIoThrottle(IoThrottle* throttle);
+  ~ScopedIoThrottle();
+
+ private:
+  IoThrottle* prev_;
+
+  // No copying allowed
+  ScopedIoThrottle(const ScopedIoThrottle&);
+  void operator=(const ScopedIoThrottle&);
+};
+
+// Env of the partition dbs, the default env with throttled file reads
+rocksdb::Env* IoThrottleEnv();
+
+#endif  // PIKA_IO_THROTTLE_H_
@@ -81,10 +81,17 @@ class DelCmd : public Cmd {
   virtual Cmd* Clone() override {
     return new DelCmd(*this);
   }
+  virtual size_t SplitKeyStep() const override { return 1; }
+  virtual void MergeSubCmd(const std::vector<size_t>& positions, Cmd* sub_cmd) override;
+  virtual void ReplyMerged() override;
 
  private:
   std::vector<std::string> keys_;
+  int64_t count_;
   virtual void DoInitial() override;
+  virtual void Clear() override {
+    count_ = 0;
+  }
 };
 
 class IncrCmd : public Cmd {
@@ -231,10 +238,17 @@ class MgetCmd : public Cmd {
   virtual Cmd* Clone() override {
     return new MgetCmd(*this);
   }
+  virtual size_t SplitKeyStep() const override { return 1; }
+  virtual void MergeSubCmd(const std::vector<size_t>& positions, Cmd* sub_cmd) override;
+  virtual void ReplyMerged() override;
 
  private:
   std::vector<std::string> keys_;
+  std::vector<blackwidow::ValueStatus> vss_;
   virtual void DoInitial() override;
+  virtual void Clear() override {
+    vss_.clear();
+  }
 };
 
 class KeysCmd : public Cmd {
@@ -370,6 +384,8 @@ class MsetCmd : public Cmd {
   virtual Cmd* Clone() override {
     return new MsetCmd(*this);
   }
+  virtual size_t SplitKeyStep() const override { return 2; }
+  virtual void ReplyMerged() override;
  private:
   std::vector<blackwidow::KeyValue> kvs_;
   virtual void DoInitial() override;
@@ -458,10 +474,17 @@ class ExistsCmd : public Cmd {
   virtual Cmd* Clone() override {
     return new ExistsCmd(*this);
   }
+  virtual size_t SplitKeyStep() const override { return 1; }
+  virtual void MergeSubCmd(const std::vector<size_t>& positions, Cmd* sub_cmd) override;
+  virtual void ReplyMerged() override;
 
  private:
   std::vector<std::string> keys_;
+  int64_t count_;
   virtual void DoInitial() override;
+  virtual void Clear() override {
+    count_ = 0;
+  }
 };
 
 class ExpireCmd : public Cmd {
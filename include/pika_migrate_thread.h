@@ -0,0 +1,126 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_MIGRATE_THREAD_H_
+#define PIKA_MIGRATE_THREAD_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "pink/include/pink_thread.h"
+#include "slash/include/slash_mutex.h"
+#include "slash/include/slash_status.h"
+
+#include "include/pika_partition.h"
+
+using slash::Status;
+
+// limits of the synchronous migrate commands, which have no arguments for them
+const int64_t kMigrateDefaultMaxBulks = 200;
+const int64_t kMigrateDefaultMaxBytes = 32 * 1024 * 1024;
+// elements of a hash, list, set or zset carried by one restore command
+const int64_t kMigrateElementsPerCmd = 512;
+// used when the timeout argument of a migrate command is not positive
+const int64_t kMigrateDefaultTimeoutMs = 1000;
+const int kMigrateIdleWaitMs = 100;
+
+struct MigrateDest {
+  std::string ip;
+  int64_t port;
+  int64_t timeout_ms;
+  // commands and bytes sent to the destination before waiting for their replies
+  int64_t max_bulks;
+  int64_t max_bytes;
+  MigrateDest()
+      : port(0), timeout_ms(0),
+        max_bulks(kMigrateDefaultMaxBulks),
+        max_bytes(kMigrateDefaultMaxBytes) {}
+};
+
+struct MigrateStatus {
+  MigrateDest dest;
+  std::string table_name;
+  int64_t slot;
+  bool migrating;
+  int64_t moved;
+  int64_t remained;
+  uint64_t sent_bytes;
+  uint64_t elapsed_us;
+  // why the last migration stopped early, empty if it did not
+  std::string error;
+  MigrateStatus()
+      : slot(-1), migrating(false), moved(0), remained(0),
+        sent_bytes(0), elapsed_us(0) {}
+};
+
+class MigrateSender;
+
+/*
+ * Moves the keys of a slot to another instance, key by key.
+ *
+ * Every key is sent as the plain write commands rebuilding it (DEL first,
+ * then SET, HMSET, RPUSH, SADD, ZADD and EXPIRE), pipelined until
+ * max_bulks commands or max_bytes bytes wait for their replies. The keys
+ * of the pipeline are record locked from being read until their replies
+ * are checked and they are deleted locally, so a concurrent write either
+ * lands before the key is read or after it left. They are also marked in
+ * flight meanwhile, SLOTSMGRT-EXEC-WRAPPER tells the proxy to retry a
+ * write to such key.
+ */
+class PikaMigrateThread : public pink::Thread {
+ public:
+  PikaMigrateThread();
+  virtual ~PikaMigrateThread();
+
+  // Start moving every key of the slot in the background, scan_keys keys
+  // are scanned at a time. Returns OK at once if the slot is migrating to
+  // dest already or has no key left
+  Status MigrateSlot(const MigrateDest& dest, const std::string& table_name,
+                     uint32_t slot, int64_t scan_keys);
+  void Cancel();
+  void GetStatus(MigrateStatus* status);
+
+  // Move keys of partition on the calling thread, moved counts the keys
+  // which existed
+  Status MigrateKeys(const MigrateDest& dest, const std::string& table_name,
+                     std::shared_ptr<Partition> partition,
+                     const std::vector<std::string>& keys, int64_t* moved);
+  bool IsKeyInflight(const std::string& table_name, const std::string& key);
+
+ private:
+  virtual void* ThreadMain() override;
+  void RunMigrateSlot();
+  void FinishMigrateSlot(const Status& s);
+
+  Status MigrateBatches(MigrateSender* sender, const std::string& table_name,
+                        std::shared_ptr<Partition> partition,
+                        const std::vector<std::string>& keys, int64_t* moved);
+  void AddInflight(const std::string& table_name, const std::string& key);
+  void RemoveInflight(const std::string& table_name, const std::string& key);
+
+  slash::Mutex mu_;
+  slash::CondVar cv_;
+  // of the running or the last migration, protected by mu_
+  MigrateStatus status_;
+  int64_t scan_keys_;
+  uint64_t start_us_;
+  // a migration is requested but not taken by the thread yet
+  bool pending_;
+  std::atomic<bool> cancel_;
+
+  slash::Mutex inflight_mu_;
+  // table name => keys being sent
+  std::unordered_map<std::string, std::unordered_set<std::string>> inflight_keys_;
+
+  // No copying allowed
+  PikaMigrateThread(const PikaMigrateThread&);
+  void operator=(const PikaMigrateThread&);
+};
+
+#endif  // PIKA_MIGRATE_THREAD_H_
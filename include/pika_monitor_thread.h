@@ -7,7 +7,6 @@
 #define  PIKA_MONITOR_THREAD_H_
 
 #include <list>
-#include <deque>
 #include <queue>
 #include <atomic>
 
@@ -16,6 +15,16 @@
 
 #include "include/pika_define.h"
 #include "include/pika_client_conn.h"
+#include "include/pika_mpsc_queue.h"
+
+// raw command captured by a worker, formatted by the monitor thread
+struct MonitorItem {
+  uint64_t time_us;
+  std::string table_name;
+  std::string ip_port;
+  PikaCmdArgsType argv;
+  MonitorItem() : time_us(0) {}
+};
 
 class PikaMonitorThread : public pink::Thread {
  public:
@@ -23,26 +32,59 @@ class PikaMonitorThread : public pink::Thread {
   virtual ~PikaMonitorThread();
 
   void AddMonitorClient(std::shared_ptr<PikaClientConn> client_ptr);
-  void AddMonitorMessage(const std::string &monitor_message);
+  // Called by workers, never blocks, drops the item if the ring is full
+  void AddMonitorMessage(const std::string& table_name,
+                         const std::string& ip_port,
+                         const PikaCmdArgsType& argv);
   int32_t ThreadClientList(std::vector<ClientInfo>* client = NULL);
   bool ThreadClientKill(const std::string& ip_port = "all");
   bool HasMonitorClients();
+  // messages dropped because the ring or a client buffer was full
+  uint64_t DroppedMessages();
 
  private:
+  struct MonitorClient {
+    ClientInfo info;
+    std::string buf;
+    size_t buf_pos;
+    bool want_write;
+    uint64_t dropped;
+    explicit MonitorClient(const ClientInfo& client_info)
+        : info(client_info), buf_pos(0), want_write(false), dropped(0) {}
+  };
+
   void AddCronTask(MonitorCronTask task);
   bool FindClient(const std::string& ip_port);
-  pink::WriteStatus SendMessage(int32_t fd, std::string& message);
+  void Wakeup();
+
+  // Below are only called by the monitor thread itself
+  void HandleCronTasks();
+  void HandleNewClients();
   void RemoveMonitorClient(const std::string& ip_port);
+  void RemoveMonitorClient(int32_t client_fd);
+  void CloseClient(const MonitorClient& client);
+  void FormatMessages(std::string* messages, size_t* count);
+  void DispatchMessages(const std::string& messages, size_t count);
+  // write as much of the client buffer as the socket takes without
+  // blocking, false if the client should be closed
+  bool FlushClient(MonitorClient* client);
+  void UpdateWriteInterest(MonitorClient* client);
 
+  int epfd_;
+  int wakeup_fd_;
+  std::atomic<bool> sleeping_;
   std::atomic<bool> has_monitor_clients_;
-  slash::Mutex monitor_mutex_protector_;
-  slash::CondVar monitor_cond_;
+  std::atomic<uint64_t> dropped_messages_;
+
+  MPSCQueue<MonitorItem> monitor_messages_;
 
-  std::list<ClientInfo> monitor_clients_;
-  std::deque<std::string> monitor_messages_;
+  // protect monitor_clients_ membership, pending_clients_ and cron_tasks_
+  slash::Mutex monitor_mutex_protector_;
+  std::list<MonitorClient> monitor_clients_;
+  std::vector<ClientInfo> pending_clients_;
   std::queue<MonitorCronTask> cron_tasks_;
+  std::atomic<bool> has_tasks_;
 
   virtual void* ThreadMain();
-  void RemoveMonitorClient(int32_t client_fd);
 };
 #endif
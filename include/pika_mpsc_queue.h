@@ -0,0 +1,112 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_MPSC_QUEUE_H_
+#define PIKA_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/*
+ * Bounded lock free ring for any number of producer threads and exactly
+ * one consumer thread. Every slot carries a sequence number telling
+ * whether it is ready to be written or to be read, so producers only
+ * contend on the tail index and never wait for each other.
+ *
+ * Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class MPSCQueue {
+ public:
+  explicit MPSCQueue(size_t capacity)
+      : capacity_(RoundUpPowerOfTwo(capacity)),
+        mask_(capacity_ - 1),
+        cells_(new Cell[capacity_]),
+        head_(0),
+        tail_(0) {
+    for (size_t i = 0; i < capacity_; ++i) {
+      cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+  }
+  ~MPSCQueue() {
+    delete[] cells_;
+  }
+
+  // producer side, item is moved from only on success
+  bool TryPush(T&& item) {
+    Cell* cell;
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // full
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(item);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer side
+  bool TryPop(T* item) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    Cell* cell = &cells_[pos & mask_];
+    if (cell->seq.load(std::memory_order_acquire) != pos + 1) {
+      return false;
+    }
+    *item = std::move(cell->data);
+    cell->data = T();
+    cell->seq.store(pos + capacity_, std::memory_order_release);
+    head_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+  bool Empty() const {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    return cells_[pos & mask_].seq.load(std::memory_order_acquire) != pos + 1;
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+
+  static size_t RoundUpPowerOfTwo(size_t n) {
+    size_t res = 1;
+    while (res < n) {
+      res <<= 1;
+    }
+    return res;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  Cell* const cells_;
+  // keep the indices on their own cache lines
+  char pad0_[64];
+  std::atomic<size_t> head_;
+  char pad1_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_;
+  char pad2_[64 - sizeof(std::atomic<size_t>)];
+
+  // No copying allowed
+  MPSCQueue(const MPSCQueue&);
+  void operator=(const MPSCQueue&);
+};
+
+#endif  // PIKA_MPSC_QUEUE_H_
@@ -6,11 +6,16 @@
 #ifndef PIKA_PARTITION_H_
 #define PIKA_PARTITION_H_
 
+#include <deque>
+#include <functional>
+
 #include "blackwidow/blackwidow.h"
 #include "blackwidow/backupable.h"
 #include "slash/include/scope_record_lock.h"
 
 #include "include/pika_binlog.h"
+#include "include/pika_binlog_cache.h"
+#include "include/pika_rwlock.h"
 
 class Cmd;
 
@@ -23,15 +28,41 @@ struct KeyScanInfo {
   int32_t duration;
   std::vector<blackwidow::KeyInfo> key_infos; //the order is strings, hashes, lists, zsets, sets
   bool key_scaning_;
+  // progress of the scan in processing
+  uint32_t partitions_total;
+  uint32_t partitions_done;
+  uint64_t keys_scanned;
+  // read from sst files, block cache hits excluded
+  uint64_t bytes_read;
   KeyScanInfo() :
       start_time(0),
       s_start_time("1970-01-01 08:00:00"),
       duration(-3),
       key_infos({{0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}, {0, 0, 0, 0}}),
-      key_scaning_(false) {
+      key_scaning_(false),
+      partitions_total(0),
+      partitions_done(0),
+      keys_scanned(0),
+      bytes_read(0) {
   }
 };
 
+/*
+ * Binlog group commit use
+ */
+// Encode the binlog item with the producer status it will be written at
+typedef std::function<std::string(uint32_t filenum, uint64_t offset, uint64_t logic_id)> BinlogEncoder;
+
+struct BinlogWriter {
+  BinlogEncoder encoder;
+  Status status;
+  BinlogOffset offset;
+  bool done;
+  slash::CondVar cv;
+  BinlogWriter(const BinlogEncoder& _encoder, slash::Mutex* mu)
+      : encoder(_encoder), done(false), cv(mu) {}
+};
+
 struct BgTaskArg;
 struct BgSaveInfo {
   bool bgsaving;
@@ -63,13 +94,24 @@ class Partition : public std::enable_shared_from_this<Partition> {
   uint32_t GetPartitionId() const;
   std::string GetPartitionName() const;
   std::shared_ptr<Binlog> logger() const;
+  std::shared_ptr<BinlogCache> binlog_cache() const;
   std::shared_ptr<blackwidow::BlackWidow> db() const;
 
+  // time spent in the constructor opening the db and loading the binlog
+  uint64_t db_open_us() const { return db_open_us_; }
+  uint64_t binlog_load_us() const { return binlog_load_us_; }
+
   void Compact(const blackwidow::DataType& type);
   // needd to hold logger_->Lock()
   Status WriteBinlog(const std::string& binlog);
-
-  void DbRWLockWriter();
+  // Append all the binlogs with a single flush, needd to hold logger_->Lock()
+  Status WriteBinlogBatch(const std::vector<std::string>& binlogs);
+  // Concurrent writers are batched, one of them appends the whole batch
+  // with a single flush, offset is the producer status after the item,
+  // should NOT hold logger_->Lock()
+  Status GroupWriteBinlog(const BinlogEncoder& encoder, BinlogOffset* const offset);
+
+  // shared access to db(), unlock on the same thread
   void DbRWLockReader();
   void DbRWUnLock();
 
@@ -103,6 +145,9 @@ class Partition : public std::enable_shared_from_this<Partition> {
 
   // key scan info use
   Status GetKeyNum(std::vector<blackwidow::KeyInfo>* key_info);
+  // estimated from the table properties of every sst, without a scan,
+  // members of hashes, lists, zsets and sets are counted too
+  Status GetApproximateKeyNum(std::vector<blackwidow::KeyInfo>* key_info);
   KeyScanInfo GetKeyScanInfo();
   Status GetMasterTerm(uint32_t * master_term);
   std::string GenDBSyncPath(uint32_t master_term) { return dbsync_path_base_ + GenTermDesc(master_term) + "/"; }
@@ -121,10 +166,20 @@ class Partition : public std::enable_shared_from_this<Partition> {
   std::string partition_name_;
 
   bool opened_;
+  uint64_t db_open_us_;
+  uint64_t binlog_load_us_;
   std::shared_ptr<Binlog> logger_;
+  std::shared_ptr<BinlogCache> binlog_cache_;
   std::atomic<bool> binlog_io_error_;
 
-  pthread_rwlock_t db_rwlock_;
+  /*
+   * Binlog group commit use
+   */
+  Status WriteBinlogGroup(const std::vector<BinlogWriter*>& group);
+  slash::Mutex binlog_writers_mu_;
+  std::deque<BinlogWriter*> binlog_writers_;
+
+  ScalableRWLock db_rwlock_;
   slash::lock::LockMgr* lock_mgr_;
   std::shared_ptr<blackwidow::BlackWidow> db_;
 
@@ -8,35 +8,69 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "pink/include/pb_conn.h"
-#include "pink/include/bg_thread.h"
-#include "pink/include/thread_pool.h"
 
 #include "src/pika_inner_message.pb.h"
 
 #include "include/pika_command.h"
+#include "include/pika_repl_scheduler.h"
 #include "include/pika_binlog_transverter.h"
 
+struct ReplClientWriteDBTaskArg;
+
+// At most this many commands are combined into one db write
+const size_t kWriteDBBatchMaxNum = 256;
+
+struct WriteDBTaskItem {
+  std::string dispatch_key;
+  bool is_barrier;
+  PikaCmdArgsType* argv;
+  BinlogItem* binlog_item;
+  WriteDBTaskItem(const std::string& _dispatch_key, bool _is_barrier,
+                  PikaCmdArgsType* _argv, BinlogItem* _binlog_item)
+      : dispatch_key(_dispatch_key), is_barrier(_is_barrier),
+        argv(_argv), binlog_item(_binlog_item) {}
+};
+
+/*
+ * Binlog parsing state of a replication scheduler thread, the tasks
+ * themselves are run by PikaReplScheduler
+ */
 class PikaReplBgWorker {
  public:
-  explicit PikaReplBgWorker(int queue_size);
-  int StartThread();
-  int StopThread();
-  void Schedule(pink::TaskFunc func, void* arg);
-  void QueueClear();
+  PikaReplBgWorker();
+  // the one of the calling thread
+  static PikaReplBgWorker* Current();
+
   static void HandleBGWorkerWriteBinlog(void* arg);
   static void HandleBGWorkerWriteDB(void* arg);
 
+  /*
+   * Batch func of the db scheduler, consecutive plain SET or HSET
+   * queued up in a strand while its worker is busy, e.g. a slave
+   * catching up, are applied as one db write
+   */
+  static void HandleBGWorkerWriteDBTasks(const std::vector<ReplTask>& tasks);
+
   BinlogItem binlog_item_;
   pink::RedisParser redis_parser_;
   std::string ip_port_;
   std::string table_name_;
   uint32_t partition_id_;
+  // Parsed from the BinlogSync response being handled, the binlogs are
+  // written to local binlog with one flush before scheduling db tasks
+  std::vector<std::string> binlogs_;
+  std::vector<WriteDBTaskItem> db_tasks_;
 
  private:
-  pink::BGThread bg_thread_;
+  void ClearWriteDBTasks();
+
   static int HandleWriteBinlog(pink::RedisParser* parser, const pink::RedisCmdArgsType& argv);
+  static size_t CombinableNum(const std::vector<ReplClientWriteDBTaskArg*>& tasks, size_t start);
+  static void HandleBGWorkerWriteDBBatch(const std::vector<ReplClientWriteDBTaskArg*>& tasks,
+                                         size_t start, size_t num);
 };
 
 #endif  // PIKA_REPL_BGWROKER_H_
@@ -25,6 +25,8 @@
 
 using slash::Status;
 
+class SyncSlavePartition;
+
 struct ReplClientTaskArg {
   std::shared_ptr<InnerMessage::InnerResponse> res;
   std::shared_ptr<pink::PbConn> conn;
@@ -37,14 +39,12 @@ struct ReplClientWriteBinlogTaskArg {
   std::shared_ptr<InnerMessage::InnerResponse> res;
   std::shared_ptr<pink::PbConn> conn;
   void* res_private_data;
-  PikaReplBgWorker* worker;
   ReplClientWriteBinlogTaskArg(
           const std::shared_ptr<InnerMessage::InnerResponse> _res,
           std::shared_ptr<pink::PbConn> _conn,
-          void* _res_private_data,
-          PikaReplBgWorker* _worker) :
+          void* _res_private_data) :
       res(_res), conn(_conn),
-      res_private_data(_res_private_data), worker(_worker) {}
+      res_private_data(_res_private_data) {}
 };
 
 struct ReplClientWriteDBTaskArg {
@@ -52,16 +52,17 @@ struct ReplClientWriteDBTaskArg {
   BinlogItem* binlog_item;
   std::string table_name;
   uint32_t partition_id;
+  // Pending apply of slave_partition is finished when task arg is deleted
+  std::shared_ptr<SyncSlavePartition> slave_partition;
   ReplClientWriteDBTaskArg(PikaCmdArgsType* _argv,
                            BinlogItem* _binlog_item,
                            const std::string _table_name,
-                           uint32_t _partition_id)
+                           uint32_t _partition_id,
+                           std::shared_ptr<SyncSlavePartition> _slave_partition)
       : argv(_argv), binlog_item(_binlog_item),
-        table_name(_table_name), partition_id(_partition_id) {}
-  ~ReplClientWriteDBTaskArg() {
-    delete argv;
-    delete binlog_item;
-  }
+        table_name(_table_name), partition_id(_partition_id),
+        slave_partition(_slave_partition) {}
+  ~ReplClientWriteDBTaskArg();
 };
 
 
@@ -77,13 +78,22 @@ class PikaReplClient {
   slash::Status Close(const std::string& ip, const int port);
 
   void Schedule(pink::TaskFunc func, void* arg);
+  /*
+   * Binlog of a partition is written in order by one worker at a time,
+   * db tasks run on a separate set of workers
+   */
   void ScheduleWriteBinlogTask(std::string table_partition,
                                const std::shared_ptr<InnerMessage::InnerResponse> res,
                                std::shared_ptr<pink::PbConn> conn,
                                void* req_private_data);
-  void ScheduleWriteDBTask(const std::string& dispatch_key,
-                           PikaCmdArgsType* argv, BinlogItem* binlog_item,
-                           const std::string& table_name, uint32_t partition_id);
+  /*
+   * Commands with the same dispatch key are applied in order, one at a
+   * time, a barrier command is applied after all the commands
+   * scheduled before it, and before any command scheduled after it
+   */
+  void ScheduleWriteDBTask(const std::shared_ptr<SyncSlavePartition>& slave_partition,
+                           const std::string& dispatch_key, bool is_barrier,
+                           PikaCmdArgsType* argv, BinlogItem* binlog_item);
 
   Status SendMetaSync();
   Status SendPartitionDBSync(const std::string& ip,
@@ -114,16 +124,17 @@ class PikaReplClient {
                              uint32_t partition_id,
                              const std::string& local_ip,
                              uint32_t master_term);
- private:
-  size_t GetHashIndex(std::string key, bool upper_half);
-  void UpdateNextAvail() {
-    next_avail_ = (next_avail_ + 1) % bg_workers_.size();
-  }
 
+  // binlog workers first, then db workers
+  void WorkerStats(std::vector<ReplWorkerStat>* binlog_stats,
+                   std::vector<ReplWorkerStat>* db_stats);
+
+ private:
   PikaReplClientThread* client_thread_;
-  int next_avail_;
   std::hash<std::string> str_hash;
-  std::vector<PikaReplBgWorker*> bg_workers_;
+  // sync-thread-num workers each
+  PikaReplScheduler* binlog_scheduler_;
+  PikaReplScheduler* db_scheduler_;
 };
 
 #endif
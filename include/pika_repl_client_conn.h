@@ -28,6 +28,8 @@ class PikaReplClientConn: public pink::PbConn {
  private:
   // dispatch binlog by its table_name + partition
   void DispatchBinlogRes(const std::shared_ptr<InnerMessage::InnerResponse> response);
+  static bool UncompressBinlogRes(const std::shared_ptr<InnerMessage::InnerResponse> compressed_response,
+                                  std::shared_ptr<InnerMessage::InnerResponse>* response);
 
   struct ReplRespArg {
     std::shared_ptr<InnerMessage::InnerResponse> resp;
@@ -0,0 +1,120 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_REPL_SCHEDULER_H_
+#define PIKA_REPL_SCHEDULER_H_
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "pink/include/pink_thread.h"
+#include "pink/include/thread_pool.h"
+#include "slash/include/slash_mutex.h"
+
+// at most this many tasks of a strand are taken by one run
+const size_t kReplStrandBatchNum = 256;
+const int kReplSchedulerIdleWaitMs = 100;
+// db strands of the keys, per db worker
+const size_t kReplDBStrandsPerWorker = 16;
+
+struct ReplTask {
+  pink::TaskFunc func;
+  void* arg;
+};
+
+// Runs tasks taken from one strand, in order
+typedef void (*ReplBatchFunc)(const std::vector<ReplTask>& tasks);
+
+struct ReplWorkerStat {
+  // tasks of the strands waiting in the run queue of the worker
+  uint64_t queue_depth;
+  uint64_t busy_us;
+  uint64_t tasks;
+  // strands taken over from other workers
+  uint64_t steals;
+  ReplWorkerStat() : queue_depth(0), busy_us(0), tasks(0), steals(0) {}
+};
+
+/*
+ * Work stealing scheduler of the slave side replication stages.
+ *
+ * Tasks are scheduled to a strand, the tasks of a strand run one at a
+ * time in schedule order, so a strand per partition or per key keeps
+ * their order. A strand with tasks waits in the run queue of its home
+ * worker. A worker whose run queue is empty steals the strand at the
+ * back of the longest run queue and becomes its home, so a skewed
+ * partition no longer pins the load of others to the worker its hash
+ * picked.
+ */
+class PikaReplScheduler {
+ public:
+  // batch_func runs the tasks of a strand taken at once, or null to
+  // run every task by itself
+  PikaReplScheduler(const std::string& name, int worker_num,
+                    size_t strand_max_tasks, ReplBatchFunc batch_func);
+  ~PikaReplScheduler();
+
+  int Start();
+  int Stop();
+
+  // Blocks while the strand already holds strand_max_tasks tasks
+  void Schedule(size_t strand_key, pink::TaskFunc func, void* arg);
+  // A task without any order constraint
+  void Schedule(pink::TaskFunc func, void* arg);
+
+  void WorkerStats(std::vector<ReplWorkerStat>* stats);
+  size_t worker_num() const { return workers_.size(); }
+
+ private:
+  struct Strand {
+    std::deque<ReplTask> tasks;
+    size_t home;
+    // in a run queue or running
+    bool queued;
+    // not kept in strands_, freed once it runs dry
+    bool transient;
+    Strand(size_t _home, bool _transient)
+        : home(_home), queued(false), transient(_transient) {}
+  };
+
+  class Worker : public pink::Thread {
+   public:
+    Worker(PikaReplScheduler* scheduler, size_t index);
+    std::deque<Strand*> run_queue;
+    slash::CondVar cv;
+    bool idle;
+    ReplWorkerStat stat;
+   private:
+    virtual void* ThreadMain() override;
+    PikaReplScheduler* const scheduler_;
+    const size_t index_;
+  };
+
+  // Below are invoked with mu_ held
+  void Enqueue(Strand* strand, pink::TaskFunc func, void* arg);
+  Strand* NextStrand(size_t index);
+
+  void Run(size_t index);
+
+  std::string name_;
+  size_t strand_max_tasks_;
+  ReplBatchFunc batch_func_;
+
+  slash::Mutex mu_;
+  // signaled when a full strand gets room
+  slash::CondVar space_cv_;
+  bool stopping_;
+  size_t next_home_;
+  std::unordered_map<size_t, Strand*> strands_;
+  std::vector<Worker*> workers_;
+
+  // No copying allowed
+  PikaReplScheduler(const PikaReplScheduler&);
+  void operator=(const PikaReplScheduler&);
+};
+
+#endif  // PIKA_REPL_SCHEDULER_H_
@@ -38,12 +38,22 @@ class PikaReplServer {
   void RemoveClientConn(int fd);
   void KillAllConns();
 
+  // Compression of BinlogSync response to the slave, negotiated by TrySync
+  void UpdateClientCompression(const std::string& ip_port,
+                               InnerMessage::CompressionType compression);
+  InnerMessage::CompressionType ClientCompression(const std::string& ip_port);
+
  private:
+  // Compress the serialized BinlogSync response if negotiated
+  slash::Status WriteBinlogSyncResp(const std::string& ip, int port,
+                                    const std::string& resp);
+
   pink::ThreadPool* server_tp_;
   PikaReplServerThread* pika_repl_server_thread_;
 
   pthread_rwlock_t client_conn_rwlock_;
   std::map<std::string, int> client_conn_map_;
+  std::map<std::string, InnerMessage::CompressionType> client_compression_map_;
 };
 
 #endif
@@ -9,18 +9,28 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
-#include <queue>
 #include <vector>
 #include <algorithm>
+#include <atomic>
 
 #include "slash/include/slash_status.h"
 
 #include "include/pika_binlog_reader.h"
+#include "include/pika_histogram.h"
 #include "include/pika_repl_client.h"
 #include "include/pika_repl_server.h"
+#include "include/pika_spsc_queue.h"
+#include "include/pika_sync_window.h"
 
+// max packets sent to one slave partition in a round of ConsumeWriteQueue
 #define kBinlogSendPacketNum 40
-#define kBinlogSendBatchNum 100
+// number of binlog chips a slave partition can have queued but not sent
+#define kBinlogSendQueueSize 4096
+// bounds of the adaptive BinlogSync packet size
+#define kBinlogSendBatchMinBytes (16 << 10)
+#define kBinlogSendBatchMaxBytes (4 << 20)
+// packets grow while acks come back faster than this (unit microseconds)
+#define kBinlogSendTargetRtt (5 * 1000)
 
 // unit seconds
 #define kSendKeepAliveTimeout (2 * 1000000)
@@ -28,48 +38,37 @@
 
 using slash::Status;
 
-struct SyncWinItem {
-  BinlogOffset offset_;
-  bool acked_;
-  bool operator==(const SyncWinItem& other) const {
-    if (offset_.filenum == other.offset_.filenum && offset_.offset == other.offset_.offset) {
-      return true;
-    }
-    return false;
-  }
-  explicit SyncWinItem(const BinlogOffset& offset) : offset_(offset), acked_(false) {
-  }
-  SyncWinItem(uint32_t filenum, uint64_t offset) : offset_(filenum, offset), acked_(false) {
-  }
-  std::string ToString() const {
-    return offset_.ToString() + " acked: " + std::to_string(acked_);
-  }
-};
-
-class SyncWindow {
+// role master use
+/*
+ * Binlog chips of one slave partition waiting to be sent.
+ * Filled by whoever holds the SlaveNode slave_mu and drained by the
+ * auxiliary thread only, so the ring itself needs no lock.
+ */
+class BinlogSendQueue {
  public:
-  SyncWindow() {
-  }
-  void Push(const SyncWinItem& item);
-  bool Update(const SyncWinItem& start_item, const SyncWinItem& end_item, BinlogOffset* acked_offset);
-  int Remainings();
-  std::string ToStringStatus() const {
-    if (win_.empty()) {
-      return "      Size: " + std::to_string(win_.size()) + "\r\n";
-    } else {
-      std::string res;
-      res += "      Size: " + std::to_string(win_.size()) + "\r\n";
-      res += ("      Begin_item: " + win_.begin()->ToString() + "\r\n");
-      res += ("      End_item: " + win_.rbegin()->ToString() + "\r\n");
-      return res;
-    }
-  }
+  BinlogSendQueue(const std::string& ip, int port);
+  ~BinlogSendQueue();
+
+  const std::string& Ip() const { return ip_; }
+  int Port() const { return port_; }
+
+  // feed the smoothed round trip with a newly acked item
+  void UpdateRtt(uint64_t sample);
+  uint64_t Rtt() const { return srtt_.load(std::memory_order_relaxed); }
+
+  // set when the connection to the slave is lost,
+  // a dropped queue is never produced to or consumed again
+  std::atomic<bool> dropped;
+  SPSCQueue<WriteTask*> tasks;
+  // only touched by the consumer
+  size_t batch_bytes;
+
  private:
-  // TODO(whoiami) ring buffer maybe
-  std::deque<SyncWinItem> win_;
+  std::string ip_;
+  int port_;
+  std::atomic<uint64_t> srtt_;
 };
 
-// role master use
 class SlaveNode : public RmNode {
  public:
   SlaveNode(const std::string& ip, int port, const std::string& table_name, uint32_t partition_id, int session_id, uint32_t master_term);
@@ -94,7 +93,14 @@ class SlaveNode : public RmNode {
   Status InitBinlogFileReader(const std::shared_ptr<Binlog>& binlog, const BinlogOffset& offset);
   void ReleaseBinlogFileReader();
 
+  // invoker need to hold slave_mu, a new queue is registered if
+  // there is none yet or the last one has been dropped
+  std::shared_ptr<BinlogSendQueue> SendQueue();
+
   slash::Mutex slave_mu;
+
+ private:
+  std::shared_ptr<BinlogSendQueue> send_queue_;
 };
 
 class SyncPartition {
@@ -152,7 +158,7 @@ class SyncMasterPartition : public SyncPartition {
                          uint64_t partition_id, int session_id);
 
  private:
-  bool CheckReadBinlogFromCache();
+  bool CheckReadBinlogFromCache(const std::shared_ptr<SlaveNode>& slave_ptr, const BinlogOffset& offset);
   // inovker need to hold partition_mu_
   void CleanMasterNode();
   void CleanSlaveNode();
@@ -167,8 +173,6 @@ class SyncMasterPartition : public SyncPartition {
 
   slash::Mutex session_mu_;
   int32_t session_id_;
-
-  // BinlogCacheWindow win_;
 };
 
 class SyncSlavePartition : public SyncPartition {
@@ -295,6 +299,14 @@ class SyncSlavePartition : public SyncPartition {
     slash::RWLock l(&partition_mu_, false);
     return m_term_;
   }
+
+  // Binlog written to local binlog but not applied to db yet
+  void AddPendingApply();
+  void FinishApply();
+  // Block until all the pending binlog are applied
+  void WaitApplyDone();
+  uint64_t PendingApply();
+
  private:
   Status GetInfoFilePath(std::string *info_file_path);
 
@@ -305,6 +317,10 @@ class SyncSlavePartition : public SyncPartition {
   ReplState repl_state_;
   std::string local_ip_;
   bool resharding_;
+
+  slash::Mutex apply_mu_;
+  slash::CondVar apply_cv_;
+  uint64_t pending_apply_;
 };
 
 class BinlogReaderManager {
@@ -418,7 +434,9 @@ class PikaReplicaManager {
                                      uint32_t partition_id, int session_id);
 
   // write_queue related
-  void ProduceWriteQueue(const std::string& ip, int port, const std::vector<WriteTask>& tasks);
+  std::shared_ptr<BinlogSendQueue> NewWriteQueue(const std::string& ip, int port);
+  // invoker need to hold the SlaveNode slave_mu
+  void ProduceWriteQueue(const std::shared_ptr<SlaveNode>& slave_ptr, std::vector<WriteTask>* tasks);
   int ConsumeWriteQueue();
   void DropItemInWriteQueue(const std::string& ip, int port);
 
@@ -428,12 +446,36 @@ class PikaReplicaManager {
   void ScheduleWriteBinlogTask(const std::string& table_partition,
                                const std::shared_ptr<InnerMessage::InnerResponse> res,
                                std::shared_ptr<pink::PbConn> conn, void* res_private_data);
-  void ScheduleWriteDBTask(const std::string& dispatch_key,
-                           PikaCmdArgsType* argv, BinlogItem* binlog_item,
-                           const std::string& table_name, uint32_t partition_id);
+  void ScheduleWriteDBTask(const std::shared_ptr<SyncSlavePartition>& slave_partition,
+                           const std::string& dispatch_key, bool is_barrier,
+                           PikaCmdArgsType* argv, BinlogItem* binlog_item);
 
   void ReplServerRemoveClientConn(int fd);
   void ReplServerUpdateClientConnMap(const std::string& ip_port, int fd);
+  void ReplServerUpdateClientCompression(const std::string& ip_port,
+                                         InnerMessage::CompressionType compression);
+
+  // binlog cache statistic, counted by binlog item
+  void IncrBinlogCacheHits(uint64_t num) { binlog_cache_hits_ += num; }
+  void IncrBinlogCacheMisses(uint64_t num) { binlog_cache_misses_ += num; }
+  uint64_t BinlogCacheHits() { return binlog_cache_hits_.load(); }
+  uint64_t BinlogCacheMisses() { return binlog_cache_misses_.load(); }
+
+  // BinlogSync response bytes sent to slaves, before and after compression
+  void IncrBinlogSyncBytes(uint64_t raw_bytes, uint64_t sent_bytes) {
+    binlog_sync_raw_bytes_ += raw_bytes;
+    binlog_sync_sent_bytes_ += sent_bytes;
+  }
+  uint64_t BinlogSyncRawBytes() { return binlog_sync_raw_bytes_.load(); }
+  uint64_t BinlogSyncSentBytes() { return binlog_sync_sent_bytes_.load(); }
+
+  // time from a binlog chip queued for a slave to acked by it
+  LatencyHistogram* binlog_ack_latency() { return &binlog_ack_latency_; }
+  std::string BinlogAckLatency() const { return binlog_ack_latency_.ToString(); }
+
+  // Load of the slave side binlog and db workers
+  void ReplWorkerStats(std::vector<ReplWorkerStat>* binlog_stats,
+                       std::vector<ReplWorkerStat>* db_stats);
 
   BinlogReaderManager binlog_reader_mgr;
 
@@ -446,12 +488,22 @@ class PikaReplicaManager {
   std::unordered_map<PartitionInfo, std::shared_ptr<SyncSlavePartition>, hash_partition_info> sync_slave_partitions_;
 
   slash::Mutex  write_queue_mu_;
-  // every host owns a queue
-  std::unordered_map<std::string, std::queue<WriteTask>> write_queues_;  // ip+port, queue<WriteTask>
+  // every slave partition owns a queue, bump the version on any change
+  std::vector<std::shared_ptr<BinlogSendQueue>> write_queues_;
+  std::atomic<uint64_t> write_queues_version_;
+  // consumer side copy of write_queues_, refreshed when version changed
+  std::vector<std::shared_ptr<BinlogSendQueue>> consume_queues_;
+  uint64_t consume_queues_version_;
 
   PikaReplClient* pika_repl_client_;
   PikaReplServer* pika_repl_server_;
   int last_meta_sync_timestamp_;
+
+  std::atomic<uint64_t> binlog_cache_hits_;
+  std::atomic<uint64_t> binlog_cache_misses_;
+  std::atomic<uint64_t> binlog_sync_raw_bytes_;
+  std::atomic<uint64_t> binlog_sync_sent_bytes_;
+  LatencyHistogram binlog_ack_latency_;
 };
 
 #endif  //  PIKA_RM_H
@@ -0,0 +1,90 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_RWLOCK_H_
+#define PIKA_RWLOCK_H_
+
+#include <atomic>
+
+#include "slash/include/slash_mutex.h"
+
+/*
+ * Reader writer lock for data which is read on every command but
+ * written very rarely, like the db handle of a partition.
+ *
+ * Readers only touch a counter on their own cache line, picked by
+ * thread, so they do not contend with each other. A writer raises a
+ * flag which makes new readers wait, then waits for every counter to
+ * drain. Writers are preferred and not recursive, as the
+ * PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP lock it replaces.
+ *
+ * A reader must unlock on the same thread which locked.
+ *
+ * Since a waiting writer blocks new readers, a reader must never wait
+ * for something another reader may hold. For the partition db lock
+ * this means: take the record locks first, and never take a record
+ * lock while holding the db lock. Otherwise a reader holding the db
+ * lock waits for a record lock whose owner waits for the db lock
+ * behind a writer.
+ */
+class ScalableRWLock {
+ public:
+  ScalableRWLock();
+
+  void ReadLock();
+  void ReadUnlock();
+  void WriteLock();
+  void WriteUnlock();
+
+ private:
+  static const size_t kReaderSlots = 64;
+  static size_t CurrentThreadSlot();
+
+  struct ReaderSlot {
+    std::atomic<uint64_t> readers;
+    char pad[64 - sizeof(std::atomic<uint64_t>)];
+  };
+  ReaderSlot slots_[kReaderSlots];
+
+  std::atomic<bool> writer_;
+  // serializes writers
+  slash::Mutex writer_mu_;
+  // blocked readers wait on it for the writer to leave
+  slash::Mutex wait_mu_;
+  slash::CondVar wait_cv_;
+
+  // No copying allowed
+  ScalableRWLock(const ScalableRWLock&);
+  void operator=(const ScalableRWLock&);
+};
+
+class ScalableRWLockGuard {
+ public:
+  ScalableRWLockGuard(ScalableRWLock* lock, bool is_write)
+      : lock_(lock), is_write_(is_write) {
+    if (is_write_) {
+      lock_->WriteLock();
+    } else {
+      lock_->ReadLock();
+    }
+  }
+  ~ScalableRWLockGuard() {
+    if (is_write_) {
+      lock_->WriteUnlock();
+    } else {
+      lock_->ReadUnlock();
+    }
+  }
+
+ private:
+  ScalableRWLock* const lock_;
+  const bool is_write_;
+
+  // No copying allowed
+  ScalableRWLockGuard(const ScalableRWLockGuard&);
+  void operator=(const ScalableRWLockGuard&);
+};
+
+#endif  // PIKA_RWLOCK_H_
@@ -23,7 +23,11 @@
 #include "include/pika_table.h"
 #include "include/pika_binlog.h"
 #include "include/pika_define.h"
+#include "include/pika_hotkey.h"
+#include "include/pika_slowlog.h"
+#include "include/pika_histogram.h"
 #include "include/pika_monitor_thread.h"
+#include "include/pika_migrate_thread.h"
 #include "include/pika_rsync_service.h"
 #include "include/pika_dispatch_thread.h"
 #include "include/pika_repl_client.h"
@@ -33,28 +37,112 @@
 using slash::Status;
 using slash::Slice;
 
+struct CmdExecStat {
+  uint64_t calls;
+  uint64_t usecs;
+  CmdExecStat() : calls(0), usecs(0) {}
+};
+
+// stages of a command whose latency is tracked apart
+enum LatencyStage {
+  kLatencyQueue = 0,  // waiting in the thread pool before being executed
+  kLatencyLock,       // waiting for the record locks of a write
+  kLatencyDo,         // Cmd::Do, including the db reader lock
+  kLatencyBinlog,     // Cmd::DoBinlog of a write
+  kLatencyStageNum
+};
+extern const char* LatencyStageName(LatencyStage stage);
+
+/*
+ * Command statistic of one thread, only written by its owner thread,
+ * indexed by Cmd::cmd_id()
+ */
+struct ThreadStatisticData {
+  explicit ThreadStatisticData(size_t cmd_num)
+      : querynum(0),
+        cmd_num(cmd_num),
+        cmd_calls(new std::atomic<uint64_t>[cmd_num]),
+        cmd_usecs(new std::atomic<uint64_t>[cmd_num]),
+        cmd_latency(new std::atomic<LatencyHistogram*>[cmd_num]) {
+    for (size_t idx = 0; idx < cmd_num; ++idx) {
+      cmd_calls[idx].store(0);
+      cmd_usecs[idx].store(0);
+      cmd_latency[idx].store(nullptr);
+    }
+  }
+  ~ThreadStatisticData() {
+    for (size_t idx = 0; idx < cmd_num; ++idx) {
+      delete cmd_latency[idx].load();
+    }
+  }
+
+  // histograms are allocated on first use, most threads run a few commands
+  LatencyHistogram* CmdLatency(uint32_t cmd_id) {
+    LatencyHistogram* histogram = cmd_latency[cmd_id].load(std::memory_order_acquire);
+    if (histogram == nullptr) {
+      histogram = new LatencyHistogram();
+      cmd_latency[cmd_id].store(histogram, std::memory_order_release);
+    }
+    return histogram;
+  }
+
+  std::atomic<uint64_t> querynum;
+  const size_t cmd_num;
+  std::unique_ptr<std::atomic<uint64_t>[]> cmd_calls;
+  std::unique_ptr<std::atomic<uint64_t>[]> cmd_usecs;
+  std::unique_ptr<std::atomic<LatencyHistogram*>[]> cmd_latency;
+  LatencyHistogram stage_latency[kLatencyStageNum];
+};
+
+/*
+ * How long each phase of the startup took, filled by InitTableStruct
+ */
+struct StartupTiming {
+  uint64_t meta_load_us;
+  uint64_t partitions_open_us;     // wall time of opening all partitions
+  uint64_t partition_num;
+  uint64_t db_open_total_us;
+  uint64_t db_open_max_us;
+  uint64_t binlog_load_total_us;
+  uint64_t binlog_load_max_us;
+  uint64_t repl_restore_us;
+  StartupTiming()
+      : meta_load_us(0), partitions_open_us(0), partition_num(0),
+        db_open_total_us(0), db_open_max_us(0),
+        binlog_load_total_us(0), binlog_load_max_us(0),
+        repl_restore_us(0) {}
+  std::string ToString() const;
+};
+
 struct StatisticData {
   StatisticData()
       : accumulative_connections(0),
-        thread_querynum(0),
         last_thread_querynum(0),
         last_sec_thread_querynum(0),
         last_time_us(0) {
     CmdTable* cmds = new CmdTable();
     cmds->reserve(300);
     InitCmdTable(cmds);
+    cmd_names.resize(cmds->size());
     CmdTable::const_iterator it = cmds->begin();
     for (; it != cmds->end(); ++it) {
       std::string tmp = it->first;
-      exec_count_table[slash::StringToUpper(tmp)].store(0);
+      cmd_names[it->second->cmd_id()] = slash::StringToUpper(tmp);
     }
     DestoryCmdTable(cmds);
     delete cmds;
   }
+  ~StatisticData() {
+    for (auto thread_stat : thread_stats) {
+      delete thread_stat;
+    }
+  }
 
   std::atomic<uint64_t> accumulative_connections;
-  std::unordered_map<std::string, std::atomic<uint64_t>> exec_count_table;
-  std::atomic<uint64_t> thread_querynum;
+  // indexed by Cmd::cmd_id()
+  std::vector<std::string> cmd_names;
+  slash::Mutex thread_stats_mu;
+  std::vector<ThreadStatisticData*> thread_stats;
   std::atomic<uint64_t> last_thread_querynum;
   std::atomic<uint64_t> last_sec_thread_querynum;
   std::atomic<uint64_t> last_time_us;
@@ -132,6 +220,7 @@ class PikaServer {
    * Table use
    */
   void InitTableStruct();
+  const StartupTiming& startup_timing() const { return startup_timing_; }
   std::shared_ptr<Table> GetTable(const std::string& table_name);
   std::set<uint32_t> GetTablePartitionIds(const std::string& table_name);
   bool IsBgSaving();
@@ -249,7 +338,10 @@ class PikaServer {
    * Monitor used
    */
   bool HasMonitorClients();
-  void AddMonitorMessage(const std::string &monitor_message);
+  void AddMonitorMessage(const std::string& table_name,
+                         const std::string& ip_port,
+                         const PikaCmdArgsType& argv);
+  uint64_t MonitorDroppedMessages();
   void AddMonitorClient(std::shared_ptr<PikaClientConn> client_ptr);
 
   /*
@@ -261,6 +353,29 @@ class PikaServer {
   void SlowlogObtain(int64_t number, std::vector<SlowlogEntry>* slowlogs);
   void SlowlogPushEntry(const PikaCmdArgsType& argv, int32_t time, int64_t duration);
 
+  /*
+   * Hotkey used
+   */
+  void HotKeyAdd(const std::string& table_name,
+                 const std::vector<std::string>& keys, bool is_write);
+  void HotKeyReset();
+  void HotKeyObtain(const std::string& table_name, size_t count,
+                    bool with_read, bool with_write,
+                    std::vector<HotKeyItem>* items);
+  uint64_t HotKeyWindowUs();
+
+  /*
+   * Slots migrate used
+   */
+  Status SlotsMigrateAsync(const MigrateDest& dest, const std::string& table_name,
+                           uint32_t slot, int64_t scan_keys);
+  void SlotsMigrateStatus(MigrateStatus* status);
+  void SlotsMigrateCancel();
+  Status SlotsMigrateKeys(const MigrateDest& dest, const std::string& table_name,
+                          std::shared_ptr<Partition> partition,
+                          const std::vector<std::string>& keys, int64_t* moved);
+  bool SlotsMigrateKeyInflight(const std::string& table_name, const std::string& key);
+
   /*
    * Statistic used
    */
@@ -270,8 +385,15 @@ class PikaServer {
   uint64_t accumulative_connections();
   void incr_accumulative_connections();
   void ResetLastSecQuerynum();
-  void UpdateQueryNumAndExecCountTable(const std::string& command);
+  void UpdateQueryNumAndExecCountTable(uint32_t cmd_id);
+  void UpdateCmdExecTime(uint32_t cmd_id, uint64_t duration_us);
   std::unordered_map<std::string, uint64_t> ServerExecCountTable();
+  std::unordered_map<std::string, CmdExecStat> ServerCmdExecStat();
+  void UpdateStageLatency(LatencyStage stage, uint64_t duration_us);
+  // merged over all threads, only commands which have been called
+  std::map<std::string, LatencySummary> ServerCmdLatency();
+  std::vector<LatencySummary> ServerStageLatency();
+  void ResetLatency();
 
   /*
    * Slave to Master communication used
@@ -315,10 +437,12 @@ class PikaServer {
   void AutoPurge();
   void AutoDeleteExpiredDump();
   void AutoKeepAliveRSync();
+  void AutoMergeHotKeys();
 
   std::string host_;
   int port_;
   time_t start_time_s_;
+  StartupTiming startup_timing_;
 
   blackwidow::BlackwidowOptions bw_options_;
   void InitBlackwidowOptions();
@@ -401,14 +525,24 @@ class PikaServer {
   /*
    * Slowlog used
    */
-  uint64_t slowlog_entry_id_;
-  pthread_rwlock_t slowlog_protector_;
-  std::list<SlowlogEntry> slowlog_list_;
+  SlowlogRing slowlog_;
+
+  /*
+   * Hotkey used
+   */
+  HotKeyTracker hotkey_tracker_;
+
+  /*
+   * Slots migrate used
+   */
+  PikaMigrateThread* pika_migrate_thread_;
 
   /*
    * Statistic used
    */
   StatisticData statistic_data_;
+  ThreadStatisticData* CurrentThreadStatistic();
+  uint64_t ThreadQueryNum();
 
   PikaServer(PikaServer &ps);
   void operator =(const PikaServer &ps);
@@ -7,6 +7,7 @@
 #define PIKA_SLOT_H_
 
 #include "include/pika_command.h"
+#include "include/pika_migrate_thread.h"
 
 class SlotsInfoCmd : public Cmd {
  public:
@@ -35,13 +36,21 @@ class SlotsHashKeyCmd : public Cmd {
 class SlotsMgrtSlotAsyncCmd : public Cmd {
  public:
   SlotsMgrtSlotAsyncCmd(const std::string& name, int arity, uint16_t flag)
-    : Cmd(name, arity, flag) {}
+    : Cmd(name, arity, flag), slot_num_(-1), keys_num_(0) {}
   virtual void Do(std::shared_ptr<Partition> partition = nullptr);
   virtual Cmd* Clone() override {
     return new SlotsMgrtSlotAsyncCmd(*this);
   }
  private:
   virtual void DoInitial() override;
+  MigrateDest dest_;
+  int64_t slot_num_;
+  int64_t keys_num_;
+  virtual void Clear() {
+    dest_ = MigrateDest();
+    slot_num_ = -1;
+    keys_num_ = 0;
+  }
 };
 
 class SlotsMgrtTagSlotAsyncCmd : public Cmd {
@@ -143,25 +152,37 @@ class SlotsMgrtAsyncCancelCmd : public Cmd {
 class SlotsMgrtSlotCmd : public Cmd {
  public:
   SlotsMgrtSlotCmd(const std::string& name, int arity, uint16_t flag)
-    : Cmd(name, arity, flag) {}
+    : Cmd(name, arity, flag), slot_num_(-1) {}
   virtual void Do(std::shared_ptr<Partition> partition = nullptr);
   virtual Cmd* Clone() override {
     return new SlotsMgrtSlotCmd(*this);
   }
  private:
   virtual void DoInitial() override;
+  MigrateDest dest_;
+  int64_t slot_num_;
+  virtual void Clear() {
+    dest_ = MigrateDest();
+    slot_num_ = -1;
+  }
 };
 
 class SlotsMgrtTagSlotCmd : public Cmd {
  public:
   SlotsMgrtTagSlotCmd(const std::string& name, int arity, uint16_t flag)
-    : Cmd(name, arity, flag) {}
+    : Cmd(name, arity, flag), slot_num_(-1) {}
   virtual void Do(std::shared_ptr<Partition> partition = nullptr);
   virtual Cmd* Clone() override {
     return new SlotsMgrtTagSlotCmd(*this);
   }
  private:
   virtual void DoInitial() override;
+  MigrateDest dest_;
+  int64_t slot_num_;
+  virtual void Clear() {
+    dest_ = MigrateDest();
+    slot_num_ = -1;
+  }
 };
 
 class SlotsMgrtOneCmd : public Cmd {
@@ -174,6 +195,12 @@ class SlotsMgrtOneCmd : public Cmd {
   }
  private:
   virtual void DoInitial() override;
+  MigrateDest dest_;
+  std::string key_;
+  virtual void Clear() {
+    dest_ = MigrateDest();
+    key_.clear();
+  }
 };
 
 class SlotsMgrtTagOneCmd : public Cmd {
@@ -186,6 +213,12 @@ class SlotsMgrtTagOneCmd : public Cmd {
   }
  private:
   virtual void DoInitial() override;
+  MigrateDest dest_;
+  std::string key_;
+  virtual void Clear() {
+    dest_ = MigrateDest();
+    key_.clear();
+  }
 };
 
 #endif  // PIKA_SLOT_H_
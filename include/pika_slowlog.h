@@ -0,0 +1,68 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_SLOWLOG_H_
+#define PIKA_SLOWLOG_H_
+
+#include <atomic>
+#include <vector>
+
+#include "include/pika_define.h"
+#include "include/pika_rwlock.h"
+
+/*
+ * Fixed capacity ring of the most recent slow commands.
+ *
+ * A pusher claims an entry id with one atomic increment, builds the
+ * entry in a thread local staging entry and swaps it into the slot of
+ * that id, so the buffers of the overwritten entry are reused by the
+ * next push of the same thread. Every slot has its own spin lock, which
+ * pushers of different ids never share.
+ *
+ * Capacity is the power of two above max_len, max_len is at most
+ * SLOWLOG_MAX_LEN. SetMaxLen grows or shrinks it under resize_lock_,
+ * which pushers and readers only take in shared mode.
+ */
+class SlowlogRing {
+ public:
+  explicit SlowlogRing(uint32_t max_len);
+  ~SlowlogRing();
+
+  // keep at most SLOWLOG_ENTRY_MAX_ARGC arguments, and at most
+  // max_arg_len bytes of every argument but the command name
+  void Push(const pink::RedisCmdArgsType& argv, int32_t start_time,
+            int64_t duration, uint32_t max_arg_len);
+  void SetMaxLen(uint32_t max_len);
+  void Reset();
+  uint32_t Len();
+  // newest first
+  void Obtain(int64_t number, std::vector<SlowlogEntry>* entries);
+
+ private:
+  struct Slot {
+    std::atomic<bool> busy;
+    SlowlogEntry entry;
+    Slot() : busy(false) { entry.id = -1; }
+    void Lock();
+    void Unlock() { busy.store(false, std::memory_order_release); }
+  };
+
+  // id of the oldest entry still visible, invoker holds resize_lock_
+  int64_t OldestId(int64_t next_id);
+
+  ScalableRWLock resize_lock_;
+  Slot* slots_;
+  size_t capacity_;
+  std::atomic<uint32_t> max_len_;
+  std::atomic<int64_t> next_id_;
+  // entries older than it have been reset
+  std::atomic<int64_t> reset_id_;
+
+  // No copying allowed
+  SlowlogRing(const SlowlogRing&);
+  void operator=(const SlowlogRing&);
+};
+
+#endif  // PIKA_SLOWLOG_H_
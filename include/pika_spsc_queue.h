@@ -0,0 +1,103 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_SPSC_QUEUE_H_
+#define PIKA_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/*
+ * Bounded lock free ring for exactly one producer thread and one
+ * consumer thread at a time. Producers running on different threads
+ * must be serialized by the caller (a mutex handoff is enough).
+ *
+ * Capacity is rounded up to a power of two.
+ */
+template <typename T>
+class SPSCQueue {
+ public:
+  explicit SPSCQueue(size_t capacity)
+      : capacity_(RoundUpPowerOfTwo(capacity)),
+        mask_(capacity_ - 1),
+        slots_(new T[capacity_]),
+        head_(0),
+        tail_(0) {
+  }
+  ~SPSCQueue() {
+    delete[] slots_;
+  }
+
+  // producer side
+  bool TryPush(T item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+  size_t WriteAvailable() const {
+    return capacity_ - (tail_.load(std::memory_order_relaxed)
+                        - head_.load(std::memory_order_acquire));
+  }
+
+  // consumer side, Front returns NULL if empty
+  T* Front() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return NULL;
+    }
+    return &slots_[head & mask_];
+  }
+  void Pop() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_release);
+  }
+  bool TryPop(T* item) {
+    T* front = Front();
+    if (front == NULL) {
+      return false;
+    }
+    *item = std::move(*front);
+    Pop();
+    return true;
+  }
+
+  // approximate when called concurrently with push or pop
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire)
+      - head_.load(std::memory_order_acquire);
+  }
+  size_t capacity() const { return capacity_; }
+
+ private:
+  static size_t RoundUpPowerOfTwo(size_t n) {
+    size_t res = 1;
+    while (res < n) {
+      res <<= 1;
+    }
+    return res;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  T* const slots_;
+  // keep the indices on their own cache lines
+  char pad0_[64];
+  std::atomic<size_t> head_;
+  char pad1_[64 - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_;
+  char pad2_[64 - sizeof(std::atomic<size_t>)];
+
+  // No copying allowed
+  SPSCQueue(const SPSCQueue&);
+  void operator=(const SPSCQueue&);
+};
+
+#endif  // PIKA_SPSC_QUEUE_H_
@@ -0,0 +1,91 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#ifndef PIKA_SYNC_WINDOW_H_
+#define PIKA_SYNC_WINDOW_H_
+
+#include <string>
+#include <vector>
+
+#include "include/pika_define.h"
+#include "include/pika_histogram.h"
+
+struct SyncWinItem {
+  BinlogOffset offset_;
+  bool acked_;
+  // when the item was queued for sending, unit microseconds
+  uint64_t send_time_;
+  bool operator==(const SyncWinItem& other) const {
+    if (offset_.filenum == other.offset_.filenum && offset_.offset == other.offset_.offset) {
+      return true;
+    }
+    return false;
+  }
+  SyncWinItem() : offset_(), acked_(false), send_time_(0) {
+  }
+  explicit SyncWinItem(const BinlogOffset& offset, uint64_t send_time = 0)
+    : offset_(offset), acked_(false), send_time_(send_time) {
+  }
+  SyncWinItem(uint32_t filenum, uint64_t offset, uint64_t send_time = 0)
+    : offset_(filenum, offset), acked_(false), send_time_(send_time) {
+  }
+  std::string ToString() const {
+    return offset_.ToString() + " acked: " + std::to_string(acked_);
+  }
+};
+
+/*
+ * Binlog offsets sent to a slave but not acked yet, in sending order.
+ *
+ * Kept in a ring which starts small and doubles when full, a window
+ * preallocated to sync-window-size would cost every slave partition
+ * sync-window-size * sizeof(SyncWinItem), 288KB for the default and
+ * 28MB for the max, mostly unused as acks keep the window short.
+ *
+ * Acks come back in sending order, so the acked range normally starts
+ * at the oldest item and is walked once to mark it: O(1) per acked
+ * item. Only an out of order ack binary searches for its start.
+ */
+class SyncWindow {
+ public:
+  SyncWindow();
+  void Push(const SyncWinItem& item);
+  // ack_latency is the time end_item spent between queued and acked,
+  // item_latency if not NULL gets the time of every item popped
+  bool Update(const SyncWinItem& start_item, const SyncWinItem& end_item,
+              BinlogOffset* acked_offset, uint64_t* ack_latency,
+              LatencyHistogram* item_latency);
+  // items which can still be sent within a window of window_size
+  int Remainings(int window_size) const;
+  size_t Size() const { return size_; }
+  std::string ToStringStatus() const {
+    if (size_ == 0) {
+      return "      Size: " + std::to_string(size_) + "\r\n";
+    } else {
+      std::string res;
+      res += "      Size: " + std::to_string(size_) + "\r\n";
+      res += ("      Begin_item: " + At(0).ToString() + "\r\n");
+      res += ("      End_item: " + At(size_ - 1).ToString() + "\r\n");
+      return res;
+    }
+  }
+ private:
+  // index 0 is the oldest item in the window
+  SyncWinItem& At(size_t index) {
+    return ring_[(head_ + index) & (ring_.size() - 1)];
+  }
+  const SyncWinItem& At(size_t index) const {
+    return ring_[(head_ + index) & (ring_.size() - 1)];
+  }
+  // position of the first item of an ack
+  bool LocateStart(const BinlogOffset& offset, size_t* index) const;
+  void Grow();
+
+  std::vector<SyncWinItem> ring_;
+  size_t head_;
+  size_t size_;
+};
+
+#endif  // PIKA_SYNC_WINDOW_H_
@@ -11,6 +11,8 @@
 #include "include/pika_command.h"
 #include "include/pika_partition.h"
 
+class IoThrottle;
+
 class Table : public std::enable_shared_from_this<Table>{
  public:
   Table(const std::string& table_name,
@@ -43,6 +45,7 @@ class Table : public std::enable_shared_from_this<Table>{
   void StopKeyScan();
   void ScanDatabase(const blackwidow::DataType& type);
   KeyScanInfo GetKeyScanInfo();
+  Status GetApproximateKeyNum(std::vector<blackwidow::KeyInfo>* key_infos);
   Status GetPartitionsKeyScanInfo(std::map<uint32_t, KeyScanInfo>* infos);
 
   // Compact use;
@@ -69,9 +72,12 @@ class Table : public std::enable_shared_from_this<Table>{
    * KeyScan use
    */
   static void DoKeyScan(void *arg);
+  // invoker need to hold key_scan_protector_
   void InitKeyScan();
   slash::Mutex key_scan_protector_;
   KeyScanInfo key_scan_info_;
+  // io of the scan in processing, NULL if none
+  IoThrottle* key_scan_throttle_;
 
   /*
    * No allowed copy and copy assign
@@ -11,6 +11,7 @@
 
 #include "slash/include/rsync.h"
 
+#include "include/pika_bitops.h"
 #include "include/pika_conf.h"
 #include "include/pika_server.h"
 #include "include/pika_rm.h"
@@ -449,7 +450,6 @@ std::string FlushallCmd::ToBinlog(
       uint64_t offset,
       BinlogType binlog_type) {
   std::string content;
-  content.reserve(RAW_ARGS_LEN);
   RedisAppendLen(content, 1, "*");
 
   // to flushdb cmd
@@ -599,11 +599,14 @@ const std::string InfoCmd::kServerSection = "server";
 const std::string InfoCmd::kClientsSection = "clients";
 const std::string InfoCmd::kStatsSection = "stats";
 const std::string InfoCmd::kExecCountSection= "command_exec_count";
+const std::string InfoCmd::kCommandStatsSection = "commandstats";
 const std::string InfoCmd::kCPUSection = "cpu";
 const std::string InfoCmd::kReplicationSection = "replication";
 const std::string InfoCmd::kKeyspaceSection = "keyspace";
 const std::string InfoCmd::kDataSection = "data";
 const std::string InfoCmd::kDebugSection = "debug";
+const std::string InfoCmd::kHotKeysSection = "hotkeys";
+const std::string InfoCmd::kLatencyStatsSection = "latencystats";
 
 void InfoCmd::DoInitial() {
   size_t argc = argv_.size();
@@ -626,6 +629,8 @@ void InfoCmd::DoInitial() {
     info_section_ = kInfoStats;
   } else if (!strcasecmp(argv_[1].data(), kExecCountSection.data())) {
     info_section_ = kInfoExecCount;
+  } else if (!strcasecmp(argv_[1].data(), kCommandStatsSection.data())) {
+    info_section_ = kInfoCommandStats;
   } else if (!strcasecmp(argv_[1].data(), kCPUSection.data())) {
     info_section_ = kInfoCPU;
   } else if (!strcasecmp(argv_[1].data(), kReplicationSection.data())) {
@@ -636,10 +641,11 @@ void InfoCmd::DoInitial() {
       LogCommand();
       return;
     }
-    // info keyspace [ 0 | 1 | off ]
+    // info keyspace [ 0 | 1 | off | approx ]
     // info keyspace 1 db0,db1
     // info keyspace 0 db0,db1
     // info keyspace off db0,db1
+    // info keyspace approx db0,db1
     if (argv_[2] == "1") {
       if (g_pika_server->IsCompacting()) {
         res_.SetRes(CmdRes::kErrOther, "The compact operation is executing, Try again later");
@@ -648,6 +654,8 @@ void InfoCmd::DoInitial() {
       }
     } else if (argv_[2] == "off") {
       off_ = true;
+    } else if (argv_[2] == "approx") {
+      approximate_ = true;
     } else if (argv_[2] != "0") {
       res_.SetRes(CmdRes::kSyntaxErr);
     }
@@ -670,6 +678,10 @@ void InfoCmd::DoInitial() {
     info_section_ = kInfoData;
   } else if (!strcasecmp(argv_[1].data(), kDebugSection.data())) {
     info_section_ = kInfoDebug;
+  } else if (!strcasecmp(argv_[1].data(), kHotKeysSection.data())) {
+    info_section_ = kInfoHotKeys;
+  } else if (!strcasecmp(argv_[1].data(), kLatencyStatsSection.data())) {
+    info_section_ = kInfoLatencyStats;
   } else {
     info_section_ = kInfoErr;
   }
@@ -707,11 +719,17 @@ void InfoCmd::Do(std::shared_ptr<Partition> partition) {
       info.append("\r\n");
       InfoExecCount(info);
       info.append("\r\n");
+      InfoCommandStats(info);
+      info.append("\r\n");
+      InfoLatencyStats(info);
+      info.append("\r\n");
       InfoCPU(info);
       info.append("\r\n");
       InfoReplication(info);
       info.append("\r\n");
       InfoKeyspace(info);
+      info.append("\r\n");
+      InfoHotKeys(info);
       break;
     case kInfoServer:
       InfoServer(info);
@@ -725,6 +743,9 @@ void InfoCmd::Do(std::shared_ptr<Partition> partition) {
     case kInfoExecCount:
       InfoExecCount(info);
       break;
+    case kInfoCommandStats:
+      InfoCommandStats(info);
+      break;
     case kInfoCPU:
       InfoCPU(info);
       break;
@@ -740,6 +761,12 @@ void InfoCmd::Do(std::shared_ptr<Partition> partition) {
     case kInfoDebug:
       InfoDebug(info);
       break;
+    case kInfoHotKeys:
+      InfoHotKeys(info);
+      break;
+    case kInfoLatencyStats:
+      InfoLatencyStats(info);
+      break;
     default:
       //kInfoErr is nothing
       break;
@@ -779,6 +806,8 @@ void InfoCmd::InfoServer(std::string& info) {
   tmp_stream << "uptime_in_days:" << (current_time_s / (24*3600) - g_pika_server->start_time_s() / (24*3600) + 1) << "\r\n";
   tmp_stream << "config_file:" << g_pika_conf->conf_path() << "\r\n";
   tmp_stream << "server_id:" << g_pika_conf->server_id() << "\r\n";
+  tmp_stream << "startup_timing:" << g_pika_server->startup_timing().ToString() << "\r\n";
+  tmp_stream << "bitops_kernel:" << BitmapKernelName() << "\r\n";
 
   info.append(tmp_stream.str());
 }
@@ -802,6 +831,7 @@ void InfoCmd::InfoStats(std::string& info) {
   tmp_stream << "is_compact:" << (g_pika_server->IsCompacting() ? "Yes" : "No") << "\r\n";
   tmp_stream << "compact_cron:" << g_pika_conf->compact_cron() << "\r\n";
   tmp_stream << "compact_interval:" << g_pika_conf->compact_interval() << "\r\n";
+  tmp_stream << "monitor_dropped_messages:" << g_pika_server->MonitorDroppedMessages() << "\r\n";
 
   info.append(tmp_stream.str());
 }
@@ -820,6 +850,73 @@ void InfoCmd::InfoExecCount(std::string& info) {
   info.append(tmp_stream.str());
 }
 
+void InfoCmd::InfoCommandStats(std::string& info) {
+  std::stringstream tmp_stream;
+  tmp_stream << "# Commandstats\r\n";
+
+  std::unordered_map<std::string, CmdExecStat> command_stats = g_pika_server->ServerCmdExecStat();
+  for (const auto& item : command_stats) {
+    if (item.second.calls == 0) {
+      continue;
+    }
+    std::string cmd_name = item.first;
+    tmp_stream << "cmdstat_" << slash::StringToLower(cmd_name)
+      << ":calls=" << item.second.calls
+      << ",usec=" << item.second.usecs
+      << ",usec_per_call=" << setiosflags(std::ios::fixed) << std::setprecision(2)
+      << static_cast<double>(item.second.usecs) / item.second.calls << "\r\n";
+  }
+  info.append(tmp_stream.str());
+}
+
+void InfoCmd::InfoLatencyStats(std::string& info) {
+  std::stringstream tmp_stream;
+  tmp_stream << "# Latencystats\r\n";
+
+  std::vector<LatencySummary> stages = g_pika_server->ServerStageLatency();
+  for (size_t stage = 0; stage < stages.size(); ++stage) {
+    const LatencySummary& summary = stages[stage];
+    tmp_stream << "latency_stage_usec_" << LatencyStageName(static_cast<LatencyStage>(stage))
+      << ":count=" << summary.count << ",avg=" << summary.avg
+      << ",p50=" << summary.p50 << ",p99=" << summary.p99
+      << ",p999=" << summary.p999 << ",max=" << summary.max << "\r\n";
+  }
+  std::map<std::string, LatencySummary> cmd_latency = g_pika_server->ServerCmdLatency();
+  for (const auto& item : cmd_latency) {
+    std::string cmd_name = item.first;
+    const LatencySummary& summary = item.second;
+    tmp_stream << "latency_percentiles_usec_" << slash::StringToLower(cmd_name)
+      << ":p50=" << summary.p50 << ",p99=" << summary.p99
+      << ",p999=" << summary.p999 << ",max=" << summary.max << "\r\n";
+  }
+  info.append(tmp_stream.str());
+}
+
+void InfoCmd::InfoHotKeys(std::string& info) {
+  std::stringstream tmp_stream;
+  tmp_stream << "# Hotkeys\r\n";
+  tmp_stream << "hotkey_sample_rate:" << g_pika_conf->hotkey_sample_rate() << "\r\n";
+  tmp_stream << "hotkey_window_sec:" << g_pika_server->HotKeyWindowUs() / 1000000 << "\r\n";
+
+  // the hottest kHotKeyInfoNum keys of every table, reads and writes apart
+  std::vector<HotKeyItem> items;
+  g_pika_server->HotKeyObtain("", SIZE_MAX, true, true, &items);
+  std::map<std::string, int> printed;
+  for (const auto& item : items) {
+    std::string prefix = item.table_name + (item.is_write ? "_write" : "_read");
+    int& index = printed[prefix];
+    if (index >= kHotKeyInfoNum) {
+      continue;
+    }
+    tmp_stream << "hotkey_" << prefix << "_" << index++
+      << ":partition=" << item.partition_id
+      << ",key=" << slash::ToRead(item.key)
+      << ",ops_per_sec=" << item.ops_per_sec
+      << ",score=" << item.score << "\r\n";
+  }
+  info.append(tmp_stream.str());
+}
+
 void InfoCmd::InfoCPU(std::string& info) {
   struct rusage self_ru, c_ru;
   getrusage(RUSAGE_SELF, &self_ru);
@@ -845,6 +942,22 @@ void InfoCmd::InfoCPU(std::string& info) {
   info.append(tmp_stream.str());
 }
 
+// queue depth and busy time of every slave side replication worker
+static void AppendReplWorkerInfo(std::stringstream& tmp_stream) {
+  std::vector<ReplWorkerStat> binlog_stats, db_stats;
+  g_pika_rm->ReplWorkerStats(&binlog_stats, &db_stats);
+  for (size_t i = 0; i < binlog_stats.size() + db_stats.size(); ++i) {
+    bool is_binlog = i < binlog_stats.size();
+    const ReplWorkerStat& stat = is_binlog ? binlog_stats[i] : db_stats[i - binlog_stats.size()];
+    tmp_stream << (is_binlog ? "repl_binlog_worker_" : "repl_db_worker_")
+      << (is_binlog ? i : i - binlog_stats.size())
+      << ":queue_depth=" << stat.queue_depth
+      << ",busy_usec=" << stat.busy_us
+      << ",tasks=" << stat.tasks
+      << ",steals=" << stat.steals << "\r\n";
+  }
+}
+
 void InfoCmd::InfoShardingReplication(std::string& info) {
   int role = 0;
   std::string slave_list_string;
@@ -888,6 +1001,12 @@ void InfoCmd::InfoShardingReplication(std::string& info) {
     case PIKA_ROLE_MASTER :
       tmp_stream << "connected_slaves:" << slave_num << "\r\n" << slave_list_string;
   }
+  tmp_stream << "binlog_cache_hits:" << g_pika_rm->BinlogCacheHits() << "\r\n";
+  tmp_stream << "binlog_cache_misses:" << g_pika_rm->BinlogCacheMisses() << "\r\n";
+  tmp_stream << "binlog_sync_bytes_raw:" << g_pika_rm->BinlogSyncRawBytes() << "\r\n";
+  tmp_stream << "binlog_sync_bytes_sent:" << g_pika_rm->BinlogSyncSentBytes() << "\r\n";
+  tmp_stream << "binlog_ack_latency_us:" << g_pika_rm->BinlogAckLatency() << "\r\n";
+  AppendReplWorkerInfo(tmp_stream);
   info.append(tmp_stream.str());
 }
 
@@ -975,6 +1094,12 @@ void InfoCmd::InfoReplication(std::string& info) {
     case PIKA_ROLE_MASTER :
       tmp_stream << "connected_slaves:" << g_pika_server->GetSlaveListString(slaves_list_str) << "\r\n" << slaves_list_str;
   }
+  tmp_stream << "binlog_cache_hits:" << g_pika_rm->BinlogCacheHits() << "\r\n";
+  tmp_stream << "binlog_cache_misses:" << g_pika_rm->BinlogCacheMisses() << "\r\n";
+  tmp_stream << "binlog_sync_bytes_raw:" << g_pika_rm->BinlogSyncRawBytes() << "\r\n";
+  tmp_stream << "binlog_sync_bytes_sent:" << g_pika_rm->BinlogSyncSentBytes() << "\r\n";
+  tmp_stream << "binlog_ack_latency_us:" << g_pika_rm->BinlogAckLatency() << "\r\n";
+  AppendReplWorkerInfo(tmp_stream);
 
 
   Status s;
@@ -987,7 +1112,14 @@ void InfoCmd::InfoReplication(std::string& info) {
       p_item.second->logger()->GetProducerStatus(&filenum, &offset);
       tmp_stream << p_item.second->GetPartitionName() << " binlog_offset=" << filenum << " " << offset;
       s = g_pika_rm->GetSafetyPurgeBinlogFromSMP(p_item.second->GetTableName(), p_item.second->GetPartitionId(), &safety_purge);
-      tmp_stream << ",safety_purge=" << (s.ok() ? safety_purge : "error") << "\r\n";
+      tmp_stream << ",safety_purge=" << (s.ok() ? safety_purge : "error");
+      if (host_role & PIKA_ROLE_SLAVE) {
+        std::shared_ptr<SyncSlavePartition> slave_partition =
+          g_pika_rm->GetSyncSlavePartitionByName(
+              PartitionInfo(p_item.second->GetTableName(), p_item.second->GetPartitionId()));
+        tmp_stream << ",apply_lag=" << (slave_partition ? slave_partition->PendingApply() : 0);
+      }
+      tmp_stream << "\r\n";
     }
   }
 
@@ -1012,6 +1144,20 @@ void InfoCmd::InfoKeyspace(std::string& info) {
     if (keyspace_scan_tables_.empty()
       || keyspace_scan_tables_.find(table_item.first) != keyspace_scan_tables_.end()) {
       table_name = table_item.second->GetTableName();
+      if (approximate_) {
+        Status s = table_item.second->GetApproximateKeyNum(&key_infos);
+        if (!s.ok()) {
+          info.append("info keyspace error\r\n");
+          return;
+        }
+        tmp_stream << "# Approximate, estimated from sst properties\r\n";
+        tmp_stream << table_name << " Strings_keys=" << key_infos[0].keys << "\r\n";
+        tmp_stream << table_name << " Hashes_keys=" << key_infos[1].keys << "\r\n";
+        tmp_stream << table_name << " Lists_keys=" << key_infos[2].keys << "\r\n";
+        tmp_stream << table_name << " Zsets_keys=" << key_infos[3].keys << "\r\n";
+        tmp_stream << table_name << " Sets_keys=" << key_infos[4].keys << "\r\n\r\n";
+        continue;
+      }
       key_scan_info = table_item.second->GetKeyScanInfo();
       key_infos = key_scan_info.key_infos;
       duration = key_scan_info.duration;
@@ -1024,6 +1170,23 @@ void InfoCmd::InfoKeyspace(std::string& info) {
         tmp_stream << "# Duration: " << "In Waiting\r\n";
       } else if (duration == -1) {
         tmp_stream << "# Duration: " << "In Processing\r\n";
+        int32_t elapsed = time(NULL) - key_scan_info.start_time;
+        uint64_t keys_per_sec = elapsed > 0 ? key_scan_info.keys_scanned / elapsed : 0;
+        uint64_t bytes_per_sec = elapsed > 0 ? key_scan_info.bytes_read / elapsed : 0;
+        tmp_stream << "# Progress: partitions=" << key_scan_info.partitions_done
+          << "/" << key_scan_info.partitions_total
+          << ", keys=" << key_scan_info.keys_scanned
+          << ", keys_per_sec=" << keys_per_sec
+          << ", bytes_read=" << key_scan_info.bytes_read
+          << ", bytes_per_sec=" << bytes_per_sec;
+        if (key_scan_info.partitions_done > 0) {
+          // assume the remaining partitions are as large as the scanned ones
+          uint64_t eta = static_cast<uint64_t>(elapsed)
+            * (key_scan_info.partitions_total - key_scan_info.partitions_done)
+            / key_scan_info.partitions_done;
+          tmp_stream << ", eta=" << eta << "s";
+        }
+        tmp_stream << "\r\n";
       } else if (duration >= 0) {
         tmp_stream << "# Duration: " << std::to_string(duration) + "s" << "\r\n";
       }
@@ -1434,12 +1597,24 @@ void ConfigCmd::ConfigGet(std::string &ret) {
     EncodeInt32(&config_body, g_pika_conf->slowlog_max_len());
   }
 
+  if (slash::stringmatch(pattern.data(), "slowlog-max-arg-len", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "slowlog-max-arg-len");
+    EncodeInt32(&config_body, g_pika_conf->slowlog_max_arg_len());
+  }
+
   if (slash::stringmatch(pattern.data(), "write-binlog", 1)) {
     elements += 2;
     EncodeString(&config_body, "write-binlog");
     EncodeString(&config_body, g_pika_conf->write_binlog() ? "yes" : "no");
   }
 
+  if (slash::stringmatch(pattern.data(), "binlog-group-commit", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "binlog-group-commit");
+    EncodeString(&config_body, g_pika_conf->binlog_group_commit() ? "yes" : "no");
+  }
+
   if (slash::stringmatch(pattern.data(), "binlog-file-size", 1)) {
     elements += 2;
     EncodeString(&config_body, "binlog-file-size");
@@ -1470,12 +1645,24 @@ void ConfigCmd::ConfigGet(std::string &ret) {
     EncodeInt64(&config_body, g_pika_conf->max_client_response_size());
   }
 
+  if (slash::stringmatch(pattern.data(), "reply-stream-budget", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "reply-stream-budget");
+    EncodeInt64(&config_body, g_pika_conf->reply_stream_budget());
+  }
+
   if (slash::stringmatch(pattern.data(), "compression", 1)) {
     elements += 2;
     EncodeString(&config_body, "compression");
     EncodeString(&config_body, g_pika_conf->compression());
   }
 
+  if (slash::stringmatch(pattern.data(), "replication-compression", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "replication-compression");
+    EncodeString(&config_body, g_pika_conf->replication_compression());
+  }
+
   if (slash::stringmatch(pattern.data(), "db-sync-path", 1)) {
     elements += 2;
     EncodeString(&config_body, "db-sync-path");
@@ -1524,6 +1711,30 @@ void ConfigCmd::ConfigGet(std::string &ret) {
     EncodeInt32(&config_body, g_pika_conf->sync_window_size());
   }
 
+  if (slash::stringmatch(pattern.data(), "keyscan-concurrency", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "keyscan-concurrency");
+    EncodeInt32(&config_body, g_pika_conf->keyscan_concurrency());
+  }
+
+  if (slash::stringmatch(pattern.data(), "keyscan-bytes-per-sec", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "keyscan-bytes-per-sec");
+    EncodeInt64(&config_body, g_pika_conf->keyscan_bytes_per_sec());
+  }
+
+  if (slash::stringmatch(pattern.data(), "hotkey-sample-rate", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "hotkey-sample-rate");
+    EncodeInt32(&config_body, g_pika_conf->hotkey_sample_rate());
+  }
+
+  if (slash::stringmatch(pattern.data(), "bitops-kernel", 1)) {
+    elements += 2;
+    EncodeString(&config_body, "bitops-kernel");
+    EncodeString(&config_body, g_pika_conf->bitops_kernel());
+  }
+
   if (slash::stringmatch(pattern.data(), "max-conn-rbuf-size", 1)) {
     elements += 2;
     EncodeString(&config_body, "max-conn-rbuf-size");
@@ -1539,7 +1750,7 @@ void ConfigCmd::ConfigGet(std::string &ret) {
 void ConfigCmd::ConfigSet(std::string& ret) {
   std::string set_item = config_args_v_[1];
   if (set_item == "*") {
-    ret = "*23\r\n";
+    ret = "*29\r\n";
     EncodeString(&ret, "timeout");
     EncodeString(&ret, "requirepass");
     EncodeString(&ret, "masterauth");
@@ -1554,15 +1765,22 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     EncodeString(&ret, "slowlog-write-errorlog");
     EncodeString(&ret, "slowlog-log-slower-than");
     EncodeString(&ret, "slowlog-max-len");
+    EncodeString(&ret, "slowlog-max-arg-len");
     EncodeString(&ret, "write-binlog");
+    EncodeString(&ret, "binlog-group-commit");
     EncodeString(&ret, "max-cache-statistic-keys");
     EncodeString(&ret, "small-compaction-threshold");
     EncodeString(&ret, "max-client-response-size");
+    EncodeString(&ret, "reply-stream-budget");
     EncodeString(&ret, "db-sync-speed");
     EncodeString(&ret, "compact-cron");
     EncodeString(&ret, "compact-interval");
     EncodeString(&ret, "slave-priority");
     EncodeString(&ret, "sync-window-size");
+    EncodeString(&ret, "keyscan-concurrency");
+    EncodeString(&ret, "keyscan-bytes-per-sec");
+    EncodeString(&ret, "hotkey-sample-rate");
+    EncodeString(&ret, "bitops-kernel");
     return;
   }
   long int ival;
@@ -1656,9 +1874,20 @@ void ConfigCmd::ConfigSet(std::string& ret) {
       ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'slowlog-max-len'\r\n";
       return;
     }
+    if (ival > SLOWLOG_MAX_LEN) {
+      ret = "-ERR Argument exceed range \'" + value + "\' for CONFIG SET 'slowlog-max-len'\r\n";
+      return;
+    }
     g_pika_conf->SetSlowlogMaxLen(ival);
     g_pika_server->SlowlogTrim();
     ret = "+OK\r\n";
+  } else if (set_item == "slowlog-max-arg-len") {
+    if (!slash::string2l(value.data(), value.size(), &ival) || ival < 0 || ival > INT32_MAX) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'slowlog-max-arg-len'\r\n";
+      return;
+    }
+    g_pika_conf->SetSlowlogMaxArgLen(ival);
+    ret = "+OK\r\n";
   } else if (set_item == "max-cache-statistic-keys") {
     if (!slash::string2l(value.data(), value.size(), &ival) || ival < 0) {
       ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'max-cache-statistic-keys'\r\n";
@@ -1682,6 +1911,13 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     }
     g_pika_conf->SetMaxClientResponseSize(ival);
     ret = "+OK\r\n";
+  } else if (set_item == "reply-stream-budget") {
+    if (!slash::string2l(value.data(), value.size(), &ival) || ival < 0 || ival > INT32_MAX) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'reply-stream-budget'\r\n";
+      return;
+    }
+    g_pika_conf->SetReplyStreamBudget(ival);
+    ret = "+OK\r\n";
   } else if (set_item == "write-binlog") {
     int role = g_pika_server->role();
     if (role == PIKA_ROLE_SLAVE) {
@@ -1694,6 +1930,13 @@ void ConfigCmd::ConfigSet(std::string& ret) {
       g_pika_conf->SetWriteBinlog(value);
       ret = "+OK\r\n";
     }
+  } else if (set_item == "binlog-group-commit") {
+    if (value != "yes" && value != "no") {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'binlog-group-commit'\r\n";
+      return;
+    }
+    g_pika_conf->SetBinlogGroupCommit(value == "yes");
+    ret = "+OK\r\n";
   } else if (set_item == "db-sync-speed") {
     if (!slash::string2l(value.data(), value.size(), &ival)) {
       ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'db-sync-speed(MB)'\r\n";
@@ -1776,6 +2019,43 @@ void ConfigCmd::ConfigSet(std::string& ret) {
     }
     g_pika_conf->SetSyncWindowSize(ival);
     ret = "+OK\r\n";
+  } else if (set_item == "keyscan-concurrency") {
+    if (!slash::string2l(value.data(), value.size(), &ival)) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'keyscan-concurrency'\r\n";
+      return;
+    }
+    if (ival <= 0 || ival > kKeyscanMaxConcurrency) {
+      ret = "-ERR Argument exceed range \'" + value + "\' for CONFIG SET 'keyscan-concurrency'\r\n";
+      return;
+    }
+    g_pika_conf->SetKeyscanConcurrency(ival);
+    ret = "+OK\r\n";
+  } else if (set_item == "keyscan-bytes-per-sec") {
+    if (!slash::string2l(value.data(), value.size(), &ival) || ival < 0) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'keyscan-bytes-per-sec'\r\n";
+      return;
+    }
+    g_pika_conf->SetKeyscanBytesPerSec(ival);
+    ret = "+OK\r\n";
+  } else if (set_item == "hotkey-sample-rate") {
+    if (!slash::string2l(value.data(), value.size(), &ival) || ival < 0 || ival > INT32_MAX) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'hotkey-sample-rate'\r\n";
+      return;
+    }
+    g_pika_conf->SetHotkeySampleRate(ival);
+    ret = "+OK\r\n";
+  } else if (set_item == "bitops-kernel") {
+    BitmapKernel kernel;
+    if (!BitmapKernelByName(value.c_str(), &kernel)) {
+      ret = "-ERR Invalid argument \'" + value + "\' for CONFIG SET 'bitops-kernel'\r\n";
+      return;
+    }
+    if (!BitmapSetKernel(kernel)) {
+      ret = "-ERR bitops-kernel " + value + " is not supported by this CPU\r\n";
+      return;
+    }
+    g_pika_conf->SetBitopsKernel(value);
+    ret = "+OK\r\n";
   } else {
     ret = "-ERR Unsupported CONFIG parameter: " + set_item + "\r\n";
   }
@@ -1809,7 +2089,6 @@ void MonitorCmd::Do(std::shared_ptr<Partition> partition) {
     std::dynamic_pointer_cast<PikaClientConn>(conn_repl)->server_thread()->MoveConnOut(conn_repl->fd());
   assert(conn.get() == conn_repl.get());
   g_pika_server->AddMonitorClient(std::dynamic_pointer_cast<PikaClientConn>(conn));
-  g_pika_server->AddMonitorMessage("OK");
   return; // Monitor thread will return "OK"
 }
 
@@ -2008,6 +2287,131 @@ void SlowlogCmd::Do(std::shared_ptr<Partition> partition) {
   return;
 }
 
+// HOTKEYS GET [count] [READ | WRITE | ALL] [table]
+// HOTKEYS RESET
+void HotKeysCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameHotKeys);
+    return;
+  }
+  if (argv_.size() == 2 && !strcasecmp(argv_[1].data(), "reset")) {
+    condition_ = HotKeysCmd::kRESET;
+  } else if (argv_.size() <= 5 && !strcasecmp(argv_[1].data(), "get")) {
+    condition_ = HotKeysCmd::kGET;
+    if (argv_.size() >= 3
+      && (!slash::string2l(argv_[2].data(), argv_[2].size(), &number_) || number_ < 0)) {
+      res_.SetRes(CmdRes::kInvalidInt);
+      return;
+    }
+    if (argv_.size() >= 4) {
+      if (!strcasecmp(argv_[3].data(), "read")) {
+        with_write_ = false;
+      } else if (!strcasecmp(argv_[3].data(), "write")) {
+        with_read_ = false;
+      } else if (strcasecmp(argv_[3].data(), "all")) {
+        res_.SetRes(CmdRes::kSyntaxErr);
+        return;
+      }
+    }
+    if (argv_.size() == 5) {
+      if (!g_pika_server->IsTableExist(argv_[4])) {
+        res_.SetRes(CmdRes::kInvalidTable, argv_[4]);
+        return;
+      }
+      table_name_filter_ = argv_[4];
+    }
+  } else {
+    res_.SetRes(CmdRes::kErrOther, "Unknown HOTKEYS subcommand or wrong # of args. Try GET, RESET.");
+    return;
+  }
+}
+
+void HotKeysCmd::Do(std::shared_ptr<Partition> partition) {
+  if (condition_ == HotKeysCmd::kRESET) {
+    g_pika_server->HotKeyReset();
+    res_.SetRes(CmdRes::kOk);
+    return;
+  }
+  std::vector<HotKeyItem> items;
+  g_pika_server->HotKeyObtain(table_name_filter_, number_,
+                              with_read_, with_write_, &items);
+  res_.AppendArrayLen(items.size());
+  for (const auto& item : items) {
+    res_.AppendArrayLen(6);
+    res_.AppendString(item.table_name);
+    res_.AppendInteger(item.partition_id);
+    res_.AppendString(item.key);
+    res_.AppendString(item.is_write ? "write" : "read");
+    res_.AppendInteger(item.ops_per_sec);
+    res_.AppendInteger(item.score);
+  }
+}
+
+// LATENCY HISTOGRAM [command ...]
+// LATENCY STAGES
+// LATENCY RESET
+void LatencyCmd::DoInitial() {
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameLatency);
+    return;
+  }
+  if (!strcasecmp(argv_[1].data(), "histogram")) {
+    condition_ = LatencyCmd::kHISTOGRAM;
+    for (size_t i = 2; i < argv_.size(); ++i) {
+      std::string cmd_name = argv_[i];
+      cmd_names_.insert(slash::StringToUpper(cmd_name));
+    }
+  } else if (argv_.size() == 2 && !strcasecmp(argv_[1].data(), "stages")) {
+    condition_ = LatencyCmd::kSTAGES;
+  } else if (argv_.size() == 2 && !strcasecmp(argv_[1].data(), "reset")) {
+    condition_ = LatencyCmd::kRESET;
+  } else {
+    res_.SetRes(CmdRes::kErrOther, "Unknown LATENCY subcommand or wrong # of args. Try HISTOGRAM, STAGES, RESET.");
+    return;
+  }
+}
+
+void LatencyCmd::Do(std::shared_ptr<Partition> partition) {
+  if (condition_ == LatencyCmd::kRESET) {
+    g_pika_server->ResetLatency();
+    res_.SetRes(CmdRes::kOk);
+  } else if (condition_ == LatencyCmd::kSTAGES) {
+    std::vector<LatencySummary> stages = g_pika_server->ServerStageLatency();
+    res_.AppendArrayLen(stages.size());
+    for (size_t stage = 0; stage < stages.size(); ++stage) {
+      AppendSummary(LatencyStageName(static_cast<LatencyStage>(stage)), stages[stage]);
+    }
+  } else {
+    std::map<std::string, LatencySummary> cmd_latency = g_pika_server->ServerCmdLatency();
+    if (!cmd_names_.empty()) {
+      for (auto iter = cmd_latency.begin(); iter != cmd_latency.end();) {
+        if (cmd_names_.find(iter->first) == cmd_names_.end()) {
+          iter = cmd_latency.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+    }
+    res_.AppendArrayLen(cmd_latency.size());
+    for (const auto& item : cmd_latency) {
+      std::string cmd_name = item.first;
+      AppendSummary(slash::StringToLower(cmd_name), item.second);
+    }
+  }
+}
+
+// [name, count, avg, p50, p99, p999, max], times in microseconds
+void LatencyCmd::AppendSummary(const std::string& name, const LatencySummary& summary) {
+  res_.AppendArrayLen(7);
+  res_.AppendString(name);
+  res_.AppendInteger(summary.count);
+  res_.AppendInteger(summary.avg);
+  res_.AppendInteger(summary.p50);
+  res_.AppendInteger(summary.p99);
+  res_.AppendInteger(summary.p999);
+  res_.AppendInteger(summary.max);
+}
+
 void PaddingCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNamePadding);
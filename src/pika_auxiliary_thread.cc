@@ -12,11 +12,36 @@
 extern PikaServer* g_pika_server;
 extern PikaReplicaManager* g_pika_rm;
 
+// upper bound of sleeping when nothing is signaled,
+// timeouts and the slave state machine are driven by it
+#define kAuxiliaryIdleWaitMs 100
+
 PikaAuxiliaryThread::~PikaAuxiliaryThread() {
   StopThread();
   LOG(INFO) << "PikaAuxiliary thread " << thread_id() << " exit!!!";
 }
 
+void PikaAuxiliaryThread::Wakeup() {
+  pending_.store(true);
+  if (sleeping_.load()) {
+    mu_.Lock();
+    cv_.Signal();
+    mu_.Unlock();
+  }
+}
+
+void PikaAuxiliaryThread::WaitForWork() {
+  mu_.Lock();
+  sleeping_.store(true);
+  // a Wakeup which sees sleeping_ false has already set pending_
+  if (!pending_.exchange(false)) {
+    cv_.TimedWait(kAuxiliaryIdleWaitMs);
+  }
+  sleeping_.store(false);
+  pending_.store(false);
+  mu_.Unlock();
+}
+
 void* PikaAuxiliaryThread::ThreadMain() {
   while (!should_stop()) {
     if (g_pika_conf->classic_mode()) {
@@ -42,10 +67,7 @@ void* PikaAuxiliaryThread::ThreadMain() {
     // send to peer
     int res = g_pika_server->SendToPeer();
     if (!res) {
-      // sleep 100 ms
-      mu_.Lock();
-      cv_.TimedWait(100);
-      mu_.Unlock();
+      WaitForWork();
     } else {
       //LOG_EVERY_N(INFO, 1000) << "Consume binlog number " << res;
     }
@@ -164,6 +164,20 @@ Status Binlog::Put(const std::string &item) {
 
 // Note: mutex lock should be held
 Status Binlog::Put(const char* item, int len) {
+  Status s = Append(item, len);
+  if (s.ok()) {
+    s = Sync();
+  }
+  return s;
+}
+
+// Note: mutex lock should be held
+Status Binlog::Append(const std::string &item) {
+  return Append(item.c_str(), item.size());
+}
+
+// Note: mutex lock should be held
+Status Binlog::Append(const char* item, int len) {
   Status s;
 
   /* Check to roll log file */
@@ -188,14 +202,23 @@ Status Binlog::Put(const char* item, int len) {
   int pro_offset;
   s = Produce(Slice(item, len), &pro_offset);
   if (s.ok()) {
-    slash::RWLock(&(version_->rwlock_), true);
+    slash::RWLock l(&(version_->rwlock_), true);
     version_->pro_offset_ = pro_offset;
     version_->logic_id_++;
-    version_->StableSave();
   }
 
   return s;
 }
+
+// Note: mutex lock should be held
+Status Binlog::Sync() {
+  Status s = queue_->Flush();
+  if (s.ok()) {
+    slash::RWLock l(&(version_->rwlock_), true);
+    version_->StableSave();
+  }
+  return s;
+}
  
 Status Binlog::EmitPhysicalRecord(RecordType t, const char *ptr, size_t n, int *temp_pro_offset) {
     Status s;
@@ -220,9 +243,6 @@ Status Binlog::EmitPhysicalRecord(RecordType t, const char *ptr, size_t n, int *
     s = queue_->Append(Slice(buf, kHeaderSize));
     if (s.ok()) {
         s = queue_->Append(Slice(ptr, n));
-        if (s.ok()) {
-            s = queue_->Flush();
-        }
     }
     block_offset_ += static_cast<int>(kHeaderSize + n);
 
@@ -0,0 +1,83 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_binlog_cache.h"
+
+#include <algorithm>
+
+BinlogCache::BinlogCache(uint64_t capacity)
+    : capacity_(capacity),
+      size_(0) {
+  pthread_rwlock_init(&rwlock_, NULL);
+}
+
+BinlogCache::~BinlogCache() {
+  pthread_rwlock_destroy(&rwlock_);
+}
+
+void BinlogCache::Append(const BinlogOffset& start, const BinlogOffset& end,
+                         const std::string& binlog) {
+  if (capacity_ == 0) {
+    return;
+  }
+  slash::RWLock l(&rwlock_, true);
+  if (!items_.empty() && !(items_.back().end_offset == start)) {
+    // binlog was written or reset bypassing the cache
+    items_.clear();
+    size_ = 0;
+  }
+  items_.push_back(BinlogCacheItem(start, end, binlog));
+  size_ += binlog.size();
+  // always keep the last item, so that caught-up slaves stay in the cache
+  while (size_ > capacity_ && items_.size() > 1) {
+    size_ -= items_.front().binlog.size();
+    items_.pop_front();
+  }
+}
+
+Status BinlogCache::Read(const BinlogOffset& offset, int max_items,
+                         std::vector<BinlogCacheItem>* items) {
+  slash::RWLock l(&rwlock_, false);
+  size_t index = 0;
+  if (!Locate(offset, &index)) {
+    return Status::NotFound("offset " + offset.ToString() + " not in binlog cache");
+  }
+  for (; index < items_.size() && max_items > 0; ++index, --max_items) {
+    items->push_back(items_[index]);
+  }
+  return Status::OK();
+}
+
+bool BinlogCache::Contains(const BinlogOffset& offset) {
+  slash::RWLock l(&rwlock_, false);
+  size_t index = 0;
+  return Locate(offset, &index);
+}
+
+void BinlogCache::Clear() {
+  slash::RWLock l(&rwlock_, true);
+  items_.clear();
+  size_ = 0;
+}
+
+bool BinlogCache::Locate(const BinlogOffset& offset, size_t* index) {
+  if (items_.empty()) {
+    return false;
+  }
+  if (offset == items_.back().end_offset) {
+    *index = items_.size();
+    return true;
+  }
+  std::deque<BinlogCacheItem>::const_iterator iter = std::lower_bound(
+      items_.begin(), items_.end(), offset,
+      [](const BinlogCacheItem& item, const BinlogOffset& target) {
+        return item.start_offset < target;
+      });
+  if (iter == items_.end() || !(iter->start_offset == offset)) {
+    return false;
+  }
+  *index = iter - items_.begin();
+  return true;
+}
@@ -10,6 +10,7 @@
 #include <glog/logging.h>
 
 #include "slash/include/slash_coding.h"
+#include "slash/include/slash_string.h"
 
 #include "include/pika_command.h"
 
@@ -99,6 +100,55 @@ std::string PikaBinlogTransverter::BinlogEncode(BinlogType type,
   return binlog;
 }
 
+static size_t DecimalDigits(uint64_t v) {
+  size_t digits = 1;
+  while (v >= 10) {
+    v /= 10;
+    ++digits;
+  }
+  return digits;
+}
+
+static void AppendRespLen(std::string* str, char prefix, uint64_t len) {
+  char buf[32];
+  size_t n = slash::ll2string(buf, sizeof(buf), static_cast<long long>(len));
+  str->push_back(prefix);
+  str->append(buf, n);
+  str->append("\r\n", 2);
+}
+
+std::string PikaBinlogTransverter::BinlogEncodeArgv(BinlogType type,
+                                                    uint32_t exec_time,
+                                                    uint32_t server_id,
+                                                    uint64_t logic_id,
+                                                    uint32_t filenum,
+                                                    uint64_t offset,
+                                                    const std::vector<std::string>& argv) {
+  // *<argc>\r\n then $<len>\r\n<arg>\r\n for every arg
+  size_t content_length = 1 + DecimalDigits(argv.size()) + 2;
+  for (const auto& arg : argv) {
+    content_length += 1 + DecimalDigits(arg.size()) + 2 + arg.size() + 2;
+  }
+
+  std::string binlog;
+  binlog.reserve(BINLOG_ENCODE_LEN + content_length);
+  slash::PutFixed16(&binlog, type);
+  slash::PutFixed32(&binlog, exec_time);
+  slash::PutFixed32(&binlog, server_id);
+  slash::PutFixed64(&binlog, logic_id);
+  slash::PutFixed32(&binlog, filenum);
+  slash::PutFixed64(&binlog, offset);
+  slash::PutFixed32(&binlog, static_cast<uint32_t>(content_length));
+  AppendRespLen(&binlog, '*', argv.size());
+  for (const auto& arg : argv) {
+    AppendRespLen(&binlog, '$', arg.size());
+    binlog.append(arg.data(), arg.size());
+    binlog.append("\r\n", 2);
+  }
+  assert(binlog.size() == BINLOG_ENCODE_LEN + content_length);
+  return binlog;
+}
+
 bool PikaBinlogTransverter::BinlogDecode(BinlogType type,
                                          const std::string& binlog,
                                          BinlogItem* binlog_item) {
@@ -5,10 +5,35 @@
 
 #include "include/pika_bit.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include "slash/include/slash_string.h"
 
+#include "include/pika_bitops.h"
 #include "include/pika_define.h"
 
+// Clamps the byte range [start, end] of a string of len bytes as redis
+// does, negative offsets counting from its end
+static void FitByteRange(int64_t len, int64_t* start, int64_t* end) {
+  if (*start < 0) {
+    *start = len + *start;
+  }
+  if (*end < 0) {
+    *end = len + *end;
+  }
+  if (*start < 0) {
+    *start = 0;
+  }
+  if (*end < 0) {
+    *end = 0;
+  }
+  if (*end >= len) {
+    *end = len - 1;
+  }
+}
+
 void BitSetCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameBitSet);
@@ -102,12 +127,19 @@ void BitCountCmd::DoInitial() {
 }
 
 void BitCountCmd::Do(std::shared_ptr<Partition> partition) {
-  int32_t count = 0;
-  rocksdb::Status s;
-  if (count_all_) {
-    s = partition->db()->BitCount(key_, start_offset_, end_offset_, &count, false);
-  } else {
-    s = partition->db()->BitCount(key_, start_offset_, end_offset_, &count, true);
+  int64_t count = 0;
+  std::string value;
+  rocksdb::Status s = partition->db()->Get(key_, &value);
+  if (s.ok()) {
+    int64_t start = 0, end = static_cast<int64_t>(value.size()) - 1;
+    if (!count_all_) {
+      start = start_offset_;
+      end = end_offset_;
+      FitByteRange(value.size(), &start, &end);
+    }
+    if (start <= end) {
+      count = BitmapPopcount(value.data() + start, end - start + 1);
+    }
   }
 
   if (s.ok() || s.IsNotFound()) {
@@ -158,20 +190,36 @@ void BitPosCmd::DoInitial() {
 }
 
 void BitPosCmd::Do(std::shared_ptr<Partition> partition) {
-  int64_t pos = 0;
-  rocksdb::Status s;
-  if (pos_all_) {
-    s = partition->db()->BitPos(key_, bit_val_, &pos);
-  } else if (!pos_all_ && !endoffset_set_) {
-    s = partition->db()->BitPos(key_, bit_val_, start_offset_, &pos);
-  } else if (!pos_all_ && endoffset_set_) {
-    s = partition->db()->BitPos(key_, bit_val_, start_offset_, end_offset_, &pos);
+  std::string value;
+  rocksdb::Status s = partition->db()->Get(key_, &value);
+  if (s.IsNotFound()) {
+    // a missing key is a string of zero bits
+    res_.AppendInteger(bit_val_ ? -1 : 0);
+    return;
+  } else if (!s.ok()) {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+    return;
   }
-  if (s.ok()) {
-    res_.AppendInteger((int)pos);
+
+  int64_t start = 0, end = static_cast<int64_t>(value.size()) - 1;
+  if (!pos_all_) {
+    start = start_offset_;
+    end = endoffset_set_ ? end_offset_ : end;
+    FitByteRange(value.size(), &start, &end);
+  }
+  if (start > end) {
+    res_.AppendInteger(-1);
+    return;
+  }
+  int64_t bytes = end - start + 1;
+  int64_t pos = BitmapFirstBit(value.data() + start, bytes, bit_val_);
+  // with no end given, the string is padded with zero bits at the right
+  if (pos == bytes * 8 && (bit_val_ == 1 || endoffset_set_)) {
+    pos = -1;
   } else {
-    res_.SetRes(CmdRes::kErrOther, s.ToString());
+    pos += start * 8;
   }
+  res_.AppendInteger(pos);
 }
 
 void BitOpCmd::DoInitial() {
@@ -211,10 +259,48 @@ void BitOpCmd::DoInitial() {
 }
 
 void BitOpCmd::Do(std::shared_ptr<Partition> partition) {
-  int64_t result_length;
-  rocksdb::Status s = partition->db()->BitOp(op_, dest_key_, src_keys_, &result_length);
+  void (*op)(char* dst, const char* src, size_t n) = nullptr;
+  if (op_ == blackwidow::kBitOpAnd) {
+    op = BitmapAnd;
+  } else if (op_ == blackwidow::kBitOpOr) {
+    op = BitmapOr;
+  } else if (op_ == blackwidow::kBitOpXor) {
+    op = BitmapXor;
+  }
+
+  // Sources are folded into dest one at a time, shorter ones as if they
+  // were padded with zero bytes
+  std::string dest, value;
+  for (size_t idx = 0; idx < src_keys_.size(); idx++) {
+    rocksdb::Status s = partition->db()->Get(src_keys_[idx], &value);
+    if (s.IsNotFound()) {
+      value.clear();
+    } else if (!s.ok()) {
+      res_.SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
+    if (idx == 0) {
+      dest.swap(value);
+      if (op_ == blackwidow::kBitOpNot) {
+        BitmapNot(&dest[0], dest.data(), dest.size());
+      }
+      continue;
+    }
+    size_t common = std::min(dest.size(), value.size());
+    op(&dest[0], value.data(), common);
+    if (dest.size() < value.size()) {
+      dest.resize(value.size(), 0);
+      if (op_ != blackwidow::kBitOpAnd) {
+        memcpy(&dest[common], value.data() + common, value.size() - common);
+      }
+    } else if (op_ == blackwidow::kBitOpAnd) {
+      memset(&dest[common], 0, dest.size() - common);
+    }
+  }
+
+  rocksdb::Status s = partition->db()->Set(dest_key_, dest);
   if (s.ok()) {
-    res_.AppendInteger(result_length);
+    res_.AppendInteger(dest.size());
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
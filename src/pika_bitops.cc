@@ -0,0 +1,310 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_bitops.h"
+
+#include <string.h>
+#include <strings.h>
+
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define PIKA_BITOPS_X86
+// before gcc 4.9 immintrin.h declares the AVX2 intrinsics only when
+// the whole file is built with -mavx2, target attributes are not enough
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define PIKA_BITOPS_AVX2
+#endif
+#endif
+
+static inline uint64_t LoadWord(const char* p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+static inline void StoreWord(char* p, uint64_t word) {
+  memcpy(p, &word, sizeof(word));
+}
+
+// Position of the first bit of value bit in the byte, from its most
+// significant bit, the byte must have one
+static inline int64_t FirstBitInByte(uint8_t byte, int bit) {
+  uint32_t b = bit ? byte : static_cast<uint8_t>(~byte);
+  return __builtin_clz(b) - 24;
+}
+
+/*
+ * Scalar kernels, 64 bits at a time
+ */
+static inline int64_t PopcountWordScalar(uint64_t x) {
+  x = x - ((x >> 1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (x * 0x0101010101010101ULL) >> 56;
+}
+
+static int64_t PopcountScalar(const char* p, size_t n) {
+  int64_t count = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    count += PopcountWordScalar(LoadWord(p + i));
+  }
+  for (; i < n; i++) {
+    count += PopcountWordScalar(static_cast<uint8_t>(p[i]));
+  }
+  return count;
+}
+
+static int64_t FirstBitScalar(const char* p, size_t n, int bit) {
+  // bytes without the bit are skipped
+  const uint64_t skip = bit ? 0 : ~0ULL;
+  size_t i = 0;
+  while (i + 8 <= n && LoadWord(p + i) == skip) {
+    i += 8;
+  }
+  for (; i < n; i++) {
+    if (static_cast<uint8_t>(p[i]) != static_cast<uint8_t>(skip)) {
+      return i * 8 + FirstBitInByte(p[i], bit);
+    }
+  }
+  return n * 8;
+}
+
+#define BITMAP_SCALAR_OP(name, expr)                                  \
+static void name(char* dst, const char* src, size_t n) {              \
+  size_t i = 0;                                                       \
+  for (; i + 8 <= n; i += 8) {                                        \
+    uint64_t d = LoadWord(dst + i), s = LoadWord(src + i);            \
+    StoreWord(dst + i, expr);                                         \
+  }                                                                   \
+  for (; i < n; i++) {                                                \
+    char d = dst[i], s = src[i];                                      \
+    dst[i] = expr;                                                    \
+  }                                                                   \
+}
+
+BITMAP_SCALAR_OP(AndScalar, d & s)
+BITMAP_SCALAR_OP(OrScalar, d | s)
+BITMAP_SCALAR_OP(XorScalar, d ^ s)
+BITMAP_SCALAR_OP(NotScalar, (static_cast<void>(d), ~s))
+
+#ifdef PIKA_BITOPS_X86
+
+/*
+ * SSE4.2 kernels, POPCNT on words and 128 bit logic
+ */
+__attribute__((target("popcnt")))
+static int64_t PopcountSSE42(const char* p, size_t n) {
+  uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    c0 += __builtin_popcountll(LoadWord(p + i));
+    c1 += __builtin_popcountll(LoadWord(p + i + 8));
+    c2 += __builtin_popcountll(LoadWord(p + i + 16));
+    c3 += __builtin_popcountll(LoadWord(p + i + 24));
+  }
+  for (; i + 8 <= n; i += 8) {
+    c0 += __builtin_popcountll(LoadWord(p + i));
+  }
+  for (; i < n; i++) {
+    c0 += __builtin_popcount(static_cast<uint8_t>(p[i]));
+  }
+  return c0 + c1 + c2 + c3;
+}
+
+__attribute__((target("sse4.2")))
+static int64_t FirstBitSSE42(const char* p, size_t n, int bit) {
+  const __m128i skip = _mm_set1_epi8(bit ? 0 : -1);
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, skip)) != 0xFFFF) {
+      break;
+    }
+  }
+  int64_t pos = FirstBitScalar(p + i, n - i, bit);
+  return i * 8 + pos;
+}
+
+#define BITMAP_SSE42_OP(name, scalar, expr)                                \
+__attribute__((target("sse4.2")))                                          \
+static void name(char* dst, const char* src, size_t n) {                   \
+  size_t i = 0;                                                            \
+  for (; i + 16 <= n; i += 16) {                                           \
+    __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i)); \
+    __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)); \
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), expr);           \
+  }                                                                        \
+  scalar(dst + i, src + i, n - i);                                         \
+}
+
+BITMAP_SSE42_OP(AndSSE42, AndScalar, _mm_and_si128(d, s))
+BITMAP_SSE42_OP(OrSSE42, OrScalar, _mm_or_si128(d, s))
+BITMAP_SSE42_OP(XorSSE42, XorScalar, _mm_xor_si128(d, s))
+BITMAP_SSE42_OP(NotSSE42, NotScalar,
+                (static_cast<void>(d), _mm_xor_si128(s, _mm_set1_epi8(-1))))
+
+#endif  // PIKA_BITOPS_X86
+
+#ifdef PIKA_BITOPS_AVX2
+
+/*
+ * AVX2 kernels, popcount by nibble lookups (Mula's method)
+ */
+__attribute__((target("avx2,popcnt")))
+static int64_t PopcountAVX2(const char* p, size_t n) {
+  const __m256i lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low_mask = _mm256_set1_epi8(0x0F);
+  __m256i total = _mm256_setzero_si256();
+  size_t i = 0;
+  while (i + 32 <= n) {
+    // byte counters take 31 rounds of at most 8 before they overflow
+    __m256i local = _mm256_setzero_si256();
+    for (int round = 0; round < 31 && i + 32 <= n; round++, i += 32) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+      __m256i lo = _mm256_and_si256(v, low_mask);
+      __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+      local = _mm256_add_epi8(local, _mm256_shuffle_epi8(lookup, lo));
+      local = _mm256_add_epi8(local, _mm256_shuffle_epi8(lookup, hi));
+    }
+    total = _mm256_add_epi64(total, _mm256_sad_epu8(local, _mm256_setzero_si256()));
+  }
+  int64_t count = _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1)
+    + _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+  return count + PopcountSSE42(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static int64_t FirstBitAVX2(const char* p, size_t n, int bit) {
+  const __m256i skip = _mm256_set1_epi8(bit ? 0 : -1);
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, skip))) != 0xFFFFFFFF) {
+      break;
+    }
+  }
+  int64_t pos = FirstBitScalar(p + i, n - i, bit);
+  return i * 8 + pos;
+}
+
+#define BITMAP_AVX2_OP(name, scalar, expr)                                    \
+__attribute__((target("avx2")))                                               \
+static void name(char* dst, const char* src, size_t n) {                      \
+  size_t i = 0;                                                               \
+  for (; i + 32 <= n; i += 32) {                                              \
+    __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + i)); \
+    __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)); \
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), expr);           \
+  }                                                                           \
+  scalar(dst + i, src + i, n - i);                                            \
+}
+
+BITMAP_AVX2_OP(AndAVX2, AndScalar, _mm256_and_si256(d, s))
+BITMAP_AVX2_OP(OrAVX2, OrScalar, _mm256_or_si256(d, s))
+BITMAP_AVX2_OP(XorAVX2, XorScalar, _mm256_xor_si256(d, s))
+BITMAP_AVX2_OP(NotAVX2, NotScalar,
+               (static_cast<void>(d), _mm256_xor_si256(s, _mm256_set1_epi8(-1))))
+
+#endif  // PIKA_BITOPS_AVX2
+
+struct BitmapKernels {
+  const char* name;
+  int64_t (*popcount)(const char* p, size_t n);
+  int64_t (*first_bit)(const char* p, size_t n, int bit);
+  void (*bit_and)(char* dst, const char* src, size_t n);
+  void (*bit_or)(char* dst, const char* src, size_t n);
+  void (*bit_xor)(char* dst, const char* src, size_t n);
+  void (*bit_not)(char* dst, const char* src, size_t n);
+};
+
+static const BitmapKernels kKernels[] = {
+  {"scalar", PopcountScalar, FirstBitScalar, AndScalar, OrScalar, XorScalar, NotScalar},
+#ifdef PIKA_BITOPS_X86
+  {"sse4.2", PopcountSSE42, FirstBitSSE42, AndSSE42, OrSSE42, XorSSE42, NotSSE42},
+#endif
+#ifdef PIKA_BITOPS_AVX2
+  {"avx2", PopcountAVX2, FirstBitAVX2, AndAVX2, OrAVX2, XorAVX2, NotAVX2},
+#endif
+};
+
+BitmapKernel BitmapBestKernel() {
+#ifdef PIKA_BITOPS_X86
+  __builtin_cpu_init();
+#ifdef PIKA_BITOPS_AVX2
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+    return kBitmapKernelAVX2;
+  }
+#endif
+  if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt")) {
+    return kBitmapKernelSSE42;
+  }
+#endif
+  return kBitmapKernelScalar;
+}
+
+static std::atomic<const BitmapKernels*>& CurrentKernels() {
+  static std::atomic<const BitmapKernels*> kernels(&kKernels[BitmapBestKernel()]);
+  return kernels;
+}
+
+static inline const BitmapKernels* Kernels() {
+  return CurrentKernels().load(std::memory_order_relaxed);
+}
+
+bool BitmapSetKernel(BitmapKernel kernel) {
+  if (kernel > BitmapBestKernel()) {
+    return false;
+  }
+  CurrentKernels().store(&kKernels[kernel]);
+  return true;
+}
+
+const char* BitmapKernelName() {
+  return Kernels()->name;
+}
+
+bool BitmapKernelByName(const char* name, BitmapKernel* kernel) {
+  static const char* const kNames[] = {"scalar", "sse4.2", "avx2"};
+  if (strcasecmp(name, "auto") == 0) {
+    *kernel = BitmapBestKernel();
+    return true;
+  }
+  for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); i++) {
+    if (strcasecmp(name, kNames[i]) == 0) {
+      *kernel = static_cast<BitmapKernel>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+int64_t BitmapPopcount(const char* p, size_t n) {
+  return Kernels()->popcount(p, n);
+}
+
+int64_t BitmapFirstBit(const char* p, size_t n, int bit) {
+  return Kernels()->first_bit(p, n, bit);
+}
+
+void BitmapAnd(char* dst, const char* src, size_t n) {
+  Kernels()->bit_and(dst, src, n);
+}
+
+void BitmapOr(char* dst, const char* src, size_t n) {
+  Kernels()->bit_or(dst, src, n);
+}
+
+void BitmapXor(char* dst, const char* src, size_t n) {
+  Kernels()->bit_xor(dst, src, n);
+}
+
+void BitmapNot(char* dst, const char* src, size_t n) {
+  Kernels()->bit_not(dst, src, n);
+}
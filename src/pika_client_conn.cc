@@ -5,6 +5,11 @@
 
 #include "include/pika_client_conn.h"
 
+#include <errno.h>
+#include <poll.h>
+#include <strings.h>
+#include <unistd.h>
+
 #include <vector>
 #include <algorithm>
 
@@ -26,7 +31,10 @@ PikaClientConn::PikaClientConn(int fd, std::string ip_port,
       : RedisConn(fd, ip_port, thread, pink_epoll, handle_type, max_conn_rbuf_size),
         server_thread_(reinterpret_cast<pink::ServerThread*>(thread)),
         current_table_(g_pika_conf->default_table()),
-        is_pubsub_(false) {
+        is_pubsub_(false),
+        batch_response_(nullptr),
+        reply_streamed_(false),
+        reply_broken_(false) {
   auth_stat_.Init();
 }
 
@@ -45,10 +53,7 @@ std::string PikaClientConn::DoCmd(const PikaCmdArgsType& argv,
     return "-ERR NOAUTH Authentication required.\r\n";
   }
 
-  uint64_t start_us = 0;
-  if (g_pika_conf->slowlog_slower_than() >= 0) {
-    start_us = slash::NowMicros();
-  }
+  uint64_t start_us = slash::NowMicros();
 
   bool is_monitoring = g_pika_server->HasMonitorClients();
   if (is_monitoring) {
@@ -61,21 +66,22 @@ std::string PikaClientConn::DoCmd(const PikaCmdArgsType& argv,
     return c_ptr->res().message();
   }
 
-  g_pika_server->UpdateQueryNumAndExecCountTable(opt);
+  g_pika_server->UpdateQueryNumAndExecCountTable(c_ptr->cmd_id());
  
   // PubSub connection
   // (P)SubscribeCmd will set is_pubsub_
   if (this->IsPubSub()) {
-    if (opt != kCmdNameSubscribe &&
-        opt != kCmdNameUnSubscribe &&
-        opt != kCmdNamePing &&
-        opt != kCmdNamePSubscribe &&
-        opt != kCmdNamePUnSubscribe) {
+    const std::string& name = c_ptr->name();
+    if (name != kCmdNameSubscribe &&
+        name != kCmdNameUnSubscribe &&
+        name != kCmdNamePing &&
+        name != kCmdNamePSubscribe &&
+        name != kCmdNamePUnSubscribe) {
       return "-ERR only (P)SUBSCRIBE / (P)UNSUBSCRIBE / PING / QUIT allowed in this context\r\n";
     }
   }
 
-  if (!g_pika_server->IsCommandSupport(opt)) {
+  if (!g_pika_server->IsCommandSupport(c_ptr->name())) {
     return "-ERR This command only support in classic mode\r\n";
   }
 
@@ -98,12 +104,21 @@ std::string PikaClientConn::DoCmd(const PikaCmdArgsType& argv,
   }
 
   // Process Command
+  c_ptr->SetReplyStreamable(true);
   c_ptr->Execute();
 
+  g_pika_server->UpdateCmdExecTime(c_ptr->cmd_id(), slash::NowMicros() - start_us);
+  if (!c_ptr->is_admin_require()
+    && HotKeyTracker::ShouldSample(g_pika_conf->hotkey_sample_rate())) {
+    g_pika_server->HotKeyAdd(current_table_, c_ptr->current_key(), c_ptr->is_write());
+  }
   if (g_pika_conf->slowlog_slower_than() >= 0) {
     ProcessSlowlog(argv, start_us);
   }
 
+  // streamed parts of the reply go out first, now that Execute released
+  // the db lock: a slow client only ever stalls its own worker
+  c_ptr->StreamReplyChunks();
   return c_ptr->res().message();
 }
 
@@ -137,15 +152,8 @@ void PikaClientConn::ProcessSlowlog(const PikaCmdArgsType& argv, uint64_t start_
 }
 
 void PikaClientConn::ProcessMonitor(const PikaCmdArgsType& argv) {
-  std::string monitor_message;
-  std::string table_name = g_pika_conf->classic_mode()
-    ? current_table_.substr(2) : current_table_;
-  monitor_message = std::to_string(1.0*slash::NowMicros()/1000000) +
-    " [" + table_name + " " + this->ip_port() + "]";
-  for (PikaCmdArgsType::const_iterator iter = argv.begin(); iter != argv.end(); iter++) {
-    monitor_message += " " + slash::ToRead(*iter);
-  }
-  g_pika_server->AddMonitorMessage(monitor_message);
+  // formatted by the monitor thread, keep the worker side to a copy
+  g_pika_server->AddMonitorMessage(current_table_, ip_port(), argv);
 }
 
 void PikaClientConn::AsynProcessRedisCmds(const std::vector<pink::RedisCmdArgsType>& argvs, std::string* response) {
@@ -153,33 +161,89 @@ void PikaClientConn::AsynProcessRedisCmds(const std::vector<pink::RedisCmdArgsTy
   arg->redis_cmds = argvs;
   arg->response = response;
   arg->pcc = std::dynamic_pointer_cast<PikaClientConn>(shared_from_this());
+  arg->schedule_us = slash::NowMicros();
   g_pika_server->Schedule(&DoBackgroundTask, arg);
 }
 
 void PikaClientConn::BatchExecRedisCmd(const std::vector<pink::RedisCmdArgsType>& argvs, std::string* response) {
   bool success = true;
+  batch_response_ = response;
+  reply_streamed_ = false;
   for (const auto& argv : argvs) {
-    if (DealMessage(argv, response) != 0) {
+    if (DealMessage(argv, response) != 0 || reply_broken_) {
       success = false;
       break;
     }
   }
-  if (!response->empty()) {
+  batch_response_ = nullptr;
+  // a streamed reply may leave nothing behind, the io thread still
+  // has to be told the batch is done
+  if (!response->empty() || reply_streamed_ || !success) {
     set_is_reply(true);
     NotifyEpoll(success);
   }
 }
 
+bool PikaClientConn::StreamReply(std::string* chunk) {
+  if (!IsReplyStreamable()) {
+    return false;
+  }
+  reply_streamed_ = true;
+  if (!batch_response_->empty()) {
+    reply_broken_ = !WriteSocket(*batch_response_);
+    batch_response_->clear();
+  }
+  if (!reply_broken_) {
+    reply_broken_ = !WriteSocket(*chunk);
+  }
+  chunk->clear();
+  if (reply_broken_) {
+    LOG(WARNING) << "ip_port: " << ip_port() << " stream reply failed, close the connection";
+  }
+  return !reply_broken_;
+}
+
+bool PikaClientConn::WriteSocket(const std::string& buf) {
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    ssize_t nwritten = write(fd(), buf.data() + pos, buf.size() - pos);
+    if (nwritten > 0) {
+      pos += nwritten;
+      continue;
+    }
+    if (nwritten < 0 && errno == EINTR) {
+      continue;
+    }
+    if (nwritten < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+      return false;
+    }
+    // the socket is non blocking, wait until the client reads
+    struct pollfd pfd;
+    pfd.fd = fd();
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    int ret = poll(&pfd, 1, kReplyStreamTimeoutMs);
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 int PikaClientConn::DealMessage(const PikaCmdArgsType& argv, std::string* response) {
 
   if (argv.empty()) return -2;
-  std::string opt = argv[0];
-  if (opt == kClusterPrefix) {
-    if (argv.size() >=2 ) {
-      opt += argv[1];
-    }
+  // Command lookup is case insensitive, only build a new
+  // name for the pkcluster sub commands
+  std::string cluster_opt;
+  if (!strcasecmp(argv[0].c_str(), kClusterPrefix.c_str())
+    && argv.size() >= 2) {
+    cluster_opt = kClusterPrefix + argv[1];
   }
-  slash::StringToLower(opt);
+  const std::string& opt = cluster_opt.empty() ? argv[0] : cluster_opt;
 
   if (response->empty()) {
     // Avoid memory copy
@@ -193,6 +257,7 @@ int PikaClientConn::DealMessage(const PikaCmdArgsType& argv, std::string* respon
 
 void PikaClientConn::DoBackgroundTask(void* arg) {
   BgTaskArg* bg_arg = reinterpret_cast<BgTaskArg*>(arg);
+  g_pika_server->UpdateStageLatency(kLatencyQueue, slash::NowMicros() - bg_arg->schedule_us);
   bg_arg->pcc->BatchExecRedisCmd(bg_arg->redis_cmds, bg_arg->response);
   delete bg_arg;
 }
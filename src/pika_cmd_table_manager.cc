@@ -5,6 +5,8 @@
 
 #include "include/pika_cmd_table_manager.h"
 
+#include <ctype.h>
+#include <strings.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 
@@ -16,11 +18,31 @@
 
 extern PikaConf* g_pika_conf;
 
+size_t CmdNameHash::operator()(const std::string& name) const {
+  // FNV-1a over the lower-cased bytes
+  size_t hash = 2166136261u;
+  for (size_t i = 0; i < name.size(); i++) {
+    hash ^= static_cast<unsigned char>(tolower(name[i]));
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+bool CmdNameEqual::operator()(const std::string& lhs,
+                              const std::string& rhs) const {
+  return lhs.size() == rhs.size()
+    && !strncasecmp(lhs.data(), rhs.data(), lhs.size());
+}
+
 PikaCmdTableManager::PikaCmdTableManager() {
   pthread_rwlock_init(&map_protector_, NULL);
   cmds_ = new CmdTable();
   cmds_->reserve(300);
   InitCmdTable(cmds_);
+  cmd_index_.reserve(cmds_->size());
+  for (const auto& item : *cmds_) {
+    cmd_index_.insert(std::make_pair(item.first, item.second));
+  }
 }
 
 PikaCmdTableManager::~PikaCmdTableManager() {
@@ -28,30 +50,47 @@ PikaCmdTableManager::~PikaCmdTableManager() {
   for (const auto&item : thread_distribution_map_) {
     delete item.second;
   }
+  for (const auto& pool : pools_) {
+    delete pool;
+  }
   DestoryCmdTable(cmds_);
   delete cmds_;
 }
 
 std::shared_ptr<Cmd> PikaCmdTableManager::GetCmd(const std::string& opt) {
-  std::string internal_opt = opt;
-  if (!g_pika_conf->classic_mode()) {
-    TryChangeToAlias(&internal_opt);
+  CmdNameIndex::const_iterator iter;
+  if (!g_pika_conf->classic_mode()
+    && !strcasecmp(opt.c_str(), kCmdNameSlaveof.c_str())) {
+    iter = cmd_index_.find(kCmdNamePkClusterSlotsSlaveof);
+  } else {
+    iter = cmd_index_.find(opt);
+  }
+  if (iter == cmd_index_.end()) {
+    return nullptr;
   }
-  return NewCommand(internal_opt);
-}
 
-std::shared_ptr<Cmd> PikaCmdTableManager::NewCommand(const std::string& opt) {
-  Cmd* cmd = GetCmdFromTable(opt, *cmds_);
-  if (cmd) {
-    return std::shared_ptr<Cmd>(cmd->Clone());
+  Cmd* prototype = iter->second;
+  std::shared_ptr<Cmd>& cmd = (*CurrentThreadCmdPool())[prototype->cmd_id()];
+  if (!cmd) {
+    cmd.reset(prototype->Clone());
+  } else if (cmd.use_count() > 1) {
+    // Still held by the previous request, fall back to a new one
+    return std::shared_ptr<Cmd>(prototype->Clone());
   }
-  return nullptr;
+  // Drop the connection of the request that used it last, callers
+  // serving a client set their own
+  cmd->SetConn(nullptr);
+  return cmd;
 }
 
-void PikaCmdTableManager::TryChangeToAlias(std::string *internal_opt) {
-  if (!strcasecmp(internal_opt->c_str(), kCmdNameSlaveof.c_str())) {
-    *internal_opt = kCmdNamePkClusterSlotsSlaveof;
+PikaCmdTableManager::CmdPool* PikaCmdTableManager::CurrentThreadCmdPool() {
+  static thread_local CmdPool* pool = nullptr;
+  if (pool == nullptr) {
+    pool = new CmdPool(cmds_->size());
+    slash::MutexLock l(&pools_mu_);
+    pools_.push_back(pool);
   }
+  return pool;
 }
 
 bool PikaCmdTableManager::CheckCurrentThreadDistributionMapExist(const pid_t& tid) {
@@ -5,6 +5,9 @@
 
 #include "include/pika_command.h"
 
+#include <map>
+#include <algorithm>
+
 #include "include/pika_kv.h"
 #include "include/pika_bit.h"
 #include "include/pika_set.h"
@@ -15,6 +18,7 @@
 #include "include/pika_admin.h"
 #include "include/pika_pubsub.h"
 #include "include/pika_server.h"
+#include "include/pika_client_conn.h"
 #include "include/pika_hyperloglog.h"
 #include "include/pika_slot.h"
 #include "include/pika_cluster.h"
@@ -68,6 +72,10 @@ void InitCmdTable(std::unordered_map<std::string, Cmd*> *cmd_table) {
   cmd_table->insert(std::pair<std::string, Cmd*>(kCmdNameSlowlog, slowlogptr));
   Cmd* paddingptr = new PaddingCmd(kCmdNamePadding, 2, kCmdFlagsWrite | kCmdFlagsAdmin);
   cmd_table->insert(std::pair<std::string, Cmd*>(kCmdNamePadding, paddingptr));
+  Cmd* hotkeysptr = new HotKeysCmd(kCmdNameHotKeys, -2, kCmdFlagsRead | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, Cmd*>(kCmdNameHotKeys, hotkeysptr));
+  Cmd* latencyptr = new LatencyCmd(kCmdNameLatency, -2, kCmdFlagsRead | kCmdFlagsAdmin);
+  cmd_table->insert(std::pair<std::string, Cmd*>(kCmdNameLatency, latencyptr));
   Cmd* pkpatternmatchdelptr = new PKPatternMatchDelCmd(kCmdNamePKPatternMatchDel, 3, kCmdFlagsWrite | kCmdFlagsAdmin);
   cmd_table->insert(std::pair<std::string, Cmd*>(kCmdNamePKPatternMatchDel, pkpatternmatchdelptr));
 
@@ -492,6 +500,16 @@ void InitCmdTable(std::unordered_map<std::string, Cmd*> *cmd_table) {
   ////PubSub
   Cmd * pubsubptr = new PubSubCmd(kCmdNamePubSub, -2, kCmdFlagsRead | kCmdFlagsPubSub);
   cmd_table->insert(std::pair<std::string, Cmd*>(kCmdNamePubSub, pubsubptr));
+
+  // Assign command id in name order, so every cmd table agrees on it
+  std::vector<std::string> cmd_names;
+  for (const auto& item : *cmd_table) {
+    cmd_names.push_back(item.first);
+  }
+  std::sort(cmd_names.begin(), cmd_names.end());
+  for (size_t idx = 0; idx < cmd_names.size(); ++idx) {
+    (*cmd_table)[cmd_names[idx]]->set_cmd_id(idx);
+  }
 }
 
 Cmd* GetCmdFromTable(const std::string& opt, const CmdTable& cmd_table) {
@@ -528,10 +546,22 @@ void TryAliasChange(std::vector<std::string>* argv) {
 void Cmd::Initial(const PikaCmdArgsType& argv,
                   const std::string& table_name) {
   argv_ = argv;
+  InitialInternal(table_name);
+}
+
+void Cmd::Initial(PikaCmdArgsType&& argv,
+                  const std::string& table_name) {
+  argv_ = std::move(argv);
+  InitialInternal(table_name);
+}
+
+void Cmd::InitialInternal(const std::string& table_name) {
   if (!g_pika_conf->classic_mode()) {
     TryAliasChange(&argv_);
   }
   table_name_ = table_name;
+  reply_streamable_ = false;
+  reply_chunks_.clear();
   res_.clear(); // Clear res content
   Clear();      // Clear cmd, Derived class can has own implement
   DoInitial();
@@ -618,13 +648,22 @@ void Cmd::ProcessSinglePartitionCmd() {
 
 void Cmd::ProcessCommand(std::shared_ptr<Partition> partition) {
   slash::lock::MultiRecordLock record_lock(partition->LockMgr());
+  uint64_t start_us = slash::NowMicros();
   if (is_write()) {
     record_lock.Lock(current_key());
+    uint64_t locked_us = slash::NowMicros();
+    g_pika_server->UpdateStageLatency(kLatencyLock, locked_us - start_us);
+    start_us = locked_us;
   }
 
   DoCommand(partition);
+  uint64_t done_us = slash::NowMicros();
+  g_pika_server->UpdateStageLatency(kLatencyDo, done_us - start_us);
 
   DoBinlog(partition);
+  if (is_write()) {
+    g_pika_server->UpdateStageLatency(kLatencyBinlog, slash::NowMicros() - done_us);
+  }
 
   if (is_write()) {
     record_lock.Unlock(current_key());
@@ -632,6 +671,11 @@ void Cmd::ProcessCommand(std::shared_ptr<Partition> partition) {
 
 }
 
+void Cmd::ProcessCommandLocked(std::shared_ptr<Partition> partition) {
+  DoCommand(partition);
+  DoBinlog(partition);
+}
+
 void Cmd::DoCommand(std::shared_ptr<Partition> partition) {
   if (!is_suspend()) {
     partition->DbRWLockReader();
@@ -650,6 +694,24 @@ void Cmd::DoBinlog(std::shared_ptr<Partition> partition) {
     && is_write()
     && g_pika_conf->write_binlog()) {
 
+    if (g_pika_conf->binlog_group_commit()) {
+      uint32_t exec_time = time(nullptr);
+      BinlogOffset binlog_offset;
+      Status s = partition->GroupWriteBinlog(
+          [this, exec_time](uint32_t filenum, uint64_t offset, uint64_t logic_id) {
+            return ToBinlog(exec_time,
+                            g_pika_conf->server_id(),
+                            logic_id,
+                            filenum,
+                            offset,
+                            BinlogType::TypeFirst);
+          }, &binlog_offset);
+      if (!s.ok()) {
+        res().SetRes(CmdRes::kErrOther, s.ToString());
+      }
+      return;
+    }
+
     uint32_t filenum = 0;
     uint64_t offset = 0;
     uint64_t logic_id = 0;
@@ -676,12 +738,79 @@ void Cmd::DoBinlog(std::shared_ptr<Partition> partition) {
 void Cmd::ProcessMultiPartitionCmd() {
   if (argv_.size() == static_cast<size_t>(arity_ < 0 ? -arity_ : arity_)) {
     ProcessSinglePartitionCmd();
+  } else if (SplitKeyStep() != 0) {
+    ProcessSplitCmd();
   } else {
     res_.SetRes(CmdRes::kErrOther, "This command usage only support in classic mode\r\n");
     return;
   }
 }
 
+void Cmd::ProcessSplitCmd() {
+  size_t step = SplitKeyStep();
+  // key positions of every partition, in request order
+  std::map<uint32_t, std::vector<size_t>> positions;
+  std::map<uint32_t, std::shared_ptr<Partition>> partitions;
+  for (size_t idx = 1, pos = 0; idx + step <= argv_.size(); idx += step, ++pos) {
+    std::shared_ptr<Partition> partition =
+      g_pika_server->GetTablePartitionByKey(table_name_, argv_[idx]);
+    if (!partition) {
+      res_.SetRes(CmdRes::kErrOther, "Partition not found");
+      return;
+    }
+    positions[partition->GetPartitionId()].push_back(pos);
+    partitions[partition->GetPartitionId()] = partition;
+  }
+  if (positions.size() == 1) {
+    ProcessCommand(partitions.begin()->second);
+    return;
+  }
+
+  // check every partition before running any sub command, so a refused
+  // request never leaves some partitions written and others not
+  std::map<uint32_t, PikaCmdArgsType> sub_argvs;
+  for (const auto& item : positions) {
+    PikaCmdArgsType& sub_argv = sub_argvs[item.first];
+    sub_argv.reserve(1 + item.second.size() * step);
+    sub_argv.push_back(argv_[0]);
+    for (size_t pos : item.second) {
+      for (size_t idx = 1 + pos * step; idx < 1 + (pos + 1) * step; ++idx) {
+        sub_argv.push_back(argv_[idx]);
+      }
+    }
+    if (!is_write()) {
+      continue;
+    }
+    if (partitions[item.first]->IsBinlogIoError()) {
+      res_.SetRes(CmdRes::kErrOther, "Writing binlog failed, maybe no space left on device");
+      return;
+    }
+    if (g_pika_server->readonly(table_name_, sub_argv[1])) {
+      res_.SetRes(CmdRes::kErrOther, "Server in read-only");
+      return;
+    }
+  }
+
+  // every sub command takes the record locks and writes the binlog of
+  // its own partition, so slaves replay it per partition as well.
+  // A split write is not atomic: if a later sub command fails, the
+  // partitions done before keep their writes, e.g. a cross partition
+  // MSET may be applied to some of its keys only
+  for (const auto& item : positions) {
+    std::unique_ptr<Cmd> sub_cmd(Clone());
+    sub_cmd->Initial(std::move(sub_argvs[item.first]), table_name_);
+    if (sub_cmd->res().ok()) {
+      sub_cmd->ProcessCommand(partitions[item.first]);
+    }
+    if (!sub_cmd->res().ok()) {
+      res_ = sub_cmd->res();
+      return;
+    }
+    MergeSubCmd(item.second, sub_cmd.get());
+  }
+  ReplyMerged();
+}
+
 void Cmd::ProcessDoNotSpecifyPartitionCmd() {
   Do();
 }
@@ -707,7 +836,7 @@ bool Cmd::is_multi_partition() const {
   return ((flag_ & kCmdFlagsMaskPartition) == kCmdFlagsMultiPartition);
 }
 
-std::string Cmd::name() const {
+const std::string& Cmd::name() const {
   return name_;
 }
 CmdRes& Cmd::res() {
@@ -720,23 +849,13 @@ std::string Cmd::ToBinlog(uint32_t exec_time,
                           uint32_t filenum,
                           uint64_t offset,
                           BinlogType binlog_type) {
-  std::string content;
-  content.reserve(RAW_ARGS_LEN);
-  RedisAppendLen(content, argv_.size(), "*");
-
-  for (const auto& v : argv_) {
-    RedisAppendLen(content, v.size(), "$");
-    RedisAppendContent(content, v);
-  }
-
-  return PikaBinlogTransverter::BinlogEncode(binlog_type,
-                                             exec_time,
-                                             std::stoi(server_id),
-                                             logic_id,
-                                             filenum,
-                                             offset,
-                                             content,
-                                             {});
+  return PikaBinlogTransverter::BinlogEncodeArgv(binlog_type,
+                                                 exec_time,
+                                                 std::stoi(server_id),
+                                                 logic_id,
+                                                 filenum,
+                                                 offset,
+                                                 argv_);
 }
 
 bool Cmd::CheckArg(int num) const {
@@ -763,3 +882,55 @@ void Cmd::SetConn(const std::shared_ptr<pink::PinkConn> conn) {
 std::shared_ptr<pink::PinkConn> Cmd::GetConn() {
   return conn_.lock();
 }
+
+std::shared_ptr<PikaClientConn> Cmd::ReplyStreamConn() {
+  if (!reply_streamable_) {
+    return nullptr;
+  }
+  std::shared_ptr<PikaClientConn> conn =
+    std::dynamic_pointer_cast<PikaClientConn>(GetConn());
+  if (!conn || !conn->IsReplyStreamable()) {
+    return nullptr;
+  }
+  return conn;
+}
+
+void Cmd::FlushReply() {
+  int64_t budget = g_pika_conf->reply_stream_budget();
+  if (budget <= 0 || res_.raw_size() < static_cast<size_t>(budget)
+    || !ReplyStreamConn()) {
+    return;
+  }
+  reply_chunks_.push_back(std::string());
+  res_.SwapRaw(&reply_chunks_.back());
+}
+
+void Cmd::AppendReplyRaw(std::string* raw) {
+  int64_t budget = g_pika_conf->reply_stream_budget();
+  if (budget <= 0 || raw->size() < static_cast<size_t>(budget)
+    || !ReplyStreamConn()) {
+    res_.AppendStringRaw(*raw);
+    raw->clear();
+    return;
+  }
+  reply_chunks_.push_back(std::string());
+  res_.SwapRaw(&reply_chunks_.back());
+  reply_chunks_.push_back(std::string());
+  reply_chunks_.back().swap(*raw);
+}
+
+bool Cmd::StreamReplyChunks() {
+  if (reply_chunks_.empty()) {
+    return true;
+  }
+  std::shared_ptr<PikaClientConn> conn = ReplyStreamConn();
+  bool ok = conn != nullptr;
+  for (auto& chunk : reply_chunks_) {
+    if (!ok || !conn->StreamReply(&chunk)) {
+      ok = false;
+      break;
+    }
+  }
+  reply_chunks_.clear();
+  return ok;
+}
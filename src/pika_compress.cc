@@ -0,0 +1,126 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_compress.h"
+
+#ifdef SNAPPY
+#include <snappy.h>
+#endif
+
+#ifdef ZSTD
+#include <zstd.h>
+#endif
+
+bool CompressionSupported(InnerMessage::CompressionType type) {
+  switch (type) {
+    case InnerMessage::kNoCompression:
+      return true;
+#ifdef SNAPPY
+    case InnerMessage::kSnappyCompression:
+      return true;
+#endif
+#ifdef ZSTD
+    case InnerMessage::kZstdCompression:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+std::vector<InnerMessage::CompressionType> SupportedCompressions() {
+  std::vector<InnerMessage::CompressionType> types;
+#ifdef SNAPPY
+  types.push_back(InnerMessage::kSnappyCompression);
+#endif
+#ifdef ZSTD
+  types.push_back(InnerMessage::kZstdCompression);
+#endif
+  return types;
+}
+
+InnerMessage::CompressionType CompressionTypeFromString(const std::string& name) {
+  if (name == "snappy") {
+    return InnerMessage::kSnappyCompression;
+  } else if (name == "zstd") {
+    return InnerMessage::kZstdCompression;
+  }
+  return InnerMessage::kNoCompression;
+}
+
+std::string CompressionTypeToString(InnerMessage::CompressionType type) {
+  switch (type) {
+    case InnerMessage::kSnappyCompression:
+      return "snappy";
+    case InnerMessage::kZstdCompression:
+      return "zstd";
+    default:
+      return "none";
+  }
+}
+
+bool Compress(InnerMessage::CompressionType type,
+              const std::string& input, std::string* output) {
+  switch (type) {
+#ifdef SNAPPY
+    case InnerMessage::kSnappyCompression:
+      snappy::Compress(input.data(), input.size(), output);
+      return true;
+#endif
+#ifdef ZSTD
+    case InnerMessage::kZstdCompression:
+    {
+      output->resize(ZSTD_compressBound(input.size()));
+      size_t len = ZSTD_compress(&(*output)[0], output->size(),
+                                 input.data(), input.size(), 1);
+      if (ZSTD_isError(len)) {
+        return false;
+      }
+      output->resize(len);
+      return true;
+    }
+#endif
+    default:
+      return false;
+  }
+}
+
+bool Uncompress(InnerMessage::CompressionType type,
+                const std::string& input, size_t max_len, std::string* output) {
+  // the lengths below come from the peer, they are checked before any
+  // buffer is sized from them
+  switch (type) {
+#ifdef SNAPPY
+    case InnerMessage::kSnappyCompression:
+    {
+      size_t raw_len = 0;
+      if (!snappy::GetUncompressedLength(input.data(), input.size(), &raw_len)
+        || raw_len > max_len) {
+        return false;
+      }
+      return snappy::Uncompress(input.data(), input.size(), output);
+    }
+#endif
+#ifdef ZSTD
+    case InnerMessage::kZstdCompression:
+    {
+      unsigned long long raw_len = ZSTD_getFrameContentSize(input.data(), input.size());
+      if (raw_len == ZSTD_CONTENTSIZE_ERROR || raw_len == ZSTD_CONTENTSIZE_UNKNOWN
+        || raw_len > max_len) {
+        return false;
+      }
+      output->resize(raw_len);
+      size_t len = ZSTD_decompress(&(*output)[0], output->size(),
+                                   input.data(), input.size());
+      if (ZSTD_isError(len) || len != raw_len) {
+        return false;
+      }
+      return true;
+    }
+#endif
+    default:
+      return false;
+  }
+}
@@ -13,9 +13,10 @@
 #include "slash/include/env.h"
 
 #include "include/pika_define.h"
+#include "include/pika_bitops.h"
 
 PikaConf::PikaConf(const std::string& path)
-    : slash::BaseConf(path), conf_path_(path) {
+    : slash::BaseConf(path), conf_path_(path), meta_load_us_(0) {
   pthread_rwlock_init(&rwlock_, NULL);
   local_meta_ = new PikaMeta();
 }
@@ -137,7 +138,12 @@ int PikaConf::Load()
   GetConfInt("slowlog-max-len", &slowlog_max_len_);
   if (slowlog_max_len_ == 0) {
     slowlog_max_len_ = 128;
+  } else if (slowlog_max_len_ > SLOWLOG_MAX_LEN) {
+    slowlog_max_len_ = SLOWLOG_MAX_LEN;
   }
+  int tmp_slowlog_max_arg_len = SLOWLOG_ENTRY_MAX_STRING;
+  GetConfInt("slowlog-max-arg-len", &tmp_slowlog_max_arg_len);
+  slowlog_max_arg_len_.store(std::max(0, tmp_slowlog_max_arg_len));
   std::string user_blacklist;
   GetConfStr("userblacklist", &user_blacklist);
   slash::StringSplit(user_blacklist, COMMA, user_blacklist_);
@@ -228,6 +234,7 @@ int PikaConf::Load()
           << " it should greater than zero, the actual is: "
           << default_slot_num_;
     }
+    uint64_t start_us = slash::NowMicros();
     std::string pika_meta_path = db_path_ + kPikaMeta;
     if (!slash::FileExists(pika_meta_path)) {
       local_meta_->StableSave({{"db0", static_cast<uint32_t>(default_slot_num_), {}}});
@@ -236,6 +243,7 @@ int PikaConf::Load()
     if (!s.ok()) {
       LOG(FATAL) << "parse meta file error";
     }
+    meta_load_us_ = slash::NowMicros() - start_us;
   }
   default_table_ = table_structs_[0].table_name;
 
@@ -306,6 +314,11 @@ int PikaConf::Load()
     max_client_response_size_ = 1073741824; // 1Gb
   }
 
+  // reply_stream_budget
+  int64_t tmp_reply_stream_budget = 1048576; // 1Mb
+  GetConfInt64("reply-stream-budget", &tmp_reply_stream_budget);
+  reply_stream_budget_.store(std::max<int64_t>(0, tmp_reply_stream_budget));
+
   // target_file_size_base
   GetConfInt("target-file-size-base", &target_file_size_base_);
   if (target_file_size_base_ <= 0) {
@@ -396,6 +409,37 @@ int PikaConf::Load()
     || static_cast<int64_t>(binlog_file_size_) > (1024LL * 1024 * 1024)) {
     binlog_file_size_ = 100 * 1024 * 1024;    // 100M
   }
+
+  std::string bgc;
+  GetConfStr("binlog-group-commit", &bgc);
+  binlog_group_commit_.store(bgc == "yes" ? true : false);
+
+  binlog_cache_size_ = kBinlogCacheDefaultSize;
+  GetConfInt64("binlog-cache-size", &binlog_cache_size_);
+  if (binlog_cache_size_ < 0) {
+    binlog_cache_size_ = kBinlogCacheDefaultSize;
+  }
+
+  GetConfStr("replication-compression", &replication_compression_);
+  if (replication_compression_ != "snappy"
+    && replication_compression_ != "zstd") {
+    replication_compression_ = "none";
+  }
+
+  int tmp_keyscan_concurrency = 1;
+  GetConfInt("keyscan-concurrency", &tmp_keyscan_concurrency);
+  keyscan_concurrency_.store(std::max(1, std::min(tmp_keyscan_concurrency, kKeyscanMaxConcurrency)));
+  int64_t tmp_keyscan_bytes_per_sec = 0;
+  GetConfInt64("keyscan-bytes-per-sec", &tmp_keyscan_bytes_per_sec);
+  keyscan_bytes_per_sec_.store(std::max<int64_t>(0, tmp_keyscan_bytes_per_sec));
+  int tmp_hotkey_sample_rate = 100;
+  GetConfInt("hotkey-sample-rate", &tmp_hotkey_sample_rate);
+  hotkey_sample_rate_.store(std::max(0, tmp_hotkey_sample_rate));
+  GetConfStr("bitops-kernel", &bitops_kernel_);
+  BitmapKernel tmp_bitops_kernel;
+  if (!BitmapKernelByName(bitops_kernel_.c_str(), &tmp_bitops_kernel)) {
+    bitops_kernel_ = "auto";
+  }
   GetConfStr("pidfile", &pidfile_);
 
   // db sync
@@ -465,15 +509,22 @@ int PikaConf::ConfigRewrite() {
   SetConfStr("slowlog-write-errorlog", slowlog_write_errorlog_.load() ? "yes" : "no");
   SetConfInt("slowlog-log-slower-than", slowlog_log_slower_than_.load());
   SetConfInt("slowlog-max-len", slowlog_max_len_);
+  SetConfInt("slowlog-max-arg-len", slowlog_max_arg_len_.load());
   SetConfStr("write-binlog", write_binlog_ ? "yes" : "no");
+  SetConfStr("binlog-group-commit", binlog_group_commit_.load() ? "yes" : "no");
   SetConfInt("max-cache-statistic-keys", max_cache_statistic_keys_);
   SetConfInt("small-compaction-threshold", small_compaction_threshold_);
   SetConfInt("max-client-response-size", max_client_response_size_);
+  SetConfInt("reply-stream-budget", reply_stream_budget_.load());
   SetConfInt("db-sync-speed", db_sync_speed_);
   SetConfStr("compact-cron", compact_cron_);
   SetConfStr("compact-interval", compact_interval_);
   SetConfInt("slave-priority", slave_priority_);
   SetConfInt("sync-window-size", sync_window_size_.load());
+  SetConfInt("keyscan-concurrency", keyscan_concurrency_.load());
+  SetConfStr("keyscan-bytes-per-sec", std::to_string(keyscan_bytes_per_sec_.load()));
+  SetConfInt("hotkey-sample-rate", hotkey_sample_rate_.load());
+  SetConfStr("bitops-kernel", bitops_kernel_);
   // slaveof config item is special
   SetConfStr("slaveof", slaveof_);
 
@@ -5,6 +5,7 @@
 
 #include "include/pika_geo.h"
 
+#include <stdint.h>
 #include <algorithm>
 
 #include "slash/include/slash_string.h"
@@ -250,6 +251,32 @@ static bool sort_distance_desc(const NeighborPoint & pos1, const NeighborPoint &
   return pos1.distance > pos2.distance;
 }
 
+struct GeoScoreRange {
+  GeoHashFix52Bits min;
+  GeoHashFix52Bits max;
+};
+
+static bool sort_range_min(const GeoScoreRange & r1, const GeoScoreRange & r2) {
+  return r1.min < r2.min;
+}
+
+// Merges ranges which overlap or touch, returns the number left
+static size_t MergeScoreRanges(GeoScoreRange* ranges, size_t num) {
+  if (num == 0) {
+    return 0;
+  }
+  std::sort(ranges, ranges + num, sort_range_min);
+  size_t merged = 0;
+  for (size_t i = 1; i < num; i++) {
+    if (ranges[i].min <= ranges[merged].max) {
+      ranges[merged].max = std::max(ranges[merged].max, ranges[i].max);
+    } else {
+      ranges[++merged] = ranges[i];
+    }
+  }
+  return merged + 1;
+}
+
 static void GetAllNeighbors(std::shared_ptr<Partition> partition, std::string & key, GeoRange & range, CmdRes & res) {
   rocksdb::Status s;
   double longitude = range.longitude, latitude = range.latitude, distance = range.distance;
@@ -279,55 +306,70 @@ static void GetAllNeighbors(std::shared_ptr<Partition> partition, std::string &
   neighbors[7] = georadius.neighbors.south_east;
   neighbors[8] = georadius.neighbors.south_west;
 
-  // For each neighbor, get all the matching
-  // members and add them to the potential result list.
-  std::vector<NeighborPoint> result;
-  int last_processed = 0;
+  // The score ranges [min, max) of the boxes, overlapping or adjacent
+  // ones merged, so that each part of the zset is scanned only once
+  GeoScoreRange ranges[9];
+  size_t range_num = 0;
   for (size_t i = 0; i < sizeof(neighbors) / sizeof(*neighbors); i++) {
-    GeoHashFix52Bits min, max;
     if (HASHISZERO(neighbors[i]))
       continue;
-    min = geohashAlign52Bits(neighbors[i]);
+    ranges[range_num].min = geohashAlign52Bits(neighbors[i]);
     neighbors[i].bits++;
-    max = geohashAlign52Bits(neighbors[i]);
-    // When a huge Radius (in the 5000 km range or more) is used,
-    // adjacent neighbors can be the same, so need to remove duplicated elements
-    if(last_processed && neighbors[i].bits == neighbors[last_processed].bits && neighbors[i].step == neighbors[last_processed].step) {
-	continue;
-    }
-    std::vector<blackwidow::ScoreMember> score_members;
-    s = partition->db()->ZRangebyscore(key, (double)min, (double)max, true, true, &score_members);
+    ranges[range_num].max = geohashAlign52Bits(neighbors[i]);
+    range_num++;
+  }
+  range_num = MergeScoreRanges(ranges, range_num);
+
+  // Add the members within the search area to the potential result list
+  std::vector<NeighborPoint> result;
+  // Unsorted COUNT takes the first points found, no need to look further
+  size_t enough = (range.count && range.sort == Unsort && range.count_limit > 0)
+    ? range.count_limit : SIZE_MAX;
+  std::vector<blackwidow::ScoreMember> score_members;
+  std::vector<double> xys;
+  // a point out of the latitudes of the bounding box is out of the radius
+  double bounds[4];
+  geohashBoundingBox(longitude, latitude, distance, bounds);
+  for (size_t i = 0; i < range_num && result.size() < enough; i++) {
+    s = partition->db()->ZRangebyscore(key, (double)ranges[i].min, (double)ranges[i].max,
+                                       true, false, &score_members);
     if (!s.ok() && !s.IsNotFound()) {
       res.SetRes(CmdRes::kErrOther, s.ToString());
       return;
     }
-    // Insert into result only if the point is within the search area.
-    for (size_t i = 0; i < score_members.size(); ++i) {
-      double xy[2], real_distance;
-      GeoHashBits hash = { .bits = (uint64_t)score_members[i].score, .step = GEO_STEP_MAX };
-      geohashDecodeToLongLatWGS84(hash, xy);
-      if(geohashGetDistanceIfInRadiusWGS84(longitude, latitude, xy[0], xy[1], distance, &real_distance)) {
+    // Decode the whole batch first, then filter it
+    xys.resize(score_members.size() * 2);
+    for (size_t j = 0; j < score_members.size(); ++j) {
+      GeoHashBits hash = { .bits = (uint64_t)score_members[j].score, .step = GEO_STEP_MAX };
+      geohashDecodeToLongLatWGS84(hash, &xys[j * 2]);
+    }
+    for (size_t j = 0; j < score_members.size() && result.size() < enough; ++j) {
+      double real_distance;
+      if (xys[j * 2 + 1] < bounds[1] || xys[j * 2 + 1] > bounds[3]) {
+        continue;
+      }
+      if (geohashGetDistanceIfInRadiusWGS84(longitude, latitude, xys[j * 2], xys[j * 2 + 1],
+                                            distance, &real_distance)) {
         NeighborPoint item;
-        item.member = score_members[i].member;
-        item.score = score_members[i].score;
+        item.member = std::move(score_members[j].member);
+        item.score = score_members[j].score;
         item.distance = real_distance;
-        result.push_back(item);
+        result.push_back(std::move(item));
       }
     }
-    last_processed = i;
   }
-  
+
   // If using the count opiton
   if (range.count) {
     count_limit = static_cast<int>(result.size()) < range.count_limit ? result.size() : range.count_limit;
   } else {
     count_limit = result.size();
   }
-  // If using sort option
+  // If using sort option, only the first count_limit points need to be in order
   if (range.sort == Asc) {
-    std::sort(result.begin(), result.end(), sort_distance_asc);
+    std::partial_sort(result.begin(), result.begin() + count_limit, result.end(), sort_distance_asc);
   } else if(range.sort == Desc) {
-    std::sort(result.begin(), result.end(), sort_distance_desc);
+    std::partial_sort(result.begin(), result.begin() + count_limit, result.end(), sort_distance_desc);
   }
   
   if (range.store || range.storedist) {
@@ -361,11 +403,7 @@ static void GetAllNeighbors(std::shared_ptr<Partition> partition, std::string &
     
       // If using withdist option
       if (range.withdist) {  
-        double xy[2];
-        GeoHashBits hash = { .bits = (uint64_t)result[i].score, .step = GEO_STEP_MAX };
-        geohashDecodeToLongLatWGS84(hash, xy);
-        double distance = geohashGetDistance(longitude, latitude, xy[0], xy[1]);
-        distance = length_converter(distance, range.unit);
+        double distance = length_converter(result[i].distance, range.unit);
         char buf[32];
         sprintf(buf, "%.4f", distance);
         res.AppendStringLen(strlen(buf));
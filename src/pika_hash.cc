@@ -122,7 +122,7 @@ void HGetallCmd::Do(std::shared_ptr<Partition> partition) {
 
   if (s.ok() || s.IsNotFound()) {
     res_.AppendArrayLen(total_fv * 2);
-    res_.AppendStringRaw(raw);
+    AppendReplyRaw(&raw);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
@@ -0,0 +1,128 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_histogram.h"
+
+#include <sstream>
+
+LatencyHistogram::LatencyHistogram() {
+  Clear();
+}
+
+void LatencyHistogram::Add(uint64_t value) {
+  buckets_[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+  sum_.fetch_add(value, std::memory_order_relaxed);
+  uint64_t cur_max = max_.load(std::memory_order_relaxed);
+  while (value > cur_max
+    && !max_.compare_exchange_weak(cur_max, value, std::memory_order_relaxed)) {
+  }
+}
+
+void LatencyHistogram::Clear() {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    uint64_t count = other.buckets_[i].load(std::memory_order_relaxed);
+    if (count != 0) {
+      buckets_[i].fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+  count_.fetch_add(other.Count(), std::memory_order_relaxed);
+  sum_.fetch_add(other.sum_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  uint64_t value = other.Max();
+  uint64_t cur_max = max_.load(std::memory_order_relaxed);
+  while (value > cur_max
+    && !max_.compare_exchange_weak(cur_max, value, std::memory_order_relaxed)) {
+  }
+}
+
+uint64_t LatencyHistogram::Count() const {
+  return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Average() const {
+  uint64_t count = Count();
+  return count ? sum_.load(std::memory_order_relaxed) / count : 0;
+}
+
+uint64_t LatencyHistogram::Max() const {
+  return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Percentile(double p) const {
+  uint64_t total = 0;
+  uint64_t counts[kNumBuckets];
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  uint64_t target = static_cast<uint64_t>(total * p / 100);
+  if (target == 0) {
+    target = 1;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= target) {
+      uint64_t bound = BucketUpperBound(i);
+      uint64_t max = Max();
+      return bound < max ? bound : max;
+    }
+  }
+  return Max();
+}
+
+LatencySummary LatencyHistogram::Summary() const {
+  LatencySummary summary;
+  summary.count = Count();
+  summary.avg = Average();
+  summary.p50 = Percentile(50);
+  summary.p99 = Percentile(99);
+  summary.p999 = Percentile(99.9);
+  summary.max = Max();
+  return summary;
+}
+
+std::string LatencyHistogram::ToString() const {
+  LatencySummary summary = Summary();
+  std::stringstream tmp_stream;
+  tmp_stream << "count=" << summary.count
+             << ",avg=" << summary.avg
+             << ",p50=" << summary.p50
+             << ",p99=" << summary.p99
+             << ",p999=" << summary.p999
+             << ",max=" << summary.max;
+  return tmp_stream.str();
+}
+
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < 4) {
+    return value;
+  }
+  size_t msb = 63 - __builtin_clzll(value);
+  size_t sub = (value >> (msb - 2)) & 3;
+  return (msb - 1) * 4 + sub;
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < 4) {
+    return index;
+  }
+  size_t msb = index / 4 + 1;
+  uint64_t sub = index % 4;
+  uint64_t lower = (4 + sub) << (msb - 2);
+  return lower + (static_cast<uint64_t>(1) << (msb - 2)) - 1;
+}
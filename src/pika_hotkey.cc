@@ -0,0 +1,267 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_hotkey.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#include "slash/include/env.h"
+
+#include "include/pika_server.h"
+
+extern PikaServer* g_pika_server;
+
+static bool HotKeyLess(const HotKeyItem& a, const HotKeyItem& b) {
+  if (a.table_name != b.table_name) {
+    return a.table_name < b.table_name;
+  }
+  if (a.is_write != b.is_write) {
+    return !a.is_write;
+  }
+  return a.score > b.score;
+}
+
+static bool HotKeyScoreGreater(const HotKeyItem& a, const HotKeyItem& b) {
+  return a.score > b.score;
+}
+
+HotKeyTracker::CountMinSketch::CountMinSketch() {
+  Clear();
+}
+
+uint32_t HotKeyTracker::CountMinSketch::Add(size_t hash) {
+  // derive the row indices by double hashing
+  uint32_t h1 = static_cast<uint32_t>(hash);
+  uint32_t h2 = static_cast<uint32_t>(hash >> 32) | 1;
+  uint32_t estimate = UINT32_MAX;
+  for (int i = 0; i < kHotKeySketchDepth; ++i) {
+    uint32_t& counter = counters[i][(h1 + i * h2) % kHotKeySketchWidth];
+    ++counter;
+    estimate = std::min(estimate, counter);
+  }
+  return estimate;
+}
+
+void HotKeyTracker::CountMinSketch::Clear() {
+  memset(counters, 0, sizeof(counters));
+}
+
+HotKeyTracker::Slot::Slot() {
+  candidates_min[0] = candidates_min[1] = 0;
+}
+
+void HotKeyTracker::Slot::Add(const std::string& id, int type) {
+  if (!sketch[type]) {
+    sketch[type].reset(new CountMinSketch());
+  }
+  uint64_t estimate = sketch[type]->Add(std::hash<std::string>()(id));
+  std::unordered_map<std::string, uint64_t>& top = candidates[type];
+  std::unordered_map<std::string, uint64_t>::iterator iter = top.find(id);
+  if (iter != top.end()) {
+    iter->second = estimate;
+    return;
+  }
+  if (top.size() < kHotKeyCandidates) {
+    top.insert(std::make_pair(id, estimate));
+    return;
+  }
+  // candidates_min may lag behind, it only grows, so it is a lower bound
+  if (estimate <= candidates_min[type]) {
+    return;
+  }
+  std::unordered_map<std::string, uint64_t>::iterator min_iter = top.end();
+  uint64_t second_min = UINT64_MAX;
+  for (iter = top.begin(); iter != top.end(); ++iter) {
+    if (min_iter == top.end() || iter->second < min_iter->second) {
+      if (min_iter != top.end()) {
+        second_min = min_iter->second;
+      }
+      min_iter = iter;
+    } else if (iter->second < second_min) {
+      second_min = iter->second;
+    }
+  }
+  if (estimate <= min_iter->second) {
+    candidates_min[type] = min_iter->second;
+    return;
+  }
+  top.erase(min_iter);
+  top.insert(std::make_pair(id, estimate));
+  candidates_min[type] = std::min(second_min, estimate);
+}
+
+HotKeyTracker::HotKeyTracker()
+    : last_merge_us_(slash::NowMicros()),
+      window_us_(0) {
+}
+
+HotKeyTracker::~HotKeyTracker() {
+}
+
+size_t HotKeyTracker::CurrentThreadSlot() {
+  static std::atomic<size_t> next_slot(0);
+  static thread_local size_t slot = next_slot.fetch_add(1) % kHotKeySlots;
+  return slot;
+}
+
+bool HotKeyTracker::ShouldSample(int sample_rate) {
+  if (sample_rate <= 0) {
+    return false;
+  }
+  static thread_local uint32_t countdown = 0;
+  static thread_local uint32_t seed = static_cast<uint32_t>(
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  if (countdown > 1) {
+    --countdown;
+    return false;
+  }
+  // random gap with a mean of sample_rate, so that periodic traffic
+  // can't hide a key between two samples
+  seed = seed * 1103515245 + 12345;
+  countdown = 1 + (seed >> 8) % (2 * static_cast<uint64_t>(sample_rate) - 1);
+  return true;
+}
+
+void HotKeyTracker::Add(const std::string& table_name,
+                        const std::vector<std::string>& keys, bool is_write) {
+  if (keys.empty()) {
+    return;
+  }
+  Slot& slot = slots_[CurrentThreadSlot()];
+  std::string id;
+  slash::MutexLock l(&slot.mu);
+  for (const auto& key : keys) {
+    if (key.empty()) {
+      // commands without key report a single empty one
+      continue;
+    }
+    id.assign(table_name);
+    id.push_back('\0');
+    id.append(key);
+    slot.Add(id, is_write ? 1 : 0);
+  }
+}
+
+void HotKeyTracker::Merge(int sample_rate) {
+  std::unordered_map<std::string, uint64_t> sampled[2];
+  for (size_t i = 0; i < kHotKeySlots; ++i) {
+    Slot& slot = slots_[i];
+    slash::MutexLock l(&slot.mu);
+    for (int type = 0; type < 2; ++type) {
+      for (const auto& candidate : slot.candidates[type]) {
+        sampled[type][candidate.first] += candidate.second;
+      }
+      slot.candidates[type].clear();
+      slot.candidates_min[type] = 0;
+      if (slot.sketch[type]) {
+        slot.sketch[type]->Clear();
+      }
+    }
+  }
+
+  uint64_t rate = sample_rate > 0 ? sample_rate : 1;
+  slash::MutexLock l(&hot_keys_mu_);
+  uint64_t now = slash::NowMicros();
+  window_us_ = std::max<uint64_t>(now - last_merge_us_, 1);
+  last_merge_us_ = now;
+
+  // keyed by type + table + '\0' + key, old heat is halved every window
+  std::unordered_map<std::string, HotKeyItem> merged;
+  for (auto& item : hot_keys_) {
+    item.score /= 2;
+    item.ops_per_sec = 0;
+    if (item.score > 0) {
+      std::string id(1, item.is_write ? 'w' : 'r');
+      id.append(item.table_name);
+      id.push_back('\0');
+      id.append(item.key);
+      merged[id] = item;
+    }
+  }
+  for (int type = 0; type < 2; ++type) {
+    for (const auto& sample : sampled[type]) {
+      std::string id(1, type ? 'w' : 'r');
+      id.append(sample.first);
+      HotKeyItem& item = merged[id];
+      if (item.score == 0) {
+        size_t pos = sample.first.find('\0');
+        item.table_name = sample.first.substr(0, pos);
+        item.key = sample.first.substr(pos + 1);
+        item.is_write = type;
+        std::shared_ptr<Partition> partition =
+          g_pika_server->GetTablePartitionByKey(item.table_name, item.key);
+        item.partition_id = partition ? partition->GetPartitionId() : 0;
+      }
+      uint64_t estimate = sample.second * rate;
+      item.score += estimate;
+      item.ops_per_sec = estimate * 1000000 / window_us_;
+    }
+  }
+
+  // top kHotKeyTopK of every table and type
+  std::vector<HotKeyItem> all;
+  all.reserve(merged.size());
+  for (auto& item : merged) {
+    all.push_back(std::move(item.second));
+  }
+  std::sort(all.begin(), all.end(), HotKeyLess);
+  hot_keys_.clear();
+  size_t group_size = 0;
+  for (size_t i = 0; i < all.size(); ++i) {
+    if (i == 0 || all[i].table_name != all[i - 1].table_name
+      || all[i].is_write != all[i - 1].is_write) {
+      group_size = 0;
+    }
+    if (group_size++ < kHotKeyTopK) {
+      hot_keys_.push_back(std::move(all[i]));
+    }
+  }
+  std::sort(hot_keys_.begin(), hot_keys_.end(), HotKeyScoreGreater);
+}
+
+void HotKeyTracker::Reset() {
+  for (size_t i = 0; i < kHotKeySlots; ++i) {
+    Slot& slot = slots_[i];
+    slash::MutexLock l(&slot.mu);
+    for (int type = 0; type < 2; ++type) {
+      slot.candidates[type].clear();
+      slot.candidates_min[type] = 0;
+      if (slot.sketch[type]) {
+        slot.sketch[type]->Clear();
+      }
+    }
+  }
+  slash::MutexLock l(&hot_keys_mu_);
+  hot_keys_.clear();
+  last_merge_us_ = slash::NowMicros();
+  window_us_ = 0;
+}
+
+void HotKeyTracker::GetHotKeys(const std::string& table_name, size_t count,
+                               bool with_read, bool with_write,
+                               std::vector<HotKeyItem>* items) {
+  slash::MutexLock l(&hot_keys_mu_);
+  for (const auto& item : hot_keys_) {
+    if (items->size() >= count) {
+      break;
+    }
+    if ((!table_name.empty() && item.table_name != table_name)
+      || (item.is_write && !with_write)
+      || (!item.is_write && !with_read)) {
+      continue;
+    }
+    items->push_back(item);
+  }
+}
+
+uint64_t HotKeyTracker::window_us() {
+  slash::MutexLock l(&hot_keys_mu_);
+  return window_us_;
+}
@@ -5,6 +5,66 @@
 
 #include "include/pika_hyperloglog.h"
 
+#include <algorithm>
+#include <functional>
+
+static PfCountCache pf_count_cache;
+
+std::string PfCountCache::CacheKey(std::shared_ptr<Partition> partition,
+                                   const std::vector<std::string>& keys) {
+  std::string cache_key = partition->GetPartitionName();
+  for (const auto& key : keys) {
+    cache_key.append(1, '\0');
+    cache_key.append(std::to_string(key.size()));
+    cache_key.append(1, ':');
+    cache_key.append(key);
+  }
+  return cache_key;
+}
+
+uint64_t PfCountCache::Fingerprint(const rocksdb::Status& s, const std::string& value) {
+  if (s.IsNotFound()) {
+    return 0;
+  }
+  uint64_t fingerprint = std::hash<std::string>()(value) ^ (value.size() * 0x9E3779B97F4A7C15ULL);
+  return fingerprint != 0 ? fingerprint : 1;
+}
+
+PfCountCache::Shard* PfCountCache::GetShard(const std::string& cache_key) {
+  return &shards_[std::hash<std::string>()(cache_key) % kPfCountCacheShards];
+}
+
+bool PfCountCache::Get(const std::string& cache_key,
+                       const std::vector<uint64_t>& fingerprints, int64_t* count) {
+  Shard* shard = GetShard(cache_key);
+  slash::MutexLock l(&shard->mu);
+  auto iter = shard->entries.find(cache_key);
+  if (iter == shard->entries.end() || iter->second.fingerprints != fingerprints) {
+    return false;
+  }
+  *count = iter->second.count;
+  return true;
+}
+
+void PfCountCache::Put(const std::string& cache_key,
+                       const std::vector<uint64_t>& fingerprints, int64_t count) {
+  Shard* shard = GetShard(cache_key);
+  slash::MutexLock l(&shard->mu);
+  if (shard->entries.size() >= kPfCountCacheShardEntries
+    && shard->entries.find(cache_key) == shard->entries.end()) {
+    shard->entries.clear();
+  }
+  Entry& entry = shard->entries[cache_key];
+  entry.fingerprints = fingerprints;
+  entry.count = count;
+}
+
+void PfCountCache::Erase(const std::string& cache_key) {
+  Shard* shard = GetShard(cache_key);
+  slash::MutexLock l(&shard->mu);
+  shard->entries.erase(cache_key);
+}
+
 void PfAddCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNamePfAdd);
@@ -23,6 +83,7 @@ void PfAddCmd::Do(std::shared_ptr<Partition> partition) {
   bool update = false;
   rocksdb::Status s = partition->db()->PfAdd(key_, values_, &update);
   if (s.ok() && update) {
+    pf_count_cache.Erase(PfCountCache::CacheKey(partition, {key_}));
     res_.AppendInteger(1);
   } else if (s.ok() && !update) {
     res_.AppendInteger(0);
@@ -42,9 +103,44 @@ void PfCountCmd::DoInitial() {
   }
 }
 
+rocksdb::Status PfCountCmd::Fingerprints(std::shared_ptr<Partition> partition,
+                                         std::vector<uint64_t>* fingerprints) {
+  fingerprints->clear();
+  std::string value;
+  for (const auto& key : keys_) {
+    rocksdb::Status s = partition->db()->Get(key, &value);
+    if (!s.ok() && !s.IsNotFound()) {
+      return s;
+    }
+    fingerprints->push_back(PfCountCache::Fingerprint(s, value));
+  }
+  return rocksdb::Status::OK();
+}
+
 void PfCountCmd::Do(std::shared_ptr<Partition> partition) {
   int64_t value_ = 0;
-  rocksdb::Status s = partition->db()->PfCount(keys_, &value_);
+  std::string cache_key = PfCountCache::CacheKey(partition, keys_);
+  std::vector<uint64_t> fingerprints;
+  rocksdb::Status s = Fingerprints(partition, &fingerprints);
+  if (s.ok() && pf_count_cache.Get(cache_key, fingerprints, &value_)) {
+    res_.AppendInteger(value_);
+    return;
+  }
+
+  // No record lock here, Do runs under the db lock. The count is only
+  // cached if the keys hold the same values after it as before, and
+  // all of them exist: a missing key has the same fingerprint whatever
+  // it held before
+  bool cacheable = s.ok()
+    && std::find(fingerprints.begin(), fingerprints.end(), 0) == fingerprints.end();
+  s = partition->db()->PfCount(keys_, &value_);
+  if (s.ok() && cacheable) {
+    std::vector<uint64_t> fingerprints_after;
+    if (Fingerprints(partition, &fingerprints_after).ok()
+      && fingerprints_after == fingerprints) {
+      pf_count_cache.Put(cache_key, fingerprints, value_);
+    }
+  }
   if (s.ok()) {
     res_.AppendInteger(value_);
   } else {
@@ -66,6 +162,7 @@ void PfMergeCmd::DoInitial() {
 void PfMergeCmd::Do(std::shared_ptr<Partition> partition) {
   rocksdb::Status s = partition->db()->PfMerge(keys_);
   if (s.ok()) {
+    pf_count_cache.Erase(PfCountCache::CacheKey(partition, {keys_[0]}));
     res_.SetRes(CmdRes::kOk);
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
@@ -0,0 +1,108 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_io_throttle.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "slash/include/env.h"
+
+// longest single sleep, so that a raised limit applies quickly
+#define kIoThrottleMaxSleepUs (1000 * 1000)
+
+static thread_local IoThrottle* current_throttle = nullptr;
+
+IoThrottle::IoThrottle(const std::function<int64_t()>& limit)
+  : limit_(limit), start_us_(slash::NowMicros()), bytes_(0) {
+}
+
+void IoThrottle::Charge(size_t bytes) {
+  uint64_t total = bytes_.fetch_add(bytes) + bytes;
+  int64_t bytes_per_sec = limit_();
+  if (bytes_per_sec <= 0) {
+    return;
+  }
+  uint64_t expect_us = static_cast<uint64_t>(
+      static_cast<double>(total) * 1000000 / bytes_per_sec);
+  uint64_t elapsed_us = slash::NowMicros() - start_us_;
+  if (expect_us > elapsed_us) {
+    usleep(std::min<uint64_t>(expect_us - elapsed_us, kIoThrottleMaxSleepUs));
+  }
+}
+
+ScopedIoThrottle::ScopedIoThrottle(IoThrottle* throttle)
+  : prev_(current_throttle) {
+  current_throttle = throttle;
+}
+
+ScopedIoThrottle::~ScopedIoThrottle() {
+  current_throttle = prev_;
+}
+
+namespace {
+
+class ThrottledRandomAccessFile : public rocksdb::RandomAccessFile {
+ public:
+  explicit ThrottledRandomAccessFile(std::unique_ptr<rocksdb::RandomAccessFile>&& target)
+    : target_(std::move(target)) {
+  }
+
+  rocksdb::Status Read(uint64_t offset, size_t n, rocksdb::Slice* result,
+                       char* scratch) const override {
+    rocksdb::Status s = target_->Read(offset, n, result, scratch);
+    IoThrottle* throttle = current_throttle;
+    if (throttle != nullptr && s.ok()) {
+      throttle->Charge(result->size());
+    }
+    return s;
+  }
+  rocksdb::Status Prefetch(uint64_t offset, size_t n) override {
+    return target_->Prefetch(offset, n);
+  }
+  size_t GetUniqueId(char* id, size_t max_size) const override {
+    return target_->GetUniqueId(id, max_size);
+  }
+  void Hint(AccessPattern pattern) override {
+    target_->Hint(pattern);
+  }
+  bool use_direct_io() const override {
+    return target_->use_direct_io();
+  }
+  size_t GetRequiredBufferAlignment() const override {
+    return target_->GetRequiredBufferAlignment();
+  }
+  rocksdb::Status InvalidateCache(size_t offset, size_t length) override {
+    return target_->InvalidateCache(offset, length);
+  }
+
+ private:
+  std::unique_ptr<rocksdb::RandomAccessFile> target_;
+};
+
+class ThrottledEnv : public rocksdb::EnvWrapper {
+ public:
+  ThrottledEnv() : rocksdb::EnvWrapper(rocksdb::Env::Default()) {
+  }
+
+  rocksdb::Status NewRandomAccessFile(const std::string& fname,
+                                      std::unique_ptr<rocksdb::RandomAccessFile>* result,
+                                      const rocksdb::EnvOptions& options) override {
+    std::unique_ptr<rocksdb::RandomAccessFile> file;
+    rocksdb::Status s = target()->NewRandomAccessFile(fname, &file, options);
+    if (s.ok()) {
+      result->reset(new ThrottledRandomAccessFile(std::move(file)));
+    }
+    return s;
+  }
+};
+
+}  // namespace
+
+rocksdb::Env* IoThrottleEnv() {
+  static ThrottledEnv env;
+  return &env;
+}
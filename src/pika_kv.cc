@@ -110,7 +110,6 @@ std::string SetCmd::ToBinlog(
       BinlogType binlog_type) {
   if (condition_ == SetCmd::kEXORPX) {
     std::string content;
-    content.reserve(RAW_ARGS_LEN);
     RedisAppendLen(content, 4, "*");
 
     // to pksetexat cmd
@@ -177,15 +176,23 @@ void DelCmd::DoInitial() {
 
 void DelCmd::Do(std::shared_ptr<Partition> partition) {
   std::map<blackwidow::DataType, blackwidow::Status> type_status;
-  int64_t count = partition->db()->Del(keys_, &type_status);
-  if (count >= 0) {
-    res_.AppendInteger(count);
+  count_ = partition->db()->Del(keys_, &type_status);
+  if (count_ >= 0) {
+    res_.AppendInteger(count_);
   } else {
     res_.SetRes(CmdRes::kErrOther, "delete error");
   }
   return;
 }
 
+void DelCmd::MergeSubCmd(const std::vector<size_t>& positions, Cmd* sub_cmd) {
+  count_ += static_cast<DelCmd*>(sub_cmd)->count_;
+}
+
+void DelCmd::ReplyMerged() {
+  res_.AppendInteger(count_);
+}
+
 void IncrCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameIncr);
@@ -373,24 +380,36 @@ void MgetCmd::DoInitial() {
 }
 
 void MgetCmd::Do(std::shared_ptr<Partition> partition) {
-  std::vector<blackwidow::ValueStatus> vss;
-  rocksdb::Status s = partition->db()->MGet(keys_, &vss);
+  vss_.clear();
+  rocksdb::Status s = partition->db()->MGet(keys_, &vss_);
   if (s.ok()) {
-    res_.AppendArrayLen(vss.size());
-    for (const auto& vs : vss) {
-      if (vs.status.ok()) {
-        res_.AppendStringLen(vs.value.size());
-        res_.AppendContent(vs.value);
-      } else {
-        res_.AppendContent("$-1");
-      }
-    }
+    ReplyMerged();
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
   }
   return;
 }
 
+void MgetCmd::MergeSubCmd(const std::vector<size_t>& positions, Cmd* sub_cmd) {
+  std::vector<blackwidow::ValueStatus>& vss = static_cast<MgetCmd*>(sub_cmd)->vss_;
+  vss_.resize(keys_.size());
+  for (size_t idx = 0; idx < positions.size() && idx < vss.size(); ++idx) {
+    vss_[positions[idx]] = std::move(vss[idx]);
+  }
+}
+
+void MgetCmd::ReplyMerged() {
+  res_.AppendArrayLen(vss_.size());
+  for (const auto& vs : vss_) {
+    if (vs.status.ok()) {
+      res_.AppendStringLen(vs.value.size());
+      res_.AppendContent(vs.value);
+    } else {
+      res_.AppendContent("$-1");
+    }
+  }
+}
+
 void KeysCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameKeys);
@@ -438,8 +457,10 @@ void KeysCmd::Do(std::shared_ptr<Partition> partition) {
     total_key += keys.size();
   } while (cursor != 0);
 
+  // the key count is only known at the end, so keys are buffered once,
+  // but are written out from raw directly
   res_.AppendArrayLen(total_key);
-  res_.AppendStringRaw(raw);
+  AppendReplyRaw(&raw);
   return;
 }
 
@@ -473,7 +494,6 @@ std::string SetnxCmd::ToBinlog(
       BinlogType binlog_type) {
   std::string content;
   if (success_) {
-    content.reserve(RAW_ARGS_LEN);
     RedisAppendLen(content, 3, "*");
 
     // to set cmd
@@ -531,7 +551,6 @@ std::string SetexCmd::ToBinlog(
       BinlogType binlog_type) {
 
   std::string content;
-  content.reserve(RAW_ARGS_LEN);
   RedisAppendLen(content, 4, "*");
 
   // to pksetexat cmd
@@ -593,7 +612,6 @@ std::string PsetexCmd::ToBinlog(
       BinlogType binlog_type) {
 
   std::string content;
-  content.reserve(RAW_ARGS_LEN);
   RedisAppendLen(content, 4, "*");
 
   // to pksetexat cmd
@@ -668,6 +686,10 @@ void MsetCmd::Do(std::shared_ptr<Partition> partition) {
   }
 }
 
+void MsetCmd::ReplyMerged() {
+  res_.SetRes(CmdRes::kOk);
+}
+
 void MsetnxCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameMsetnx);
@@ -780,15 +802,23 @@ void ExistsCmd::DoInitial() {
 
 void ExistsCmd::Do(std::shared_ptr<Partition> partition) {
   std::map<blackwidow::DataType, rocksdb::Status> type_status;
-  int64_t res = partition->db()->Exists(keys_, &type_status);
-  if (res != -1) {
-    res_.AppendInteger(res);
+  count_ = partition->db()->Exists(keys_, &type_status);
+  if (count_ != -1) {
+    res_.AppendInteger(count_);
   } else {
     res_.SetRes(CmdRes::kErrOther, "exists internal error");
   }
   return;
 }
 
+void ExistsCmd::MergeSubCmd(const std::vector<size_t>& positions, Cmd* sub_cmd) {
+  count_ += static_cast<ExistsCmd*>(sub_cmd)->count_;
+}
+
+void ExistsCmd::ReplyMerged() {
+  res_.AppendInteger(count_);
+}
+
 void ExpireCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
     res_.SetRes(CmdRes::kWrongNum, kCmdNameExpire);
@@ -821,7 +851,6 @@ std::string ExpireCmd::ToBinlog(
       uint64_t offset,
       BinlogType binlog_type) {
   std::string content;
-  content.reserve(RAW_ARGS_LEN);
   RedisAppendLen(content, 3, "*");
 
   // to expireat cmd
@@ -881,7 +910,6 @@ std::string PexpireCmd::ToBinlog(
       uint64_t offset,
       BinlogType binlog_type) {
   std::string content;
-  content.reserve(RAW_ARGS_LEN);
   RedisAppendLen(content, argv_.size(), "*");
 
   // to expireat cmd
@@ -953,7 +981,6 @@ std::string PexpireatCmd::ToBinlog(
       uint64_t offset,
       BinlogType binlog_type) {
   std::string content;
-  content.reserve(RAW_ARGS_LEN);
   RedisAppendLen(content, argv_.size(), "*");
 
   // to expireat cmd
@@ -1359,11 +1386,13 @@ void PKScanRangeCmd::Do(std::shared_ptr<Partition> partition) {
         if (string_with_value) {
           res_.AppendString(kv.value);
         }
+        FlushReply();
       }
     } else {
       res_.AppendArrayLen(keys.size());
       for (const auto& key : keys){
         res_.AppendString(key);
+        FlushReply();
       }
     }
   } else {
@@ -1440,11 +1469,13 @@ void PKRScanRangeCmd::Do(std::shared_ptr<Partition> partition) {
         if (string_with_value) {
           res_.AppendString(kv.value);
         }
+        FlushReply();
       }
     } else {
       res_.AppendArrayLen(keys.size());
       for (const auto& key : keys){
         res_.AppendString(key);
+        FlushReply();
       }
     }
   } else {
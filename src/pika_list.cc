@@ -158,6 +158,7 @@ void LRangeCmd::Do(std::shared_ptr<Partition> partition) {
     res_.AppendArrayLen(values.size());
     for (const auto& value : values) {
       res_.AppendString(value);
+      FlushReply();
     }
   } else if (s.IsNotFound()) {
     res_.AppendArrayLen(0);
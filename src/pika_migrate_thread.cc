@@ -0,0 +1,609 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_migrate_thread.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+
+#include "pink/include/pink_cli.h"
+#include "pink/include/redis_cli.h"
+#include "slash/include/env.h"
+#include "slash/include/slash_string.h"
+
+#include "include/pika_conf.h"
+#include "include/pika_server.h"
+#include "include/pika_cmd_table_manager.h"
+
+extern PikaServer* g_pika_server;
+extern PikaConf* g_pika_conf;
+extern PikaCmdTableManager* g_pika_cmd_table_manager;
+
+/*
+ * Pipelined connection to the destination of a migration
+ */
+class MigrateSender {
+ public:
+  explicit MigrateSender(const MigrateDest& dest)
+      : dest_(dest),
+        cli_(pink::NewRedisCli()),
+        pending_(0),
+        flushes_(0),
+        sent_bytes_(0) {}
+  ~MigrateSender() {
+    delete cli_;
+  }
+
+  Status Connect();
+  // Queue a command, the pipeline is flushed once it holds max_bulks
+  // commands or max_bytes bytes
+  Status Append(const PikaCmdArgsType& argv);
+  // Send the queued commands and check the reply of every one
+  Status Flush();
+
+  uint64_t flushes() const { return flushes_; }
+  uint64_t sent_bytes() const { return sent_bytes_; }
+
+ private:
+  std::string DestName() const {
+    return dest_.ip + ":" + std::to_string(dest_.port);
+  }
+
+  MigrateDest dest_;
+  pink::PinkCli* cli_;
+  std::string buf_;
+  int64_t pending_;
+  uint64_t flushes_;
+  uint64_t sent_bytes_;
+};
+
+Status MigrateSender::Connect() {
+  cli_->set_connect_timeout(dest_.timeout_ms);
+  Status s = cli_->Connect(dest_.ip, dest_.port, "");
+  if (!s.ok()) {
+    return Status::IOError("connect " + DestName(), s.ToString());
+  }
+  cli_->set_send_timeout(dest_.timeout_ms);
+  cli_->set_recv_timeout(dest_.timeout_ms);
+
+  // instances of one cluster share the password
+  std::string requirepass = g_pika_conf->requirepass();
+  if (!requirepass.empty()) {
+    s = Append({"auth", requirepass});
+    if (s.ok()) {
+      s = Flush();
+    }
+  }
+  return s;
+}
+
+Status MigrateSender::Append(const PikaCmdArgsType& argv) {
+  RedisAppendLen(buf_, argv.size(), "*");
+  for (const auto& arg : argv) {
+    RedisAppendLen(buf_, arg.size(), "$");
+    RedisAppendContent(buf_, arg);
+  }
+  ++pending_;
+  if (pending_ >= dest_.max_bulks
+    || static_cast<int64_t>(buf_.size()) >= dest_.max_bytes) {
+    return Flush();
+  }
+  return Status::OK();
+}
+
+Status MigrateSender::Flush() {
+  if (pending_ == 0) {
+    return Status::OK();
+  }
+  Status s = cli_->Send(&buf_);
+  if (!s.ok()) {
+    return Status::IOError("send to " + DestName(), s.ToString());
+  }
+  sent_bytes_ += buf_.size();
+  buf_.clear();
+  ++flushes_;
+
+  int64_t num;
+  pink::RedisCmdArgsType reply;
+  for (; pending_ > 0; --pending_) {
+    reply.clear();
+    s = cli_->Recv(&reply);
+    if (!s.ok()) {
+      return Status::IOError("recv from " + DestName(), s.ToString());
+    }
+    // every restore command replies OK or an integer, the parser
+    // keeps no mark of an error reply
+    if (reply.size() != 1
+      || (reply[0] != "OK"
+        && !slash::string2l(reply[0].data(), reply[0].size(), &num))) {
+      return Status::Corruption(DestName() + " replied "
+                                + (reply.empty() ? "nothing" : reply[0]));
+    }
+  }
+  return Status::OK();
+}
+
+static Status DumpString(std::shared_ptr<Partition> partition,
+                         const std::string& key, MigrateSender* sender) {
+  std::string value;
+  rocksdb::Status s = partition->db()->Get(key, &value);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return Status::Corruption(s.ToString());
+  }
+  return sender->Append({"set", key, value});
+}
+
+static Status DumpHash(std::shared_ptr<Partition> partition,
+                       const std::string& key, MigrateSender* sender) {
+  int64_t cursor = 0, next_cursor = 0;
+  std::vector<blackwidow::FieldValue> fvs;
+  PikaCmdArgsType argv;
+  do {
+    fvs.clear();
+    rocksdb::Status s = partition->db()->HScan(key, cursor, "*",
+        kMigrateElementsPerCmd, &fvs, &next_cursor);
+    if (s.IsNotFound()) {
+      break;
+    } else if (!s.ok()) {
+      return Status::Corruption(s.ToString());
+    }
+    cursor = next_cursor;
+    if (fvs.empty()) {
+      continue;
+    }
+    argv.clear();
+    argv.push_back("hmset");
+    argv.push_back(key);
+    for (const auto& fv : fvs) {
+      argv.push_back(fv.field);
+      argv.push_back(fv.value);
+    }
+    Status ms = sender->Append(argv);
+    if (!ms.ok()) {
+      return ms;
+    }
+  } while (cursor != 0);
+  return Status::OK();
+}
+
+static Status DumpList(std::shared_ptr<Partition> partition,
+                       const std::string& key, MigrateSender* sender) {
+  uint64_t len = 0;
+  rocksdb::Status s = partition->db()->LLen(key, &len);
+  if (s.IsNotFound()) {
+    return Status::OK();
+  } else if (!s.ok()) {
+    return Status::Corruption(s.ToString());
+  }
+  std::vector<std::string> values;
+  PikaCmdArgsType argv;
+  for (uint64_t start = 0; start < len; start += kMigrateElementsPerCmd) {
+    values.clear();
+    s = partition->db()->LRange(key, start,
+        start + kMigrateElementsPerCmd - 1, &values);
+    if (!s.ok()) {
+      return Status::Corruption(s.ToString());
+    }
+    if (values.empty()) {
+      break;
+    }
+    argv.clear();
+    argv.push_back("rpush");
+    argv.push_back(key);
+    argv.insert(argv.end(), values.begin(), values.end());
+    Status ms = sender->Append(argv);
+    if (!ms.ok()) {
+      return ms;
+    }
+  }
+  return Status::OK();
+}
+
+static Status DumpSet(std::shared_ptr<Partition> partition,
+                      const std::string& key, MigrateSender* sender) {
+  int64_t cursor = 0, next_cursor = 0;
+  std::vector<std::string> members;
+  PikaCmdArgsType argv;
+  do {
+    members.clear();
+    rocksdb::Status s = partition->db()->SScan(key, cursor, "*",
+        kMigrateElementsPerCmd, &members, &next_cursor);
+    if (s.IsNotFound()) {
+      break;
+    } else if (!s.ok()) {
+      return Status::Corruption(s.ToString());
+    }
+    cursor = next_cursor;
+    if (members.empty()) {
+      continue;
+    }
+    argv.clear();
+    argv.push_back("sadd");
+    argv.push_back(key);
+    argv.insert(argv.end(), members.begin(), members.end());
+    Status ms = sender->Append(argv);
+    if (!ms.ok()) {
+      return ms;
+    }
+  } while (cursor != 0);
+  return Status::OK();
+}
+
+static Status DumpZSet(std::shared_ptr<Partition> partition,
+                       const std::string& key, MigrateSender* sender) {
+  int64_t cursor = 0, next_cursor = 0;
+  std::vector<blackwidow::ScoreMember> score_members;
+  PikaCmdArgsType argv;
+  char buf[32];
+  do {
+    score_members.clear();
+    rocksdb::Status s = partition->db()->ZScan(key, cursor, "*",
+        kMigrateElementsPerCmd, &score_members, &next_cursor);
+    if (s.IsNotFound()) {
+      break;
+    } else if (!s.ok()) {
+      return Status::Corruption(s.ToString());
+    }
+    cursor = next_cursor;
+    if (score_members.empty()) {
+      continue;
+    }
+    argv.clear();
+    argv.push_back("zadd");
+    argv.push_back(key);
+    for (const auto& score_member : score_members) {
+      int len = slash::d2string(buf, sizeof(buf), score_member.score);
+      argv.push_back(std::string(buf, len));
+      argv.push_back(score_member.member);
+    }
+    Status ms = sender->Append(argv);
+    if (!ms.ok()) {
+      return ms;
+    }
+  } while (cursor != 0);
+  return Status::OK();
+}
+
+// Queue the commands rebuilding every type of key on the destination,
+// exist tells if it had any
+static Status DumpKey(std::shared_ptr<Partition> partition,
+                      const std::string& key, MigrateSender* sender, bool* exist) {
+  std::map<blackwidow::DataType, rocksdb::Status> type_status;
+  std::map<blackwidow::DataType, int64_t> type_ttl =
+      partition->db()->TTL(key, &type_status);
+  *exist = false;
+  for (const auto& item : type_ttl) {
+    if (item.second == -3) {
+      return Status::Corruption("ttl of " + key + " failed");
+    } else if (item.second == -2) {
+      continue;
+    }
+
+    Status s;
+    if (!*exist) {
+      // drop whatever an earlier failed attempt left on the destination
+      *exist = true;
+      s = sender->Append({"del", key});
+      if (!s.ok()) {
+        return s;
+      }
+    }
+    switch (item.first) {
+      case blackwidow::kStrings:
+        s = DumpString(partition, key, sender);
+        break;
+      case blackwidow::kHashes:
+        s = DumpHash(partition, key, sender);
+        break;
+      case blackwidow::kLists:
+        s = DumpList(partition, key, sender);
+        break;
+      case blackwidow::kSets:
+        s = DumpSet(partition, key, sender);
+        break;
+      case blackwidow::kZSets:
+        s = DumpZSet(partition, key, sender);
+        break;
+      default:
+        break;
+    }
+    if (s.ok() && item.second > 0) {
+      // EXPIRE covers the types already sent as well, a key of several
+      // types keeps the ttl of the last one
+      s = sender->Append({"expire", key, std::to_string(item.second)});
+    }
+    if (!s.ok()) {
+      return s;
+    }
+  }
+  return Status::OK();
+}
+
+// Invoker holds the record locks of keys
+static Status DeleteKeys(std::shared_ptr<Partition> partition,
+                         const std::string& table_name,
+                         const std::vector<std::string>& keys) {
+  std::shared_ptr<Cmd> del_ptr = g_pika_cmd_table_manager->GetCmd(kCmdNameDel);
+  PikaCmdArgsType argv;
+  argv.reserve(keys.size() + 1);
+  argv.push_back(kCmdNameDel);
+  argv.insert(argv.end(), keys.begin(), keys.end());
+  del_ptr->Initial(std::move(argv), table_name);
+  if (del_ptr->res().ok()) {
+    // the binlog carries the delete to the slaves of this instance
+    del_ptr->ProcessCommandLocked(partition);
+  }
+  if (!del_ptr->res().ok()) {
+    return Status::Corruption("delete migrated keys: " + del_ptr->res().message());
+  }
+  return Status::OK();
+}
+
+PikaMigrateThread::PikaMigrateThread()
+    : cv_(&mu_),
+      scan_keys_(1),
+      start_us_(0),
+      pending_(false),
+      cancel_(false) {
+  set_thread_name("MigrateThread");
+}
+
+PikaMigrateThread::~PikaMigrateThread() {
+  StopThread();
+  LOG(INFO) << "PikaMigrate thread " << thread_id() << " exit!!!";
+}
+
+Status PikaMigrateThread::MigrateSlot(const MigrateDest& dest,
+                                      const std::string& table_name,
+                                      uint32_t slot, int64_t scan_keys) {
+  slash::MutexLock l(&mu_);
+  bool same = status_.table_name == table_name
+    && status_.slot == static_cast<int64_t>(slot)
+    && status_.dest.ip == dest.ip
+    && status_.dest.port == dest.port;
+  if (status_.migrating) {
+    if (same) {
+      return Status::OK();
+    }
+    return Status::Corruption("slot " + std::to_string(status_.slot)
+        + " is migrating to " + status_.dest.ip + ":" + std::to_string(status_.dest.port));
+  }
+
+  std::shared_ptr<Table> table = g_pika_server->GetTable(table_name);
+  std::shared_ptr<Partition> partition =
+      table ? table->GetPartitionById(slot) : nullptr;
+  if (!partition) {
+    return Status::NotFound("slot " + std::to_string(slot) + " not found");
+  }
+  std::vector<std::string> keys;
+  partition->db()->Scan(blackwidow::DataType::kAll, 0, "*", 1, &keys);
+  if (!same) {
+    status_ = MigrateStatus();
+    status_.table_name = table_name;
+    status_.slot = slot;
+  }
+  status_.dest = dest;
+  if (keys.empty()) {
+    // nothing left, the status of the migration which emptied it stays
+    status_.remained = 0;
+    return Status::OK();
+  }
+
+  status_.migrating = true;
+  status_.moved = 0;
+  status_.remained = 1;
+  status_.sent_bytes = 0;
+  status_.elapsed_us = 0;
+  status_.error.clear();
+  scan_keys_ = std::max<int64_t>(scan_keys, 1);
+  start_us_ = slash::NowMicros();
+  cancel_.store(false);
+  pending_ = true;
+  cv_.Signal();
+  return Status::OK();
+}
+
+void PikaMigrateThread::Cancel() {
+  slash::MutexLock l(&mu_);
+  if (status_.migrating) {
+    cancel_.store(true);
+  }
+}
+
+void PikaMigrateThread::GetStatus(MigrateStatus* status) {
+  slash::MutexLock l(&mu_);
+  *status = status_;
+  if (status_.migrating) {
+    status->elapsed_us = slash::NowMicros() - start_us_;
+  }
+}
+
+Status PikaMigrateThread::MigrateKeys(const MigrateDest& dest,
+                                      const std::string& table_name,
+                                      std::shared_ptr<Partition> partition,
+                                      const std::vector<std::string>& keys,
+                                      int64_t* moved) {
+  *moved = 0;
+  MigrateSender sender(dest);
+  Status s = sender.Connect();
+  if (s.ok()) {
+    s = MigrateBatches(&sender, table_name, partition, keys, moved);
+  }
+  return s;
+}
+
+bool PikaMigrateThread::IsKeyInflight(const std::string& table_name,
+                                      const std::string& key) {
+  slash::MutexLock l(&inflight_mu_);
+  auto iter = inflight_keys_.find(table_name);
+  return iter != inflight_keys_.end() && iter->second.count(key) != 0;
+}
+
+void PikaMigrateThread::AddInflight(const std::string& table_name,
+                                    const std::string& key) {
+  slash::MutexLock l(&inflight_mu_);
+  inflight_keys_[table_name].insert(key);
+}
+
+void PikaMigrateThread::RemoveInflight(const std::string& table_name,
+                                       const std::string& key) {
+  slash::MutexLock l(&inflight_mu_);
+  auto iter = inflight_keys_.find(table_name);
+  if (iter != inflight_keys_.end()) {
+    iter->second.erase(key);
+    if (iter->second.empty()) {
+      inflight_keys_.erase(iter);
+    }
+  }
+}
+
+Status PikaMigrateThread::MigrateBatches(MigrateSender* sender,
+                                         const std::string& table_name,
+                                         std::shared_ptr<Partition> partition,
+                                         const std::vector<std::string>& keys,
+                                         int64_t* moved) {
+  // locked in order, as MultiRecordLock does, so that a writer of
+  // several keys never deadlocks with us
+  std::vector<std::string> sorted(keys);
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  slash::lock::LockMgr* lock_mgr = partition->LockMgr();
+  std::vector<std::string> dumped;
+  Status s;
+  size_t begin = 0;
+  while (begin < sorted.size() && s.ok()) {
+    // a batch ends with the first flush of the pipeline, its keys are
+    // deleted locally once the destination has them all
+    size_t end = begin;
+    uint64_t flushes = sender->flushes();
+    dumped.clear();
+    while (end < sorted.size() && s.ok() && sender->flushes() == flushes) {
+      const std::string& key = sorted[end++];
+      AddInflight(table_name, key);
+      lock_mgr->TryLock(key);
+      bool exist = false;
+      s = DumpKey(partition, key, sender, &exist);
+      if (exist) {
+        dumped.push_back(key);
+      }
+    }
+    if (s.ok()) {
+      s = sender->Flush();
+    }
+    if (s.ok() && !dumped.empty()) {
+      s = DeleteKeys(partition, table_name, dumped);
+    }
+    for (size_t idx = begin; idx < end; ++idx) {
+      lock_mgr->UnLock(sorted[idx]);
+      RemoveInflight(table_name, sorted[idx]);
+    }
+    if (s.ok()) {
+      *moved += dumped.size();
+    }
+    begin = end;
+  }
+  return s;
+}
+
+void* PikaMigrateThread::ThreadMain() {
+  while (!should_stop()) {
+    {
+      slash::MutexLock l(&mu_);
+      if (!pending_) {
+        cv_.TimedWait(kMigrateIdleWaitMs);
+        continue;
+      }
+      pending_ = false;
+    }
+    RunMigrateSlot();
+  }
+  return nullptr;
+}
+
+void PikaMigrateThread::RunMigrateSlot() {
+  MigrateDest dest;
+  std::string table_name;
+  uint32_t slot;
+  int64_t scan_keys;
+  {
+    slash::MutexLock l(&mu_);
+    dest = status_.dest;
+    table_name = status_.table_name;
+    slot = status_.slot;
+    scan_keys = scan_keys_;
+  }
+  LOG(INFO) << "Start migrating slot " << slot << " of table " << table_name
+    << " to " << dest.ip << ":" << dest.port;
+
+  std::shared_ptr<Table> table = g_pika_server->GetTable(table_name);
+  std::shared_ptr<Partition> partition =
+      table ? table->GetPartitionById(slot) : nullptr;
+  if (!partition) {
+    FinishMigrateSlot(Status::NotFound("slot " + std::to_string(slot) + " not found"));
+    return;
+  }
+
+  // only an estimate, the slot takes writes until the proxy sends them
+  // to the destination
+  int64_t total = 0;
+  std::vector<blackwidow::KeyInfo> key_infos;
+  if (partition->GetKeyNum(&key_infos).ok()) {
+    for (const auto& key_info : key_infos) {
+      total += key_info.keys;
+    }
+  }
+
+  MigrateSender sender(dest);
+  Status s = sender.Connect();
+  int64_t cursor = 0, pass_moved = 0;
+  std::vector<std::string> keys;
+  while (s.ok()) {
+    if (cancel_.load() || should_stop()) {
+      s = Status::Incomplete("canceled");
+      break;
+    }
+    keys.clear();
+    cursor = partition->db()->Scan(blackwidow::DataType::kAll,
+                                   cursor, "*", scan_keys, &keys);
+    int64_t moved = 0;
+    s = MigrateBatches(&sender, table_name, partition, keys, &moved);
+    pass_moved += moved;
+    {
+      slash::MutexLock l(&mu_);
+      status_.moved += moved;
+      status_.remained = std::max<int64_t>(total - status_.moved, 1);
+      status_.sent_bytes = sender.sent_bytes();
+    }
+    if (cursor == 0) {
+      // keys written behind the cursor are left to another pass,
+      // until a pass finds none
+      if (pass_moved == 0) {
+        break;
+      }
+      pass_moved = 0;
+    }
+  }
+  FinishMigrateSlot(s);
+}
+
+void PikaMigrateThread::FinishMigrateSlot(const Status& s) {
+  slash::MutexLock l(&mu_);
+  status_.migrating = false;
+  status_.elapsed_us = slash::NowMicros() - start_us_;
+  if (s.ok()) {
+    status_.remained = 0;
+    status_.error.clear();
+  } else {
+    status_.error = s.ToString();
+  }
+  LOG(INFO) << "Migrate slot " << status_.slot << " of table " << status_.table_name
+    << " to " << status_.dest.ip << ":" << status_.dest.port
+    << " stopped, moved " << status_.moved << " keys in "
+    << status_.elapsed_us / 1000 << "ms: " << (s.ok() ? "done" : s.ToString());
+}
@@ -5,93 +5,131 @@
 
 #include "include/pika_monitor_thread.h"
 
+#include <fcntl.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 #include <glog/logging.h>
 
+#include "slash/include/env.h"
+#include "slash/include/slash_string.h"
+
+#include "include/pika_conf.h"
+
+extern PikaConf* g_pika_conf;
+
+static const int kMonitorMaxEvents = 64;
+
 PikaMonitorThread::PikaMonitorThread()
   : pink::Thread(),
-    monitor_cond_(&monitor_mutex_protector_) {
+    sleeping_(false),
+    has_monitor_clients_(false),
+    dropped_messages_(0),
+    monitor_messages_(kMonitorQueueSize),
+    has_tasks_(false) {
   set_thread_name("MonitorThread");
-  has_monitor_clients_.store(false);
+  epfd_ = epoll_create(kMonitorMaxEvents);
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epfd_ < 0 || wakeup_fd_ < 0) {
+    LOG(FATAL) << "PikaMonitorThread init epoll failed: " << strerror(errno);
+  }
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = wakeup_fd_;
+  epoll_ctl(epfd_, EPOLL_CTL_ADD, wakeup_fd_, &ev);
 }
 
 PikaMonitorThread::~PikaMonitorThread() {
   set_should_stop();
   if (is_running()) {
-    monitor_cond_.SignalAll();
+    sleeping_.store(true);
+    Wakeup();
     StopThread();
   }
-  for (std::list<ClientInfo>::iterator iter = monitor_clients_.begin();
+  for (std::list<MonitorClient>::iterator iter = monitor_clients_.begin();
       iter != monitor_clients_.end();
       ++iter) {
-    close(iter->fd);
+    close(iter->info.fd);
+  }
+  for (size_t i = 0; i < pending_clients_.size(); ++i) {
+    close(pending_clients_[i].fd);
   }
+  close(wakeup_fd_);
+  close(epfd_);
   LOG(INFO) << "PikaMonitorThread " << pthread_self() << " exit!!!";
 }
 
 void PikaMonitorThread::AddMonitorClient(std::shared_ptr<PikaClientConn> client_ptr) {
   StartThread();
-  slash::MutexLock lm(&monitor_mutex_protector_);
-  monitor_clients_.push_back(ClientInfo{client_ptr->fd(), client_ptr->ip_port(), 0, client_ptr});
-  has_monitor_clients_.store(true);
+  {
+    slash::MutexLock lm(&monitor_mutex_protector_);
+    pending_clients_.push_back(ClientInfo{client_ptr->fd(), client_ptr->ip_port(), 0, client_ptr});
+    has_monitor_clients_.store(true);
+    has_tasks_.store(true);
+  }
+  Wakeup();
 }
 
-void PikaMonitorThread::RemoveMonitorClient(const std::string& ip_port) {
-  std::list<ClientInfo>::iterator iter = monitor_clients_.begin();
-  for (; iter != monitor_clients_.end(); ++iter) {
-    if (ip_port == "all") {
-      close(iter->fd);
-      continue;
-    }
-    if (iter->ip_port  == ip_port) {
-      close(iter->fd);
-      break;
-    }
+void PikaMonitorThread::AddMonitorMessage(const std::string& table_name,
+                                          const std::string& ip_port,
+                                          const PikaCmdArgsType& argv) {
+  MonitorItem item;
+  item.time_us = slash::NowMicros();
+  item.table_name = table_name;
+  item.ip_port = ip_port;
+  item.argv = argv;
+  if (!monitor_messages_.TryPush(std::move(item))) {
+    dropped_messages_.fetch_add(1, std::memory_order_relaxed);
+    return;
   }
-  if (ip_port == "all") {
-    monitor_clients_.clear();
-  } else if (iter != monitor_clients_.end()) {
-    monitor_clients_.erase(iter);
-  }
-  has_monitor_clients_.store(!monitor_clients_.empty());
+  Wakeup();
 }
 
-void PikaMonitorThread::AddMonitorMessage(const std::string &monitor_message) {
-    slash::MutexLock lm(&monitor_mutex_protector_);
-    if (monitor_messages_.empty() && cron_tasks_.empty()) {
-      monitor_messages_.push_back(monitor_message);
-      monitor_cond_.Signal();
-    } else {
-      monitor_messages_.push_back(monitor_message);
-    }
+void PikaMonitorThread::Wakeup() {
+  // pairs with the fence in ThreadMain, either we see the thread going
+  // to sleep or it sees what we just pushed
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.load(std::memory_order_relaxed)) {
+    uint64_t one = 1;
+    ssize_t ret = write(wakeup_fd_, &one, sizeof(one));
+    (void)ret;
+  }
 }
 
 int32_t PikaMonitorThread::ThreadClientList(std::vector<ClientInfo>* clients_ptr) {
+  slash::MutexLock lm(&monitor_mutex_protector_);
   if (clients_ptr != NULL) {
-    for (std::list<ClientInfo>::iterator iter = monitor_clients_.begin();
+    for (std::list<MonitorClient>::iterator iter = monitor_clients_.begin();
         iter != monitor_clients_.end();
         iter++) {
-      clients_ptr->push_back(*iter);
+      clients_ptr->push_back(iter->info);
     }
   }
   return monitor_clients_.size();
 }
 
 void PikaMonitorThread::AddCronTask(MonitorCronTask task) {
-  slash::MutexLock lm(&monitor_mutex_protector_);
-  if (monitor_messages_.empty() && cron_tasks_.empty()) {
-    cron_tasks_.push(task);
-    monitor_cond_.Signal();
-  } else {
+  {
+    slash::MutexLock lm(&monitor_mutex_protector_);
     cron_tasks_.push(task);
+    has_tasks_.store(true);
   }
+  Wakeup();
 }
 
 bool PikaMonitorThread::FindClient(const std::string &ip_port) {
   slash::MutexLock lm(&monitor_mutex_protector_);
-  for (std::list<ClientInfo>::iterator iter = monitor_clients_.begin();
+  for (std::list<MonitorClient>::iterator iter = monitor_clients_.begin();
       iter != monitor_clients_.end();
       ++iter) {
-    if (iter->ip_port == ip_port) {
+    if (iter->info.ip_port == ip_port) {
+      return true;
+    }
+  }
+  for (size_t i = 0; i < pending_clients_.size(); ++i) {
+    if (pending_clients_[i].ip_port == ip_port) {
       return true;
     }
   }
@@ -115,89 +153,254 @@ bool PikaMonitorThread::HasMonitorClients() {
   return has_monitor_clients_.load();
 }
 
-pink::WriteStatus PikaMonitorThread::SendMessage(int32_t fd, std::string& message) {
-  size_t retry = 0;
-  ssize_t nwritten = 0, message_len_sended = 0, message_len_left = message.size();
-  while (message_len_left > 0) {
-    nwritten = write(fd, message.data() + message_len_sended, message_len_left);
-    if (nwritten == -1 && errno == EAGAIN) {
-      // If the write buffer is full, but the client no longer consumes, it will
-      // get stuck in the loop and cause the entire Pika to block becase of monitor_mutex_protector_.
-      // So we put a limit on the number of retries
-      if (++retry >= 10) {
-        return pink::kWriteError;
-      } else {
-        // Sleep one second wait for client consume message
-        sleep(1);
-        continue;
-      }
-    } else if (nwritten == -1) {
-      return pink::kWriteError;
+uint64_t PikaMonitorThread::DroppedMessages() {
+  return dropped_messages_.load(std::memory_order_relaxed);
+}
+
+void PikaMonitorThread::HandleNewClients() {
+  std::vector<ClientInfo> clients;
+  {
+    slash::MutexLock lm(&monitor_mutex_protector_);
+    clients.swap(pending_clients_);
+  }
+  for (size_t i = 0; i < clients.size(); ++i) {
+    int fd = clients[i].fd;
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+      LOG(WARNING) << "Monitor client " << clients[i].ip_port
+        << " set nonblock failed: " << strerror(errno);
+      close(fd);
+      continue;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLRDHUP;
+    ev.data.fd = fd;
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev) == -1) {
+      LOG(WARNING) << "Monitor client " << clients[i].ip_port
+        << " add to epoll failed: " << strerror(errno);
+      close(fd);
+      continue;
+    }
+    MonitorClient* client;
+    {
+      slash::MutexLock lm(&monitor_mutex_protector_);
+      monitor_clients_.push_back(MonitorClient(clients[i]));
+      client = &monitor_clients_.back();
+    }
+    // MonitorCmd leaves the reply to us
+    client->buf.assign("+OK\r\n");
+    if (!FlushClient(client)) {
+      RemoveMonitorClient(fd);
+    }
+  }
+}
+
+void PikaMonitorThread::HandleCronTasks() {
+  std::queue<MonitorCronTask> tasks;
+  {
+    slash::MutexLock lm(&monitor_mutex_protector_);
+    tasks.swap(cron_tasks_);
+  }
+  while (!tasks.empty()) {
+    MonitorCronTask task = tasks.front();
+    tasks.pop();
+    RemoveMonitorClient(task.ip_port);
+    if (task.task == TASK_KILLALL) {
+      break;
     }
-    if (retry > 0) retry = 0;
-    message_len_sended += nwritten;
-    message_len_left -= nwritten;
   }
-  return pink::kWriteAll;
+}
+
+void PikaMonitorThread::CloseClient(const MonitorClient& client) {
+  epoll_ctl(epfd_, EPOLL_CTL_DEL, client.info.fd, NULL);
+  close(client.info.fd);
+  if (client.dropped > 0) {
+    LOG(INFO) << "Monitor client " << client.info.ip_port << " closed, "
+      << client.dropped << " messages dropped because it was too slow";
+  }
+}
+
+void PikaMonitorThread::RemoveMonitorClient(const std::string& ip_port) {
+  slash::MutexLock lm(&monitor_mutex_protector_);
+  std::list<MonitorClient>::iterator iter = monitor_clients_.begin();
+  for (; iter != monitor_clients_.end(); ++iter) {
+    if (ip_port == "all") {
+      CloseClient(*iter);
+      continue;
+    }
+    if (iter->info.ip_port == ip_port) {
+      CloseClient(*iter);
+      break;
+    }
+  }
+  if (ip_port == "all") {
+    monitor_clients_.clear();
+  } else if (iter != monitor_clients_.end()) {
+    monitor_clients_.erase(iter);
+  }
+  has_monitor_clients_.store(!monitor_clients_.empty() || !pending_clients_.empty());
+}
+
+void PikaMonitorThread::RemoveMonitorClient(int32_t client_fd) {
+  slash::MutexLock lm(&monitor_mutex_protector_);
+  for (std::list<MonitorClient>::iterator iter = monitor_clients_.begin();
+      iter != monitor_clients_.end();
+      ++iter) {
+    if (iter->info.fd == client_fd) {
+      CloseClient(*iter);
+      monitor_clients_.erase(iter);
+      break;
+    }
+  }
+  has_monitor_clients_.store(!monitor_clients_.empty() || !pending_clients_.empty());
+}
+
+void PikaMonitorThread::FormatMessages(std::string* messages, size_t* count) {
+  messages->clear();
+  *count = 0;
+  bool classic_mode = g_pika_conf->classic_mode();
+  char time_buf[32];
+  MonitorItem item;
+  // bounded, so that a flood of commands can't starve the clients
+  while (*count < monitor_messages_.capacity()
+    && monitor_messages_.TryPop(&item)) {
+    ++(*count);
+    if (monitor_clients_.empty()) {
+      continue;
+    }
+    int len = snprintf(time_buf, sizeof(time_buf), "%lu.%06lu",
+                       static_cast<unsigned long>(item.time_us / 1000000),
+                       static_cast<unsigned long>(item.time_us % 1000000));
+    messages->append("+");
+    messages->append(time_buf, len);
+    messages->append(" [");
+    if (classic_mode && item.table_name.size() > 2) {
+      messages->append(item.table_name, 2, std::string::npos);
+    } else {
+      messages->append(item.table_name);
+    }
+    messages->append(" ");
+    messages->append(item.ip_port);
+    messages->append("]");
+    for (size_t i = 0; i < item.argv.size(); ++i) {
+      messages->append(" ");
+      messages->append(slash::ToRead(item.argv[i]));
+    }
+    messages->append("\r\n");
+  }
+}
+
+void PikaMonitorThread::DispatchMessages(const std::string& messages, size_t count) {
+  std::vector<int32_t> broken_fds;
+  for (std::list<MonitorClient>::iterator iter = monitor_clients_.begin();
+      iter != monitor_clients_.end();
+      ++iter) {
+    MonitorClient* client = &(*iter);
+    if (client->buf.size() - client->buf_pos + messages.size() > kMonitorClientMaxBuffer) {
+      // the client does not keep up, drop instead of blocking everyone
+      client->dropped += count;
+      dropped_messages_.fetch_add(count, std::memory_order_relaxed);
+      continue;
+    }
+    client->buf.append(messages);
+    if (!client->want_write && !FlushClient(client)) {
+      broken_fds.push_back(client->info.fd);
+    }
+  }
+  for (size_t i = 0; i < broken_fds.size(); ++i) {
+    RemoveMonitorClient(broken_fds[i]);
+  }
+}
+
+bool PikaMonitorThread::FlushClient(MonitorClient* client) {
+  while (client->buf_pos < client->buf.size()) {
+    ssize_t nwritten = write(client->info.fd, client->buf.data() + client->buf_pos,
+                             client->buf.size() - client->buf_pos);
+    if (nwritten > 0) {
+      client->buf_pos += nwritten;
+    } else if (nwritten == -1 && errno == EINTR) {
+      continue;
+    } else if (nwritten == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else {
+      return false;
+    }
+  }
+  if (client->buf_pos == client->buf.size()) {
+    client->buf.clear();
+    client->buf_pos = 0;
+  } else if (client->buf_pos > client->buf.size() / 2) {
+    client->buf.erase(0, client->buf_pos);
+    client->buf_pos = 0;
+  }
+  UpdateWriteInterest(client);
+  return true;
+}
+
+void PikaMonitorThread::UpdateWriteInterest(MonitorClient* client) {
+  bool want_write = !client->buf.empty();
+  if (want_write == client->want_write) {
+    return;
+  }
+  struct epoll_event ev;
+  ev.events = EPOLLRDHUP | (want_write ? EPOLLOUT : 0);
+  ev.data.fd = client->info.fd;
+  epoll_ctl(epfd_, EPOLL_CTL_MOD, client->info.fd, &ev);
+  client->want_write = want_write;
 }
 
 void* PikaMonitorThread::ThreadMain() {
-  std::deque<std::string> messages_deque;
-  std::string messages_transfer;
-  MonitorCronTask task;
-  pink::WriteStatus write_status;
+  struct epoll_event events[kMonitorMaxEvents];
+  std::string messages;
+  size_t count = 0;
+  uint64_t wakeup_count;
   while (!should_stop()) {
-    {
-      slash::MutexLock lm(&monitor_mutex_protector_);
-      while (monitor_messages_.empty() && cron_tasks_.empty() && !should_stop()) {
-        monitor_cond_.Wait();
-      }
+    int timeout = kMonitorIdleWaitMs;
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!monitor_messages_.Empty() || has_tasks_.load()) {
+      timeout = 0;
     }
+    int nfds = epoll_wait(epfd_, events, kMonitorMaxEvents, timeout);
+    sleeping_.store(false, std::memory_order_relaxed);
     if (should_stop()) {
       break;
-    } 
-    {
-      slash::MutexLock lm(&monitor_mutex_protector_);
-      while (!cron_tasks_.empty()) {
-        task = cron_tasks_.front();
-        cron_tasks_.pop();
-        RemoveMonitorClient(task.ip_port);
-        if (task.task == TASK_KILLALL) {
-          std::queue<MonitorCronTask> empty_queue;
-          cron_tasks_.swap(empty_queue);
-        }
-      }
     }
 
-    messages_deque.clear();
-    {
-      slash::MutexLock lm(&monitor_mutex_protector_);
-      messages_deque.swap(monitor_messages_);
-      if (monitor_clients_.empty() || messages_deque.empty()) {
+    for (int i = 0; i < nfds; ++i) {
+      int fd = events[i].data.fd;
+      if (fd == wakeup_fd_) {
+        ssize_t ret = read(wakeup_fd_, &wakeup_count, sizeof(wakeup_count));
+        (void)ret;
         continue;
       }
+      if (events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+        RemoveMonitorClient(fd);
+        continue;
+      }
+      if (events[i].events & EPOLLOUT) {
+        for (std::list<MonitorClient>::iterator iter = monitor_clients_.begin();
+            iter != monitor_clients_.end();
+            ++iter) {
+          if (iter->info.fd == fd) {
+            if (!FlushClient(&(*iter))) {
+              RemoveMonitorClient(fd);
+            }
+            break;
+          }
+        }
+      }
     }
-    messages_transfer = "+";
-    for (std::deque<std::string>::iterator iter = messages_deque.begin();
-        iter != messages_deque.end();
-        ++iter) {
-      messages_transfer.append(iter->data(), iter->size());
-      messages_transfer.append("\n"); 
-    }
-    if (messages_transfer == "+") {
-      continue;
+
+    if (has_tasks_.exchange(false)) {
+      HandleNewClients();
+      HandleCronTasks();
     }
-    messages_transfer.replace(messages_transfer.size()-1, 1, "\r\n", 0, 2);
-    monitor_mutex_protector_.Lock();
-    for (std::list<ClientInfo>::iterator iter = monitor_clients_.begin();
-        iter != monitor_clients_.end();
-        ++iter) {
-      write_status = SendMessage(iter->fd, messages_transfer);
-      if (write_status == pink::kWriteError) {
-        cron_tasks_.push({TASK_KILL, iter->ip_port});
-      }
+
+    FormatMessages(&messages, &count);
+    if (!messages.empty()) {
+      DispatchMessages(messages, count);
     }
-    monitor_mutex_protector_.Unlock();
   }
   return NULL;
 }
@@ -17,6 +17,9 @@ extern PikaConf* g_pika_conf;
 extern PikaServer* g_pika_server;
 extern PikaReplicaManager* g_pika_rm;
 
+// Max number of binlog items appended by one group commit leader
+static const size_t kBinlogGroupCommitMaxNum = 128;
+
 std::string PartitionPath(const std::string& table_path,
                           uint32_t partition_id) {
   char buf[100];
@@ -63,6 +66,8 @@ Partition::Partition(const std::string& table_name,
                      const std::string& table_log_path) :
   table_name_(table_name),
   partition_id_(partition_id),
+  db_open_us_(0),
+  binlog_load_us_(0),
   binlog_io_error_(false),
   bgsave_engine_(NULL),
   purging_(false) {
@@ -78,15 +83,10 @@ Partition::Partition(const std::string& table_name,
   partition_name_ = g_pika_conf->classic_mode() ?
       table_name : PartitionName(table_name_, partition_id_);
 
-  pthread_rwlockattr_t attr;
-  pthread_rwlockattr_init(&attr);
-  pthread_rwlockattr_setkind_np(&attr,
-          PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
-
-  pthread_rwlock_init(&db_rwlock_, &attr);
-
+  uint64_t start_us = slash::NowMicros();
   db_ = std::shared_ptr<blackwidow::BlackWidow>(new blackwidow::BlackWidow());
   rocksdb::Status s = db_->Open(g_pika_server->bw_options(), db_path_);
+  db_open_us_ = slash::NowMicros() - start_us;
 
   lock_mgr_ = new slash::lock::LockMgr(1000, 0, std::make_shared<slash::lock::MutexFactoryImpl>());
 
@@ -95,14 +95,16 @@ Partition::Partition(const std::string& table_name,
   assert(s.ok());
   LOG(INFO) << partition_name_ << " DB Success";
 
+  start_us = slash::NowMicros();
   logger_ = std::shared_ptr<Binlog>(
           new Binlog(log_path_, g_pika_conf->binlog_file_size()));
+  binlog_load_us_ = slash::NowMicros() - start_us;
+  binlog_cache_ = std::make_shared<BinlogCache>(g_pika_conf->binlog_cache_size());
 }
 
 Partition::~Partition() {
   Close();
   delete bgsave_engine_;
-  pthread_rwlock_destroy(&db_rwlock_);
   delete lock_mgr_;
 }
 
@@ -115,7 +117,7 @@ void Partition::Close() {
   if (!opened_) {
     return;
   }
-  slash::RWLock rwl(&db_rwlock_, true);
+  ScalableRWLockGuard rwl(&db_rwlock_, true);
   db_.reset();
   logger_.reset();
   opened_ = false;
@@ -169,6 +171,10 @@ std::shared_ptr<Binlog> Partition::logger() const {
   return logger_;
 }
 
+std::shared_ptr<BinlogCache> Partition::binlog_cache() const {
+  return binlog_cache_;
+}
+
 std::shared_ptr<blackwidow::BlackWidow> Partition::db() const {
   return db_;
 }
@@ -180,7 +186,56 @@ Status Partition::WriteBinlog(const std::string& binlog) {
   }
   slash::Status s;
   if (!binlog.empty()) {
+    BinlogOffset start_offset;
+    logger_->GetProducerStatus(&start_offset.filenum, &start_offset.offset);
     s = logger_->Put(binlog);
+    if (s.ok() && binlog_cache_->capacity()) {
+      BinlogOffset end_offset;
+      logger_->GetProducerStatus(&end_offset.filenum, &end_offset.offset);
+      binlog_cache_->Append(start_offset, end_offset, binlog);
+    }
+  }
+
+  if (!s.ok()) {
+    LOG(WARNING) << partition_name_ << " Writing binlog failed, maybe no space left on device";
+    SetBinlogIoError(true);
+    return Status::Corruption("Writing binlog failed, maybe no space left on device");
+  }
+  // ship the new binlog to slaves right away instead of on the next poll
+  g_pika_server->SignalAuxiliary();
+  return Status::OK();
+}
+
+Status Partition::WriteBinlogBatch(const std::vector<std::string>& binlogs) {
+  if (!opened_) {
+    LOG(WARNING) << partition_name_ << " not opened, failed to exec command";
+    return Status::Corruption("Partition Not Opened");
+  }
+
+  std::vector<BinlogCacheItem> cache_items;
+  BinlogOffset start_offset, end_offset;
+  slash::Status s;
+  for (const auto& binlog : binlogs) {
+    if (binlog.empty()) {
+      continue;
+    }
+    logger_->GetProducerStatus(&start_offset.filenum, &start_offset.offset);
+    s = logger_->Append(binlog);
+    if (!s.ok()) {
+      break;
+    }
+    if (binlog_cache_->capacity()) {
+      logger_->GetProducerStatus(&end_offset.filenum, &end_offset.offset);
+      cache_items.push_back(BinlogCacheItem(start_offset, end_offset, binlog));
+    }
+  }
+  if (s.ok()) {
+    s = logger_->Sync();
+  }
+  if (s.ok()) {
+    for (const auto& item : cache_items) {
+      binlog_cache_->Append(item.start_offset, item.end_offset, item.binlog);
+    }
   }
 
   if (!s.ok()) {
@@ -188,6 +243,95 @@ Status Partition::WriteBinlog(const std::string& binlog) {
     SetBinlogIoError(true);
     return Status::Corruption("Writing binlog failed, maybe no space left on device");
   }
+  g_pika_server->SignalAuxiliary();
+  return Status::OK();
+}
+
+Status Partition::GroupWriteBinlog(const BinlogEncoder& encoder, BinlogOffset* const offset) {
+  BinlogWriter w(encoder, &binlog_writers_mu_);
+  slash::MutexLock l(&binlog_writers_mu_);
+  binlog_writers_.push_back(&w);
+  while (!w.done && &w != binlog_writers_.front()) {
+    w.cv.Wait();
+  }
+  if (w.done) {
+    *offset = w.offset;
+    return w.status;
+  }
+
+  // We are the leader now, take the pending writers as a batch
+  std::vector<BinlogWriter*> group;
+  for (const auto& writer : binlog_writers_) {
+    if (group.size() >= kBinlogGroupCommitMaxNum) {
+      break;
+    }
+    group.push_back(writer);
+  }
+
+  binlog_writers_mu_.Unlock();
+  Status s = WriteBinlogGroup(group);
+  binlog_writers_mu_.Lock();
+
+  for (size_t i = 0; i < group.size(); ++i) {
+    BinlogWriter* ready = binlog_writers_.front();
+    binlog_writers_.pop_front();
+    if (ready != &w) {
+      ready->status = s;
+      ready->done = true;
+      ready->cv.Signal();
+    }
+  }
+  // Notify new head of write queue
+  if (!binlog_writers_.empty()) {
+    binlog_writers_.front()->cv.Signal();
+  }
+  *offset = w.offset;
+  return s;
+}
+
+Status Partition::WriteBinlogGroup(const std::vector<BinlogWriter*>& group) {
+  if (!opened_) {
+    LOG(WARNING) << partition_name_ << " not opened, failed to exec command";
+    return Status::Corruption("Partition Not Opened");
+  }
+
+  std::vector<BinlogCacheItem> cache_items;
+  BinlogOffset start_offset;
+  uint64_t logic_id = 0;
+  slash::Status s;
+  logger_->Lock();
+  for (const auto& writer : group) {
+    logger_->GetProducerStatus(&start_offset.filenum, &start_offset.offset, &logic_id);
+    std::string binlog = writer->encoder(start_offset.filenum, start_offset.offset, logic_id);
+    if (binlog.empty()) {
+      writer->offset = start_offset;
+      continue;
+    }
+    s = logger_->Append(binlog);
+    if (!s.ok()) {
+      break;
+    }
+    logger_->GetProducerStatus(&writer->offset.filenum, &writer->offset.offset);
+    if (binlog_cache_->capacity()) {
+      cache_items.push_back(BinlogCacheItem(start_offset, writer->offset, binlog));
+    }
+  }
+  if (s.ok()) {
+    s = logger_->Sync();
+  }
+  if (s.ok()) {
+    for (const auto& item : cache_items) {
+      binlog_cache_->Append(item.start_offset, item.end_offset, item.binlog);
+    }
+  }
+  logger_->Unlock();
+
+  if (!s.ok()) {
+    LOG(WARNING) << partition_name_ << " Writing binlog failed, maybe no space left on device";
+    SetBinlogIoError(true);
+    return Status::Corruption("Writing binlog failed, maybe no space left on device");
+  }
+  g_pika_server->SignalAuxiliary();
   return Status::OK();
 }
 
@@ -196,16 +340,12 @@ void Partition::Compact(const blackwidow::DataType& type) {
   db_->Compact(type);
 }
 
-void Partition::DbRWLockWriter() {
-  pthread_rwlock_wrlock(&db_rwlock_);
-}
-
 void Partition::DbRWLockReader() {
-  pthread_rwlock_rdlock(&db_rwlock_);
+  db_rwlock_.ReadLock();
 }
 
 void Partition::DbRWUnLock() {
-  pthread_rwlock_unlock(&db_rwlock_);
+  db_rwlock_.ReadUnlock();
 }
 
 slash::lock::LockMgr* Partition::LockMgr() {
@@ -403,7 +543,7 @@ bool Partition::ChangeDb(const std::string& new_path,
   tmp_path += "_bak";
   slash::DeleteDirIfExist(tmp_path);
 
-  RWLock l(&db_rwlock_, true);
+  ScalableRWLockGuard l(&db_rwlock_, true);
   LOG(INFO) << "Partition: "<< partition_name_
       << ", Prepare change db from: " << tmp_path;
   db_.reset();
@@ -554,7 +694,7 @@ bool Partition::InitBgsaveEngine() {
   }
 
   {
-    RWLock l(&db_rwlock_, true);
+    ScalableRWLockGuard l(&db_rwlock_, true);
     {
       slash::MutexLock l(&bgsave_protector_);
       logger_->GetProducerStatus(&bgsave_info_.filenum, &bgsave_info_.offset);
@@ -580,7 +720,7 @@ void Partition::FinishBgsave() {
 }
 
 bool Partition::FlushDB() {
-  slash::RWLock rwl(&db_rwlock_, true);
+  ScalableRWLockGuard rwl(&db_rwlock_, true);
   slash::MutexLock ml(&bgsave_protector_);
   if (bgsave_info_.bgsaving) {
     return false;
@@ -606,7 +746,7 @@ bool Partition::FlushDB() {
 }
 
 bool Partition::FlushSubDB(const std::string& db_name) {
-  slash::RWLock rwl(&db_rwlock_, true);
+  ScalableRWLockGuard rwl(&db_rwlock_, true);
   slash::MutexLock ml(&bgsave_protector_);
   if (bgsave_info_.bgsaving) {
     return false;
@@ -733,6 +873,25 @@ void Partition::InitKeyScan() {
   key_scan_info_.duration = -1;       // duration -1 mean the task in processing
 }
 
+Status Partition::GetApproximateKeyNum(std::vector<blackwidow::KeyInfo>* key_info) {
+  static const std::string types[] = {blackwidow::STRINGS_DB, blackwidow::HASHES_DB,
+    blackwidow::LISTS_DB, blackwidow::ZSETS_DB, blackwidow::SETS_DB};
+  std::map<std::string, uint64_t> type_result;
+  DbRWLockReader();
+  if (!opened_) {
+    DbRWUnLock();
+    return Status::Corruption("Partition Not Opened");
+  }
+  db_->GetUsage("rocksdb.estimate-num-keys", &type_result);
+  DbRWUnLock();
+
+  key_info->assign(5, blackwidow::KeyInfo());
+  for (size_t idx = 0; idx < 5; ++idx) {
+    (*key_info)[idx].keys = type_result[types[idx]];
+  }
+  return Status::OK();
+}
+
 KeyScanInfo Partition::GetKeyScanInfo() {
   slash::MutexLock l(&key_info_protector_);
   return key_scan_info_;
@@ -783,6 +942,7 @@ Status Partition::GetKeyNum(std::vector<blackwidow::KeyInfo>* key_info) {
                                   // has not been scheduled for exec
   rocksdb::Status s = db_->GetKeyNum(key_info);
   if (!s.ok()) {
+    key_scan_info_.key_scaning_ = false;
     return Status::Corruption(s.ToString());
   }
   key_scan_info_.key_infos = *key_info;
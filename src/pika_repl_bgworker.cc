@@ -5,6 +5,10 @@
 
 #include "include/pika_repl_bgworker.h"
 
+#include <strings.h>
+
+#include <unordered_set>
+
 #include <glog/logging.h>
 
 #include "include/pika_rm.h"
@@ -17,9 +21,7 @@ extern PikaServer* g_pika_server;
 extern PikaReplicaManager* g_pika_rm;
 extern PikaCmdTableManager* g_pika_cmd_table_manager;
 
-PikaReplBgWorker::PikaReplBgWorker(int queue_size)
-    : bg_thread_(queue_size) {
-  bg_thread_.set_thread_name("ReplBgWorker");
+PikaReplBgWorker::PikaReplBgWorker() {
   pink::RedisParserSettings settings;
   settings.DealMessage = &(PikaReplBgWorker::HandleWriteBinlog);
   redis_parser_.RedisParserInit(REDIS_PARSER_REQUEST, settings);
@@ -28,20 +30,19 @@ PikaReplBgWorker::PikaReplBgWorker(int queue_size)
   partition_id_ = 0;
 }
 
-int PikaReplBgWorker::StartThread() {
-  return bg_thread_.StartThread();
-}
-
-int PikaReplBgWorker::StopThread() {
-  return bg_thread_.StopThread();
+PikaReplBgWorker* PikaReplBgWorker::Current() {
+  // a partition may run on any scheduler thread, each parses with its own
+  static thread_local PikaReplBgWorker worker;
+  return &worker;
 }
 
-void PikaReplBgWorker::Schedule(pink::TaskFunc func, void* arg) {
-  bg_thread_.Schedule(func, arg);
-}
-
-void PikaReplBgWorker::QueueClear() {
-  bg_thread_.QueueClear();
+void PikaReplBgWorker::ClearWriteDBTasks() {
+  for (const auto& task : db_tasks_) {
+    delete task.argv;
+    delete task.binlog_item;
+  }
+  db_tasks_.clear();
+  binlogs_.clear();
 }
 
 void PikaReplBgWorker::HandleBGWorkerWriteBinlog(void* arg) {
@@ -49,8 +50,10 @@ void PikaReplBgWorker::HandleBGWorkerWriteBinlog(void* arg) {
   const std::shared_ptr<InnerMessage::InnerResponse> res = task_arg->res;
   std::shared_ptr<pink::PbConn> conn = task_arg->conn;
   std::vector<int>* index = static_cast<std::vector<int>* >(task_arg->res_private_data);
-  PikaReplBgWorker* worker = task_arg->worker;
+  PikaReplBgWorker* worker = Current();
   worker->ip_port_ = conn->ip_port();
+  // Drop the leftover of a failed response
+  worker->ClearWriteDBTasks();
 
   std::string table_name;
   uint32_t partition_id = 0;
@@ -148,8 +151,21 @@ void PikaReplBgWorker::HandleBGWorkerWriteBinlog(void* arg) {
   delete index;
   delete task_arg;
 
-  // Reply Ack to master immediately
   std::shared_ptr<Binlog> logger = partition->logger();
+  if (!worker->binlogs_.empty()) {
+    logger->Lock();
+    partition->WriteBinlogBatch(worker->binlogs_);
+    logger->Unlock();
+  }
+  for (const auto& task : worker->db_tasks_) {
+    g_pika_rm->ScheduleWriteDBTask(slave_partition, task.dispatch_key,
+        task.is_barrier, task.argv, task.binlog_item);
+  }
+  // Task items are owned by the db tasks now
+  worker->db_tasks_.clear();
+  worker->binlogs_.clear();
+
+  // Reply Ack to master immediately
   logger->GetProducerStatus(&ack_end.filenum, &ack_end.offset);
   // keepalive case
   if (ack_start == BinlogOffset()) {
@@ -162,27 +178,19 @@ void PikaReplBgWorker::HandleBGWorkerWriteBinlog(void* arg) {
 int PikaReplBgWorker::HandleWriteBinlog(pink::RedisParser* parser, const pink::RedisCmdArgsType& argv) {
   PikaReplBgWorker* worker = static_cast<PikaReplBgWorker*>(parser->data);
   const BinlogItem& binlog_item = worker->binlog_item_;
-  g_pika_server->UpdateQueryNumAndExecCountTable(argv[0]);
 
-  // Monitor related
-  std::string monitor_message;
+  // Monitor related, formatted by the monitor thread
   if (g_pika_server->HasMonitorClients()) {
-    std::string table_name = g_pika_conf->classic_mode()
-      ? worker->table_name_.substr(2) : worker->table_name_;
-    std::string monitor_message = std::to_string(1.0 * slash::NowMicros() / 1000000)
-      + " [" + table_name + " " + worker->ip_port_ + "]";
-    for (const auto& item : argv) {
-      monitor_message += " " + slash::ToRead(item);
-    }
-    g_pika_server->AddMonitorMessage(monitor_message);
+    g_pika_server->AddMonitorMessage(worker->table_name_, worker->ip_port_, argv);
   }
 
-  std::string opt = argv[0];
-  std::shared_ptr<Cmd> c_ptr = g_pika_cmd_table_manager->GetCmd(slash::StringToLower(opt));
+  const std::string& opt = argv[0];
+  std::shared_ptr<Cmd> c_ptr = g_pika_cmd_table_manager->GetCmd(opt);
   if (!c_ptr) {
     LOG(WARNING) << "Command " << opt << " not in the command table";
     return -1;
   }
+  g_pika_server->UpdateQueryNumAndExecCountTable(c_ptr->cmd_id());
   // Initial
   c_ptr->Initial(argv, worker->table_name_);
   if (!c_ptr->res().ok()) {
@@ -201,68 +209,77 @@ int PikaReplBgWorker::HandleWriteBinlog(pink::RedisParser* parser, const pink::R
     LOG(WARNING) << "Partition  " << partition_info.ToString() << " not found";
     return -1;
   }
-  std::shared_ptr<Binlog> logger = partition->logger();
   std::string dispatch_key = argv.size() >= 2 ? argv[1] : argv[0];
   bool is_key_partition_matched = true;
   if (slave_partition->Resharding()) {
     is_key_partition_matched = g_pika_server->GetTablePartitionByKey(worker->table_name_, dispatch_key) == partition;
   }
 
-  logger->Lock();
   BinlogType binlog_type = BinlogType::TypeFirst;
   if (!is_key_partition_matched) {
     binlog_type = BinlogType::TypeVoid;
   }
-  logger->Put(c_ptr->ToBinlog(binlog_item.exec_time(),
-                              std::to_string(binlog_item.server_id()),
-                              binlog_item.logic_id(),
-                              binlog_item.filenum(),
-                              binlog_item.offset(),
-                              binlog_type));
-  // meaningless code
-//  uint32_t filenum;
-//  uint64_t offset;
-//  logger->GetProducerStatus(&filenum, &offset);
-  logger->Unlock();
+  worker->binlogs_.push_back(c_ptr->ToBinlog(binlog_item.exec_time(),
+                                             std::to_string(binlog_item.server_id()),
+                                             binlog_item.logic_id(),
+                                             binlog_item.filenum(),
+                                             binlog_item.offset(),
+                                             binlog_type));
 
   if (!is_key_partition_matched) {
     return 0;
   }
+  // Commands touching more than one key, or no key at all (the default
+  // current_key() is a single empty key), can't be reordered with any
+  // other command
+  std::vector<std::string> cur_keys = c_ptr->current_key();
+  bool is_barrier = cur_keys.size() != 1 || cur_keys[0].empty();
   PikaCmdArgsType *v = new PikaCmdArgsType(argv);
   BinlogItem *b = new BinlogItem(binlog_item);
-  g_pika_rm->ScheduleWriteDBTask(dispatch_key, v, b, worker->table_name_, worker->partition_id_);
+  worker->db_tasks_.push_back(WriteDBTaskItem(dispatch_key, is_barrier, v, b));
   return 0;
 }
 
+// Exec time statistics and slowlog of a command applied from binlog
+static void RecordWriteDBCmd(uint32_t cmd_id, const PikaCmdArgsType& argv,
+                             uint64_t start_us, uint64_t duration) {
+  g_pika_server->UpdateCmdExecTime(cmd_id, duration);
+  if (g_pika_conf->slowlog_slower_than() >= 0) {
+    int32_t start_time = start_us / 1000000;
+    if (static_cast<int64_t>(duration) > g_pika_conf->slowlog_slower_than()) {
+      g_pika_server->SlowlogPushEntry(argv, start_time, duration);
+      if (g_pika_conf->slowlog_write_errorlog()) {
+        LOG(ERROR) << "command: " << argv[0] << ", start_time(s): " << start_time << ", duration(us): " << duration;
+      }
+    }
+  }
+}
+
 void PikaReplBgWorker::HandleBGWorkerWriteDB(void* arg) {
   ReplClientWriteDBTaskArg* task_arg = static_cast<ReplClientWriteDBTaskArg*>(arg);
   PikaCmdArgsType* argv = task_arg->argv;
   BinlogItem binlog_item = *(task_arg->binlog_item);
   std::string table_name = task_arg->table_name;
   uint32_t partition_id = task_arg->partition_id;
-  std::string opt = (*argv)[0];
-  slash::StringToLower(opt);
 
   // Get command
-  std::shared_ptr<Cmd> c_ptr = g_pika_cmd_table_manager->GetCmd(slash::StringToLower(opt));
+  std::shared_ptr<Cmd> c_ptr = g_pika_cmd_table_manager->GetCmd((*argv)[0]);
   if (!c_ptr) {
-    LOG(WARNING) << "Error operation from binlog: " << opt;
+    LOG(WARNING) << "Error operation from binlog: " << (*argv)[0];
     delete task_arg;
     return;
   }
+  const std::string& opt = c_ptr->name();
 
-  // Initial
-  c_ptr->Initial(*argv, table_name);
+  // Initial, argv is owned by task_arg and not used afterwards
+  c_ptr->Initial(std::move(*argv), table_name);
   if (!c_ptr->res().ok()) {
     LOG(WARNING) << "Fail to initial command from binlog: " << opt;
     delete task_arg;
     return;
   }
 
-  uint64_t start_us = 0;
-  if (g_pika_conf->slowlog_slower_than() >= 0) {
-    start_us = slash::NowMicros();
-  }
+  uint64_t start_us = slash::NowMicros();
   std::shared_ptr<Partition> partition = g_pika_server->GetTablePartitionById(table_name, partition_id);
   // Add read lock for no suspend command
   if (!c_ptr->is_suspend()) {
@@ -275,16 +292,128 @@ void PikaReplBgWorker::HandleBGWorkerWriteDB(void* arg) {
     partition->DbRWUnLock();
   }
 
-  if (g_pika_conf->slowlog_slower_than() >= 0) {
-    int32_t start_time = start_us / 1000000;
-    int64_t duration = slash::NowMicros() - start_us;
-    if (duration > g_pika_conf->slowlog_slower_than()) {
-      g_pika_server->SlowlogPushEntry(*argv, start_time, duration);
-      if (g_pika_conf->slowlog_write_errorlog()) {
-        LOG(ERROR) << "command: " << opt << ", start_time(s): " << start_time << ", duration(us): " << duration;
-      }
+  RecordWriteDBCmd(c_ptr->cmd_id(), c_ptr->argv(), start_us, slash::NowMicros() - start_us);
+  delete task_arg;
+}
+
+
+void PikaReplBgWorker::HandleBGWorkerWriteDBTasks(const std::vector<ReplTask>& repl_tasks) {
+  std::vector<ReplClientWriteDBTaskArg*> tasks;
+  tasks.reserve(repl_tasks.size());
+  for (const auto& repl_task : repl_tasks) {
+    tasks.push_back(static_cast<ReplClientWriteDBTaskArg*>(repl_task.arg));
+  }
+
+  size_t pos = 0;
+  while (pos < tasks.size()) {
+    size_t num = CombinableNum(tasks, pos);
+    if (num > 1) {
+      HandleBGWorkerWriteDBBatch(tasks, pos, num);
+    } else {
+      HandleBGWorkerWriteDB(static_cast<void*>(tasks[pos]));
     }
+    pos += num;
   }
-  delete task_arg;
 }
 
+enum WriteDBBatchType {
+  kWriteDBBatchNone = 0,
+  kWriteDBBatchSet = 1,
+  kWriteDBBatchHSet = 2,
+};
+
+static WriteDBBatchType GetWriteDBBatchType(const PikaCmdArgsType& argv) {
+  if (argv.size() == 3 && !strcasecmp(argv[0].c_str(), kCmdNameSet.c_str())) {
+    return kWriteDBBatchSet;
+  } else if (argv.size() == 4 && !strcasecmp(argv[0].c_str(), kCmdNameHSet.c_str())) {
+    return kWriteDBBatchHSet;
+  }
+  return kWriteDBBatchNone;
+}
+
+/*
+ * Number of tasks from start can be applied as one write: plain SET of
+ * distinct keys, or HSET of distinct fields of the same key, all for the
+ * same partition. Duplicates end the run so the combined write never
+ * depends on the order inside it
+ */
+size_t PikaReplBgWorker::CombinableNum(const std::vector<ReplClientWriteDBTaskArg*>& tasks,
+                                       size_t start) {
+  const ReplClientWriteDBTaskArg* first = tasks[start];
+  WriteDBBatchType type = GetWriteDBBatchType(*first->argv);
+  if (type == kWriteDBBatchNone) {
+    return 1;
+  }
+  size_t member_pos = type == kWriteDBBatchSet ? 1 : 2;
+  std::unordered_set<std::string> members;
+  members.insert((*first->argv)[member_pos]);
+
+  size_t end = start + 1;
+  for (; end < tasks.size() && end - start < kWriteDBBatchMaxNum; ++end) {
+    const ReplClientWriteDBTaskArg* task = tasks[end];
+    if (task->partition_id != first->partition_id
+      || task->table_name != first->table_name
+      || GetWriteDBBatchType(*task->argv) != type) {
+      break;
+    }
+    if (type == kWriteDBBatchHSet && (*task->argv)[1] != (*first->argv)[1]) {
+      break;
+    }
+    if (!members.insert((*task->argv)[member_pos]).second) {
+      break;
+    }
+  }
+  return end - start;
+}
+
+void PikaReplBgWorker::HandleBGWorkerWriteDBBatch(const std::vector<ReplClientWriteDBTaskArg*>& tasks,
+                                                  size_t start, size_t num) {
+  const ReplClientWriteDBTaskArg* first = tasks[start];
+  const PikaCmdArgsType& first_argv = *first->argv;
+  std::shared_ptr<Partition> partition =
+    g_pika_server->GetTablePartitionById(first->table_name, first->partition_id);
+  if (!partition) {
+    LOG(WARNING) << "Partition " << first->table_name << "_" << first->partition_id << " Not Found";
+    for (size_t i = start; i < start + num; ++i) {
+      delete tasks[i];
+    }
+    return;
+  }
+
+  uint64_t start_us = slash::NowMicros();
+  rocksdb::Status s;
+  partition->DbRWLockReader();
+  if (GetWriteDBBatchType(first_argv) == kWriteDBBatchSet) {
+    std::vector<blackwidow::KeyValue> kvs;
+    kvs.reserve(num);
+    for (size_t i = start; i < start + num; ++i) {
+      const PikaCmdArgsType& argv = *tasks[i]->argv;
+      kvs.push_back({argv[1], argv[2]});
+    }
+    s = partition->db()->MSet(kvs);
+  } else {
+    std::vector<blackwidow::FieldValue> fvs;
+    fvs.reserve(num);
+    for (size_t i = start; i < start + num; ++i) {
+      const PikaCmdArgsType& argv = *tasks[i]->argv;
+      fvs.push_back({argv[2], argv[3]});
+    }
+    s = partition->db()->HMSet(first_argv[1], fvs);
+  }
+  partition->DbRWUnLock();
+  if (!s.ok()) {
+    LOG(WARNING) << "Apply " << num << " " << first_argv[0]
+      << " from binlog failed: " << s.ToString();
+  }
+
+  // every combined command is accounted its share of the write, as if
+  // it was applied on its own
+  uint64_t duration = (slash::NowMicros() - start_us) / num;
+  std::shared_ptr<Cmd> c_ptr = g_pika_cmd_table_manager->GetCmd(first_argv[0]);
+  for (size_t i = start; i < start + num; ++i) {
+    if (c_ptr) {
+      RecordWriteDBCmd(c_ptr->cmd_id(), *tasks[i]->argv, start_us, duration);
+    }
+    delete tasks[i];
+  }
+}
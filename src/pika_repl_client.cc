@@ -17,24 +17,36 @@
 
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
+#include "include/pika_compress.h"
 
 extern PikaServer* g_pika_server;
 extern PikaReplicaManager* g_pika_rm;
 
-PikaReplClient::PikaReplClient(int cron_interval, int keepalive_timeout) : next_avail_(0) {
+ReplClientWriteDBTaskArg::~ReplClientWriteDBTaskArg() {
+  delete argv;
+  delete binlog_item;
+  if (slave_partition) {
+    slave_partition->FinishApply();
+  }
+}
+
+PikaReplClient::PikaReplClient(int cron_interval, int keepalive_timeout) {
   client_thread_ = new PikaReplClientThread(cron_interval, keepalive_timeout);
   client_thread_->set_thread_name("PikaReplClient");
-  for (int i = 0; i < 2 * g_pika_conf->sync_thread_num(); ++i) {
-    bg_workers_.push_back(new PikaReplBgWorker(PIKA_SYNC_BUFFER_SIZE));
-  }
+  // Separate workers for the two stages, a barrier command blocks a
+  // binlog worker until the db workers applied its partition
+  binlog_scheduler_ = new PikaReplScheduler("ReplBinlogWorker",
+      g_pika_conf->sync_thread_num(), PIKA_SYNC_BUFFER_SIZE, nullptr);
+  db_scheduler_ = new PikaReplScheduler("ReplDBWorker",
+      g_pika_conf->sync_thread_num(), PIKA_SYNC_BUFFER_SIZE,
+      &PikaReplBgWorker::HandleBGWorkerWriteDBTasks);
 }
 
 PikaReplClient::~PikaReplClient() {
   client_thread_->StopThread();
   delete client_thread_;
-  for (size_t i = 0; i < bg_workers_.size(); ++i) {
-    delete bg_workers_[i];
-  }
+  delete binlog_scheduler_;
+  delete db_scheduler_;
   LOG(INFO) << "PikaReplClient exit!!!";
 }
 
@@ -43,50 +55,64 @@ int PikaReplClient::Start() {
   if (res != pink::kSuccess) {
     LOG(FATAL) << "Start ReplClient ClientThread Error: " << res << (res == pink::kCreateThreadError ? ": create thread error " : ": other error");
   }
-  for (size_t i = 0; i < bg_workers_.size(); ++i) {
-    res = bg_workers_[i]->StartThread();
-    if (res != pink::kSuccess) {
-      LOG(FATAL) << "Start Pika Repl Worker Thread Error: " << res
-        << (res == pink::kCreateThreadError ? ": create thread error " : ": other error");
-    }
+  res = binlog_scheduler_->Start();
+  if (res == pink::kSuccess) {
+    res = db_scheduler_->Start();
+  }
+  if (res != pink::kSuccess) {
+    LOG(FATAL) << "Start Pika Repl Worker Thread Error: " << res
+      << (res == pink::kCreateThreadError ? ": create thread error " : ": other error");
   }
   return res;
 }
 
 int PikaReplClient::Stop() {
   client_thread_->StopThread();
-  for (size_t i = 0; i < bg_workers_.size(); ++i) {
-    bg_workers_[i]->StopThread();
-  }
+  binlog_scheduler_->Stop();
+  db_scheduler_->Stop();
   return 0;
 }
 
 void PikaReplClient::Schedule(pink::TaskFunc func, void* arg) {
-  bg_workers_[next_avail_]->Schedule(func, arg);
-  UpdateNextAvail();
+  binlog_scheduler_->Schedule(func, arg);
 }
 
 void PikaReplClient::ScheduleWriteBinlogTask(std::string table_partition,
     const std::shared_ptr<InnerMessage::InnerResponse> res,
     std::shared_ptr<pink::PbConn> conn, void* res_private_data) {
-  size_t index = GetHashIndex(table_partition, true);
   ReplClientWriteBinlogTaskArg* task_arg =
-    new ReplClientWriteBinlogTaskArg(res, conn, res_private_data, bg_workers_[index]);
-  bg_workers_[index]->Schedule(&PikaReplBgWorker::HandleBGWorkerWriteBinlog, static_cast<void*>(task_arg));
+    new ReplClientWriteBinlogTaskArg(res, conn, res_private_data);
+  binlog_scheduler_->Schedule(str_hash(table_partition),
+      &PikaReplBgWorker::HandleBGWorkerWriteBinlog, static_cast<void*>(task_arg));
 }
 
-void PikaReplClient::ScheduleWriteDBTask(const std::string& dispatch_key,
-    PikaCmdArgsType* argv, BinlogItem* binlog_item,
-    const std::string& table_name, uint32_t partition_id) {
-  size_t index = GetHashIndex(dispatch_key, false);
-  ReplClientWriteDBTaskArg* task_arg =
-    new ReplClientWriteDBTaskArg(argv, binlog_item, table_name, partition_id);
-  bg_workers_[index]->Schedule(&PikaReplBgWorker::HandleBGWorkerWriteDB, static_cast<void*>(task_arg));
+void PikaReplClient::ScheduleWriteDBTask(const std::shared_ptr<SyncSlavePartition>& slave_partition,
+    const std::string& dispatch_key, bool is_barrier,
+    PikaCmdArgsType* argv, BinlogItem* binlog_item) {
+  const PartitionInfo& p_info = slave_partition->SyncPartitionInfo();
+  ReplClientWriteDBTaskArg* task_arg = new ReplClientWriteDBTaskArg(
+      argv, binlog_item, p_info.table_name_, p_info.partition_id_, slave_partition);
+  if (is_barrier) {
+    // Invoked by the only write binlog worker of this partition, so no
+    // more command of this partition is scheduled until it's applied
+    slave_partition->WaitApplyDone();
+    slave_partition->AddPendingApply();
+    PikaReplBgWorker::HandleBGWorkerWriteDB(static_cast<void*>(task_arg));
+    return;
+  }
+  slave_partition->AddPendingApply();
+  // keys share a bounded set of strands, kReplDBStrandsPerWorker per
+  // worker are enough for an idle worker to find one to steal
+  size_t strand_key = str_hash(dispatch_key)
+    % (db_scheduler_->worker_num() * kReplDBStrandsPerWorker);
+  db_scheduler_->Schedule(strand_key, &PikaReplBgWorker::HandleBGWorkerWriteDB,
+      static_cast<void*>(task_arg));
 }
 
-size_t PikaReplClient::GetHashIndex(std::string key, bool upper_half) {
-  size_t hash_base = bg_workers_.size() / 2;
-  return (str_hash(key) % hash_base) + (upper_half ? 0 : hash_base);
+void PikaReplClient::WorkerStats(std::vector<ReplWorkerStat>* binlog_stats,
+                                 std::vector<ReplWorkerStat>* db_stats) {
+  binlog_scheduler_->WorkerStats(binlog_stats);
+  db_scheduler_->WorkerStats(db_stats);
 }
 
 Status PikaReplClient::Write(const std::string& ip, const int port, const std::string& msg) {
@@ -200,6 +226,9 @@ Status PikaReplClient::SendPartitionTrySync(const std::string& ip,
   InnerMessage::BinlogOffset* binlog_offset = try_sync->mutable_binlog_offset();
   binlog_offset->set_filenum(boffset.filenum);
   binlog_offset->set_offset(boffset.offset);
+  for (const auto& compression : SupportedCompressions()) {
+    try_sync->add_compression(compression);
+  }
 
   std::string to_send;
   if (!request.SerializeToString(&to_send)) {
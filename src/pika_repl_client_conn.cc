@@ -15,6 +15,7 @@
 
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
+#include "include/pika_compress.h"
 
 extern PikaConf* g_pika_conf;
 extern PikaServer* g_pika_server;
@@ -43,6 +44,23 @@ bool PikaReplClientConn::IsTableStructConsistent(
   return true;
 }
 
+bool PikaReplClientConn::UncompressBinlogRes(
+    const std::shared_ptr<InnerMessage::InnerResponse> compressed_response,
+    std::shared_ptr<InnerMessage::InnerResponse>* response) {
+  std::string raw_response;
+  if (!Uncompress(compressed_response->compression(),
+                  compressed_response->compressed_response(),
+                  g_pika_conf->max_conn_rbuf_size(), &raw_response)) {
+    return false;
+  }
+  *response = std::make_shared<InnerMessage::InnerResponse>();
+  ::google::protobuf::io::ArrayInputStream input(raw_response.data(), raw_response.size());
+  ::google::protobuf::io::CodedInputStream decoder(&input);
+  decoder.SetTotalBytesLimit(g_pika_conf->max_conn_rbuf_size(), g_pika_conf->max_conn_rbuf_size());
+  return (*response)->ParseFromCodedStream(&decoder) && decoder.ConsumedEntireMessage()
+    && (*response)->type() == InnerMessage::kBinlogSync;
+}
+
 int PikaReplClientConn::DealMessage() {
   std::shared_ptr<InnerMessage::InnerResponse> response =  std::make_shared<InnerMessage::InnerResponse>();
   ::google::protobuf::io::ArrayInputStream input(rbuf_ + cur_pos_ - header_len_, header_len_);
@@ -75,6 +93,16 @@ int PikaReplClientConn::DealMessage() {
     }
     case InnerMessage::kBinlogSync:
     {
+      if (response->has_compressed_response()) {
+        std::shared_ptr<InnerMessage::InnerResponse> uncompressed_response;
+        if (!UncompressBinlogRes(response, &uncompressed_response)) {
+          LOG(WARNING) << "Uncompress BinlogSync response FAILED! compression: "
+            << CompressionTypeToString(response->compression());
+          g_pika_server->SyncError();
+          return -1;
+        }
+        response = uncompressed_response;
+      }
       DispatchBinlogRes(response);
       break;
     }
@@ -215,6 +243,8 @@ void PikaReplClientConn::HandleTrySyncResponse(void* arg) {
     int32_t session_id = try_sync_response.session_id();
     partition->logger()->GetProducerStatus(&boffset.filenum, &boffset.offset);
     g_pika_rm->UpdateSyncSlavePartitionSessionId(PartitionInfo(table_name, partition_id), session_id);
+    LOG(INFO) << "Partition: " << partition_name << " TrySync Ok, binlog compression: "
+      << CompressionTypeToString(try_sync_response.compression());
     g_pika_rm->SendPartitionBinlogSyncAckRequest(table_name, partition_id, boffset, boffset, true);
     slave_partition->CASReplState(ReplState::kWaitReply, master_term, ReplState::kConnected, "recv try sync response: kOK");
   } else if (try_sync_response.reply_code() == InnerMessage::InnerResponse::TrySync::kSyncPointBePurged) {
@@ -0,0 +1,211 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_repl_scheduler.h"
+
+#include <algorithm>
+
+#include "slash/include/env.h"
+
+PikaReplScheduler::Worker::Worker(PikaReplScheduler* scheduler, size_t index)
+    : cv(&scheduler->mu_),
+      idle(false),
+      scheduler_(scheduler),
+      index_(index) {
+}
+
+void* PikaReplScheduler::Worker::ThreadMain() {
+  scheduler_->Run(index_);
+  return nullptr;
+}
+
+PikaReplScheduler::PikaReplScheduler(const std::string& name, int worker_num,
+                                     size_t strand_max_tasks, ReplBatchFunc batch_func)
+    : name_(name),
+      strand_max_tasks_(std::max<size_t>(strand_max_tasks, 1)),
+      batch_func_(batch_func),
+      space_cv_(&mu_),
+      stopping_(false),
+      next_home_(0) {
+  for (int i = 0; i < std::max(worker_num, 1); ++i) {
+    Worker* worker = new Worker(this, i);
+    worker->set_thread_name(name_);
+    workers_.push_back(worker);
+  }
+}
+
+PikaReplScheduler::~PikaReplScheduler() {
+  Stop();
+  for (auto worker : workers_) {
+    for (auto strand : worker->run_queue) {
+      if (strand->transient) {
+        delete strand;
+      }
+    }
+    delete worker;
+  }
+  for (auto& item : strands_) {
+    delete item.second;
+  }
+}
+
+int PikaReplScheduler::Start() {
+  {
+    slash::MutexLock l(&mu_);
+    stopping_ = false;
+  }
+  int res = 0;
+  for (auto worker : workers_) {
+    res = worker->StartThread();
+    if (res != 0) {
+      return res;
+    }
+  }
+  return res;
+}
+
+int PikaReplScheduler::Stop() {
+  {
+    slash::MutexLock l(&mu_);
+    stopping_ = true;
+    for (auto worker : workers_) {
+      worker->cv.Signal();
+    }
+    space_cv_.SignalAll();
+  }
+  for (auto worker : workers_) {
+    worker->StopThread();
+  }
+  return 0;
+}
+
+void PikaReplScheduler::Schedule(size_t strand_key, pink::TaskFunc func, void* arg) {
+  slash::MutexLock l(&mu_);
+  Strand*& strand = strands_[strand_key];
+  if (strand == nullptr) {
+    strand = new Strand(strand_key % workers_.size(), false);
+  }
+  while (strand->tasks.size() >= strand_max_tasks_ && !stopping_) {
+    space_cv_.Wait();
+  }
+  Enqueue(strand, func, arg);
+}
+
+void PikaReplScheduler::Schedule(pink::TaskFunc func, void* arg) {
+  slash::MutexLock l(&mu_);
+  Strand* strand = new Strand(next_home_, true);
+  next_home_ = (next_home_ + 1) % workers_.size();
+  Enqueue(strand, func, arg);
+}
+
+void PikaReplScheduler::Enqueue(Strand* strand, pink::TaskFunc func, void* arg) {
+  strand->tasks.push_back(ReplTask{func, arg});
+  if (strand->queued) {
+    // the worker holding it will get to the task
+    return;
+  }
+  strand->queued = true;
+  Worker* home = workers_[strand->home];
+  home->run_queue.push_back(strand);
+  if (home->idle) {
+    home->cv.Signal();
+    return;
+  }
+  // home is busy, let an idle worker steal it
+  for (auto worker : workers_) {
+    if (worker->idle) {
+      worker->cv.Signal();
+      break;
+    }
+  }
+}
+
+PikaReplScheduler::Strand* PikaReplScheduler::NextStrand(size_t index) {
+  Worker* self = workers_[index];
+  Strand* strand = nullptr;
+  if (!self->run_queue.empty()) {
+    strand = self->run_queue.front();
+    self->run_queue.pop_front();
+    return strand;
+  }
+  Worker* victim = nullptr;
+  for (auto worker : workers_) {
+    if (worker != self && !worker->run_queue.empty()
+      && (victim == nullptr || worker->run_queue.size() > victim->run_queue.size())) {
+      victim = worker;
+    }
+  }
+  if (victim == nullptr) {
+    return nullptr;
+  }
+  // the back one waits the longest for its worker
+  strand = victim->run_queue.back();
+  victim->run_queue.pop_back();
+  strand->home = index;
+  self->stat.steals++;
+  return strand;
+}
+
+void PikaReplScheduler::Run(size_t index) {
+  Worker* self = workers_[index];
+  std::vector<ReplTask> tasks;
+  mu_.Lock();
+  while (!stopping_) {
+    Strand* strand = NextStrand(index);
+    if (strand == nullptr) {
+      self->idle = true;
+      self->cv.TimedWait(kReplSchedulerIdleWaitMs);
+      self->idle = false;
+      continue;
+    }
+
+    bool was_full = strand->tasks.size() >= strand_max_tasks_;
+    size_t num = std::min(strand->tasks.size(), kReplStrandBatchNum);
+    tasks.assign(strand->tasks.begin(), strand->tasks.begin() + num);
+    strand->tasks.erase(strand->tasks.begin(), strand->tasks.begin() + num);
+    if (was_full) {
+      space_cv_.SignalAll();
+    }
+    mu_.Unlock();
+
+    uint64_t start_us = slash::NowMicros();
+    if (batch_func_ != nullptr) {
+      batch_func_(tasks);
+    } else {
+      for (const auto& task : tasks) {
+        task.func(task.arg);
+      }
+    }
+    uint64_t busy_us = slash::NowMicros() - start_us;
+    tasks.clear();
+
+    mu_.Lock();
+    self->stat.busy_us += busy_us;
+    self->stat.tasks += num;
+    if (!strand->tasks.empty()) {
+      // behind the others of this worker, stealable meanwhile
+      self->run_queue.push_back(strand);
+    } else {
+      strand->queued = false;
+      if (strand->transient) {
+        delete strand;
+      }
+    }
+  }
+  mu_.Unlock();
+}
+
+void PikaReplScheduler::WorkerStats(std::vector<ReplWorkerStat>* stats) {
+  stats->clear();
+  slash::MutexLock l(&mu_);
+  for (auto worker : workers_) {
+    ReplWorkerStat stat = worker->stat;
+    stat.queue_depth = 0;
+    for (auto strand : worker->run_queue) {
+      stat.queue_depth += strand->tasks.size();
+    }
+    stats->push_back(stat);
+  }
+}
@@ -10,11 +10,15 @@
 #include "include/pika_rm.h"
 #include "include/pika_conf.h"
 #include "include/pika_server.h"
+#include "include/pika_compress.h"
 
 extern PikaConf* g_pika_conf;
 extern PikaServer* g_pika_server;
 extern PikaReplicaManager* g_pika_rm;
 
+// Response smaller than this is not worth compressing
+static const size_t kBinlogSyncCompressMinSize = 1024;
+
 PikaReplServer::PikaReplServer(const std::set<std::string>& ips,
                                int port,
                                int cron_interval) {
@@ -71,7 +75,7 @@ slash::Status PikaReplServer::SendSlaveBinlogChips(const std::string& ip,
       if (!response.SerializeToString(&binlog_chip_pb)) {
         return Status::Corruption("Serialized Failed");
       }
-      slash::Status s = Write(ip, port, binlog_chip_pb);
+      slash::Status s = WriteBinlogSyncResp(ip, port, binlog_chip_pb);
       if (!s.ok()) {
         return s;
       }
@@ -79,7 +83,33 @@ slash::Status PikaReplServer::SendSlaveBinlogChips(const std::string& ip,
     return slash::Status::OK();
   }
 
-  return Write(ip, port, binlog_chip_pb);
+  return WriteBinlogSyncResp(ip, port, binlog_chip_pb);
+}
+
+slash::Status PikaReplServer::WriteBinlogSyncResp(const std::string& ip,
+                                                  int port,
+                                                  const std::string& resp) {
+  InnerMessage::CompressionType compression =
+    ClientCompression(slash::IpPortString(ip, port));
+  if (compression == InnerMessage::kNoCompression
+    || resp.size() < kBinlogSyncCompressMinSize) {
+    g_pika_rm->IncrBinlogSyncBytes(resp.size(), resp.size());
+    return Write(ip, port, resp);
+  }
+
+  InnerMessage::InnerResponse compressed_response;
+  compressed_response.set_code(InnerMessage::kOk);
+  compressed_response.set_type(InnerMessage::Type::kBinlogSync);
+  compressed_response.set_compression(compression);
+  if (!Compress(compression, resp, compressed_response.mutable_compressed_response())) {
+    return Status::Corruption("Compress Failed");
+  }
+  std::string compressed_pb;
+  if (!compressed_response.SerializeToString(&compressed_pb)) {
+    return Status::Corruption("Serialized Failed");
+  }
+  g_pika_rm->IncrBinlogSyncBytes(resp.size(), compressed_pb.size());
+  return Write(ip, port, compressed_pb);
 }
 
 void PikaReplServer::BuildBinlogSyncResp(const std::vector<WriteTask>& tasks,
@@ -137,6 +167,7 @@ void PikaReplServer::RemoveClientConn(int fd) {
   std::map<std::string, int>::const_iterator iter = client_conn_map_.begin();
   while (iter != client_conn_map_.end()) {
     if (iter->second == fd) {
+      client_compression_map_.erase(iter->first);
       iter = client_conn_map_.erase(iter);
       break;
     }
@@ -144,6 +175,19 @@ void PikaReplServer::RemoveClientConn(int fd) {
   }
 }
 
+void PikaReplServer::UpdateClientCompression(const std::string& ip_port,
+                                             InnerMessage::CompressionType compression) {
+  slash::RWLock l(&client_conn_rwlock_, true);
+  client_compression_map_[ip_port] = compression;
+}
+
+InnerMessage::CompressionType PikaReplServer::ClientCompression(const std::string& ip_port) {
+  slash::RWLock l(&client_conn_rwlock_, false);
+  std::map<std::string, InnerMessage::CompressionType>::const_iterator iter =
+    client_compression_map_.find(ip_port);
+  return iter == client_compression_map_.end() ? InnerMessage::kNoCompression : iter->second;
+}
+
 void PikaReplServer::KillAllConns() {
   return pika_repl_server_thread_->KillAllConns();
 }
@@ -5,11 +5,16 @@
 
 #include "include/pika_repl_server_conn.h"
 
+#include <algorithm>
+
 #include <glog/logging.h>
 
 #include "include/pika_rm.h"
+#include "include/pika_conf.h"
 #include "include/pika_server.h"
+#include "include/pika_compress.h"
 
+extern PikaConf* g_pika_conf;
 extern PikaServer* g_pika_server;
 extern PikaReplicaManager* g_pika_rm;
 
@@ -198,6 +203,21 @@ void PikaReplServerConn::HandleTrySyncRequest(void* arg) {
     }
   }
 
+  if (pre_success) {
+    // Compress binlog only if the slave is able to uncompress it
+    InnerMessage::CompressionType compression =
+      CompressionTypeFromString(g_pika_conf->replication_compression());
+    if (!CompressionSupported(compression)
+      || std::find(try_sync_request.compression().begin(),
+                   try_sync_request.compression().end(),
+                   compression) == try_sync_request.compression().end()) {
+      compression = InnerMessage::kNoCompression;
+    }
+    try_sync_response->set_compression(compression);
+    g_pika_rm->ReplServerUpdateClientCompression(
+        slash::IpPortString(node.ip(), node.port()), compression);
+  }
+
   std::string reply_str;
   if (!response.SerializeToString(&reply_str)
     || conn->WriteResp(reply_str)) {
@@ -55,6 +55,29 @@ Status BinlogReaderManager::ReleaseBinlogReader(const RmNode& rm_node) {
   return Status::OK();
 }
 
+/* BinlogSendQueue */
+
+BinlogSendQueue::BinlogSendQueue(const std::string& ip, int port)
+  : dropped(false),
+  tasks(kBinlogSendQueueSize),
+  batch_bytes(kBinlogSendBatchMinBytes),
+  ip_(ip), port_(port), srtt_(0) {
+}
+
+BinlogSendQueue::~BinlogSendQueue() {
+  WriteTask* task = NULL;
+  while (tasks.TryPop(&task)) {
+    delete task;
+  }
+}
+
+void BinlogSendQueue::UpdateRtt(uint64_t sample) {
+  // srtt = 7/8 srtt + 1/8 sample, same smoothing as tcp
+  uint64_t srtt = srtt_.load(std::memory_order_relaxed);
+  srtt_.store(srtt == 0 ? sample : srtt - srtt / 8 + sample / 8,
+              std::memory_order_relaxed);
+}
+
 /* SlaveNode */
 
 SlaveNode::SlaveNode(const std::string& ip, int port,
@@ -70,6 +93,17 @@ SlaveNode::~SlaveNode() {
     RmNode rm_node(Ip(), Port(), TableName(), PartitionId());
     ReleaseBinlogFileReader();
   }
+  if (send_queue_ != nullptr) {
+    // let the consumer unregister it
+    send_queue_->dropped.store(true);
+  }
+}
+
+std::shared_ptr<BinlogSendQueue> SlaveNode::SendQueue() {
+  if (send_queue_ == nullptr || send_queue_->dropped.load()) {
+    send_queue_ = g_pika_rm->NewWriteQueue(Ip(), Port());
+  }
+  return send_queue_;
 }
 
 Status SlaveNode::InitBinlogFileReader(const std::shared_ptr<Binlog>& binlog,
@@ -117,8 +151,14 @@ SyncMasterPartition::SyncMasterPartition(const std::string& table_name, uint32_t
     : SyncPartition(table_name, partition_id),
       session_id_(0) {}
 
-bool SyncMasterPartition::CheckReadBinlogFromCache() {
-  return false;
+bool SyncMasterPartition::CheckReadBinlogFromCache(const std::shared_ptr<SlaveNode>& slave_ptr,
+                                                   const BinlogOffset& offset) {
+  std::shared_ptr<Partition> partition = g_pika_server->GetTablePartitionById(
+      slave_ptr->TableName(), slave_ptr->PartitionId());
+  if (!partition) {
+    return false;
+  }
+  return partition->binlog_cache()->Contains(offset);
 }
 
 int SyncMasterPartition::GetNumberOfSlaveNode() {
@@ -196,16 +236,16 @@ Status SyncMasterPartition::ActivateSlaveBinlogSync(const std::string& ip,
   if (!s.ok()) {
     return s;
   }
-  bool read_cache = CheckReadBinlogFromCache();
+  bool read_cache = CheckReadBinlogFromCache(slave_ptr, offset);
 
   slave_ptr->Lock();
   slave_ptr->slave_state = kSlaveBinlogSync;
   slave_ptr->sent_offset = offset;
   slave_ptr->acked_offset = offset;
+  if (slave_ptr->b_state == kReadFromFile && slave_ptr->binlog_reader != nullptr) {
+    slave_ptr->ReleaseBinlogFileReader();
+  }
   if (read_cache) {
-    slave_ptr->Unlock();
-    // RegistToBinlogCacheWindow(ip, port, offset);
-    slave_ptr->Lock();
     slave_ptr->b_state = kReadFromCache;
   } else {
     // read binlog file from file
@@ -262,37 +302,86 @@ Status SyncMasterPartition::ActivateSlaveDbSync(const std::string& ip, int port)
 }
 
 Status SyncMasterPartition::ReadCachedBinlogToWq(const std::shared_ptr<SlaveNode>& slave_ptr) {
+  std::shared_ptr<Partition> partition = g_pika_server->GetTablePartitionById(
+      slave_ptr->TableName(), slave_ptr->PartitionId());
+  if (!partition) {
+    return Status::NotFound(slave_ptr->NodePartitionInfo().ToString() + " partition not found");
+  }
+
+  int cnt = std::min(slave_ptr->sync_win.Remainings(g_pika_conf->sync_window_size()),
+      static_cast<int>(slave_ptr->SendQueue()->tasks.WriteAvailable()));
+  std::vector<BinlogCacheItem> items;
+  Status s = partition->binlog_cache()->Read(slave_ptr->sent_offset, cnt, &items);
+  if (!s.ok()) {
+    // slave fell behind the cache, go back to the binlog file
+    s = slave_ptr->InitBinlogFileReader(partition->logger(), slave_ptr->sent_offset);
+    if (!s.ok()) {
+      LOG(WARNING) << SyncPartitionInfo().ToString()
+        << " Init binlog file reader failed: " << s.ToString();
+      return s;
+    }
+    slave_ptr->b_state = kReadFromFile;
+    return ReadBinlogFileToWq(slave_ptr);
+  }
+
+  std::vector<WriteTask> tasks;
+  uint64_t now = slash::NowMicros();
+  for (const auto& item : items) {
+    slave_ptr->sync_win.Push(SyncWinItem(item.end_offset, now));
+
+    slave_ptr->sent_offset = item.end_offset;
+    slave_ptr->SetLastSendTime(now);
+    RmNode rm_node(slave_ptr->Ip(), slave_ptr->Port(), slave_ptr->TableName(), slave_ptr->PartitionId(), slave_ptr->SessionId());
+    WriteTask task(rm_node, slave_ptr->master_term_, BinlogChip(item.end_offset, item.binlog));
+    tasks.push_back(task);
+  }
+
+  if (!tasks.empty()) {
+    g_pika_rm->IncrBinlogCacheHits(tasks.size());
+    g_pika_rm->ProduceWriteQueue(slave_ptr, &tasks);
+  }
   return Status::OK();
 }
 
 Status SyncMasterPartition::ReadBinlogFileToWq(const std::shared_ptr<SlaveNode>& slave_ptr) {
-  int cnt = slave_ptr->sync_win.Remainings();
+  int cnt = std::min(slave_ptr->sync_win.Remainings(g_pika_conf->sync_window_size()),
+      static_cast<int>(slave_ptr->SendQueue()->tasks.WriteAvailable()));
   std::shared_ptr<PikaBinlogReader> reader = slave_ptr->binlog_reader;
   std::vector<WriteTask> tasks;
+  bool reach_end = false;
   for (int i = 0; i < cnt; ++i) {
     std::string msg;
     uint32_t filenum;
     uint64_t offset;
     Status s = reader->Get(&msg, &filenum, &offset);
     if (s.IsEndFile()) {
+      reach_end = true;
       break;
     } else if (s.IsCorruption() || s.IsIOError()) {
       LOG(WARNING) << SyncPartitionInfo().ToString()
         << " Read Binlog error : " << s.ToString();
       return s;
     }
-    slave_ptr->sync_win.Push(SyncWinItem(filenum, offset));
+    uint64_t now = slash::NowMicros();
+    slave_ptr->sync_win.Push(SyncWinItem(filenum, offset, now));
 
     BinlogOffset sent_offset = BinlogOffset(filenum, offset);
     slave_ptr->sent_offset = sent_offset;
-    slave_ptr->SetLastSendTime(slash::NowMicros());
+    slave_ptr->SetLastSendTime(now);
     RmNode rm_node(slave_ptr->Ip(), slave_ptr->Port(), slave_ptr->TableName(), slave_ptr->PartitionId(), slave_ptr->SessionId());
     WriteTask task(rm_node, slave_ptr->master_term_, BinlogChip(sent_offset, msg));
     tasks.push_back(task);
   }
 
   if (!tasks.empty()) {
-    g_pika_rm->ProduceWriteQueue(slave_ptr->Ip(), slave_ptr->Port(), tasks);
+    g_pika_rm->IncrBinlogCacheMisses(tasks.size());
+    g_pika_rm->ProduceWriteQueue(slave_ptr, &tasks);
+  }
+
+  // slave caught up with the binlog file, switch to the binlog cache
+  if (reach_end && CheckReadBinlogFromCache(slave_ptr, slave_ptr->sent_offset)) {
+    slave_ptr->ReleaseBinlogFileReader();
+    slave_ptr->b_state = kReadFromCache;
   }
   return Status::OK();
 }
@@ -321,10 +410,14 @@ Status SyncMasterPartition::UpdateSlaveBinlogAckInfo(const std::string& ip, int
   if (slave_ptr->slave_state != kSlaveBinlogSync) {
     return Status::Corruption(ip + std::to_string(port) + "state not BinlogSync");
   }
-  bool res = slave_ptr->sync_win.Update(SyncWinItem(start), SyncWinItem(end), &(slave_ptr->acked_offset));
+  uint64_t ack_latency = 0;
+  bool res = slave_ptr->sync_win.Update(SyncWinItem(start), SyncWinItem(end),
+                                        &(slave_ptr->acked_offset), &ack_latency,
+                                        g_pika_rm->binlog_ack_latency());
   if (!res) {
     return Status::Corruption("UpdateAckedInfo failed");
   }
+  slave_ptr->SendQueue()->UpdateRtt(ack_latency);
   }
   return Status::OK();
 }
@@ -630,7 +723,9 @@ SyncSlavePartition::SyncSlavePartition(const std::string& table_name,
     m_term_(0),
     repl_state_(kNoConnect),
     local_ip_(""),
-    resharding_(false) {
+    resharding_(false),
+    apply_cv_(&apply_mu_),
+    pending_apply_(0) {
   m_info_.SetLastRecvTime(slash::NowMicros());
   pthread_rwlock_init(&partition_mu_, NULL);
 }
@@ -845,10 +940,35 @@ Status SyncSlavePartition::GetInfoFilePath(std::string* info_file_path) {
 Status SyncSlavePartition::GetInfo(std::string* info) {
   std::string tmp_str = "  Role: Slave\r\n";
   tmp_str += "  master: " + MasterIp() + ":" + std::to_string(MasterPort()) + "\r\n";
+  tmp_str += "  apply_lag: " + std::to_string(PendingApply()) + "\r\n";
   info->append(tmp_str);
   return Status::OK();
 }
 
+void SyncSlavePartition::AddPendingApply() {
+  slash::MutexLock l(&apply_mu_);
+  pending_apply_++;
+}
+
+void SyncSlavePartition::FinishApply() {
+  slash::MutexLock l(&apply_mu_);
+  if (--pending_apply_ == 0) {
+    apply_cv_.SignalAll();
+  }
+}
+
+void SyncSlavePartition::WaitApplyDone() {
+  slash::MutexLock l(&apply_mu_);
+  while (pending_apply_ != 0) {
+    apply_cv_.Wait();
+  }
+}
+
+uint64_t SyncSlavePartition::PendingApply() {
+  slash::MutexLock l(&apply_mu_);
+  return pending_apply_;
+}
+
 Status SyncSlavePartition::Activate(const RmNode& master, const ReplState& repl_state, const std::string& info_file_path) {
   slash::RWLock l(&partition_mu_, true);
   if (master.Ip().empty() || master.Port() <= 0 || master.Port() >= 65536) {
@@ -882,54 +1002,16 @@ std::string SyncSlavePartition::ToStringStatus() {
     "  SyncStatus " + ReplStateMsg[repl_state_] + "\r\n";
 }
 
-/* SyncWindow */
-
-void SyncWindow::Push(const SyncWinItem& item) {
-  win_.push_back(item);
-}
-
-bool SyncWindow::Update(const SyncWinItem& start_item,
-    const SyncWinItem& end_item, BinlogOffset* acked_offset) {
-  size_t start_pos = win_.size(), end_pos = win_.size();
-  for (size_t i = 0; i < win_.size(); ++i) {
-    if (win_[i] == start_item) {
-      start_pos = i;
-    }
-    if (win_[i] == end_item) {
-      end_pos = i;
-      break;
-    }
-  }
-  if (start_pos == win_.size() || end_pos == win_.size()) {
-    LOG(WARNING) << "Ack offset Start: " <<
-      start_item.ToString() << "End: " << end_item.ToString() <<
-      " not found in binlog controller window." <<
-      std::endl << "window status "<< std::endl << ToStringStatus();
-    return false;
-  }
-  for (size_t i = start_pos; i <= end_pos; ++i) {
-    win_[i].acked_ = true;
-  }
-  while (!win_.empty()) {
-    if (win_[0].acked_) {
-      *acked_offset = win_[0].offset_;
-      win_.pop_front();
-    } else {
-      break;
-    }
-  }
-  return true;
-}
-
-int SyncWindow::Remainings() {
-  std::size_t remaining_size = g_pika_conf->sync_window_size() - win_.size();
-  return remaining_size > 0? remaining_size:0 ;
-}
-
 /* PikaReplicaManger */
 
 PikaReplicaManager::PikaReplicaManager()
-    : last_meta_sync_timestamp_(0) {
+    : write_queues_version_(0),
+      consume_queues_version_(0),
+      last_meta_sync_timestamp_(0),
+      binlog_cache_hits_(0),
+      binlog_cache_misses_(0),
+      binlog_sync_raw_bytes_(0),
+      binlog_sync_sent_bytes_(0) {
   std::set<std::string> ips;
   ips.insert("0.0.0.0");
   int port = g_pika_conf->port() + kPortShiftReplServer;
@@ -976,80 +1058,125 @@ void PikaReplicaManager::InitPartition() {
   }
 }
 
-void PikaReplicaManager::ProduceWriteQueue(const std::string& ip, int port, const std::vector<WriteTask>& tasks) {
+std::shared_ptr<BinlogSendQueue> PikaReplicaManager::NewWriteQueue(const std::string& ip, int port) {
+  std::shared_ptr<BinlogSendQueue> queue = std::make_shared<BinlogSendQueue>(ip, port);
   slash::MutexLock l(&write_queue_mu_);
-  std::string index = ip + ":" + std::to_string(port);
-  for (auto& task : tasks) {
-    write_queues_[index].push(task);
+  write_queues_.push_back(queue);
+  write_queues_version_++;
+  return queue;
+}
+
+void PikaReplicaManager::ProduceWriteQueue(const std::shared_ptr<SlaveNode>& slave_ptr,
+                                           std::vector<WriteTask>* tasks) {
+  std::shared_ptr<BinlogSendQueue> queue = slave_ptr->SendQueue();
+  for (auto& task : *tasks) {
+    // room was checked against WriteAvailable before reading the binlog
+    WriteTask* item = new WriteTask(std::move(task));
+    if (!queue->tasks.TryPush(item)) {
+      LOG(WARNING) << "Write queue of " << slave_ptr->ToString() << " is full";
+      delete item;
+      break;
+    }
+  }
+  g_pika_server->SignalAuxiliary();
+}
+
+/*
+ * Grow the packet size while a backlog is left behind and the slave
+ * still acks within kBinlogSendTargetRtt. Once the queue is drained the
+ * rtt is mostly spent on the slave applying the packet, shrink it then
+ * if the acks are slow. With a backlog the rtt includes the time queued
+ * here, so it is not used to shrink.
+ */
+static void AdjustBinlogSendBatch(BinlogSendQueue* queue, bool backlogged) {
+  uint64_t rtt = queue->Rtt();
+  if (backlogged && rtt <= kBinlogSendTargetRtt) {
+    queue->batch_bytes = std::min(queue->batch_bytes * 2,
+                                  static_cast<size_t>(kBinlogSendBatchMaxBytes));
+  } else if (!backlogged && rtt > kBinlogSendTargetRtt) {
+    queue->batch_bytes = std::max(queue->batch_bytes / 2,
+                                  static_cast<size_t>(kBinlogSendBatchMinBytes));
   }
 }
 
 int PikaReplicaManager::ConsumeWriteQueue() {
-  std::vector<std::string> to_delete;
-  std::unordered_map<std::string, std::vector<std::vector<WriteTask>>> to_send_map;
-  int counter = 0;
-  {
+  if (consume_queues_version_ != write_queues_version_.load()) {
     slash::MutexLock l(&write_queue_mu_);
-    std::vector<std::string> to_delete;
-    for (auto& iter : write_queues_) {
-      std::queue<WriteTask>& queue = iter.second;
-      for (int i = 0; i < kBinlogSendPacketNum; ++i) {
-        if (queue.empty()) {
-          break;
-        }
-        size_t batch_index = queue.size() > kBinlogSendBatchNum ? kBinlogSendBatchNum : queue.size();
-        std::vector<WriteTask> to_send;
-        int batch_size = 0;
-        for (size_t i = 0; i < batch_index; ++i) {
-          WriteTask& task = queue.front();
-          batch_size +=  task.binlog_chip_.binlog_.size();
-          // make sure SerializeToString will not over 2G
-          if (batch_size > PIKA_MAX_CONN_RBUF_HB) {
-            break;
-          }
-          to_send.push_back(queue.front());
-          queue.pop();
-          counter++;
-        }
-        if (!to_send.empty()) {
-          to_send_map[iter.first].push_back(std::move(to_send));
-        }
-      }
-    }
+    consume_queues_ = write_queues_;
+    consume_queues_version_ = write_queues_version_.load();
   }
 
-  for (auto& iter : to_send_map) {
-    std::string ip;
-    int port = 0;
-    if (!slash::ParseIpPortString(iter.first, ip, port)) {
-      LOG(WARNING) << "Parse ip_port error " << iter.first;
+  int counter = 0;
+  bool has_dropped = false;
+  std::set<std::string> failed;
+  for (auto& queue : consume_queues_) {
+    if (queue->dropped.load()) {
+      has_dropped = true;
       continue;
     }
-    for (auto& to_send : iter.second) {
-      Status s = pika_repl_server_->SendSlaveBinlogChips(ip, port, to_send);
+    std::string ip_port = queue->Ip() + ":" + std::to_string(queue->Port());
+    if (failed.find(ip_port) != failed.end()) {
+      continue;
+    }
+    for (int i = 0; i < kBinlogSendPacketNum; ++i) {
+      std::vector<WriteTask> to_send;
+      size_t batch_size = 0;
+      WriteTask** front = NULL;
+      while ((front = queue->tasks.Front()) != NULL) {
+        // a chip larger than batch_bytes is sent alone
+        size_t chip_size = (*front)->binlog_chip_.binlog_.size();
+        if (!to_send.empty() && batch_size + chip_size > queue->batch_bytes) {
+          break;
+        }
+        batch_size += chip_size;
+        to_send.push_back(std::move(**front));
+        delete *front;
+        queue->tasks.Pop();
+      }
+      if (to_send.empty()) {
+        break;
+      }
+      counter += to_send.size();
+      Status s = pika_repl_server_->SendSlaveBinlogChips(queue->Ip(), queue->Port(), to_send);
       if (!s.ok()) {
-        LOG(WARNING) << "send binlog to " << ip << ":" << port << " failed, " << s.ToString();
-        to_delete.push_back(iter.first);
-        continue;
+        LOG(WARNING) << "send binlog to " << ip_port << " failed, " << s.ToString();
+        failed.insert(ip_port);
+        break;
       }
     }
+    AdjustBinlogSendBatch(queue.get(), queue->tasks.Size() > 0);
   }
 
-  if (!to_delete.empty()) {
-    {
-      slash::MutexLock l(&write_queue_mu_);
-      for (auto& del_queue : to_delete) {
-        write_queues_.erase(del_queue);
-      }
+  for (const auto& ip_port : failed) {
+    std::string ip;
+    int port = 0;
+    if (slash::ParseIpPortString(ip_port, ip, port)) {
+      DropItemInWriteQueue(ip, port);
     }
   }
+  if (has_dropped) {
+    slash::MutexLock l(&write_queue_mu_);
+    write_queues_.erase(std::remove_if(write_queues_.begin(), write_queues_.end(),
+          [](const std::shared_ptr<BinlogSendQueue>& queue) {
+            return queue->dropped.load();
+          }), write_queues_.end());
+    write_queues_version_++;
+  }
   return counter;
 }
 
 void PikaReplicaManager::DropItemInWriteQueue(const std::string& ip, int port) {
   slash::MutexLock l(&write_queue_mu_);
-  std::string index = ip + ":" + std::to_string(port);
-  write_queues_.erase(index);
+  for (auto& queue : write_queues_) {
+    if (queue->Ip() == ip && queue->Port() == port) {
+      queue->dropped.store(true);
+    }
+  }
+  write_queues_.erase(std::remove_if(write_queues_.begin(), write_queues_.end(),
+        [](const std::shared_ptr<BinlogSendQueue>& queue) {
+          return queue->dropped.load();
+        }), write_queues_.end());
+  write_queues_version_++;
 }
 
 void PikaReplicaManager::ScheduleReplServerBGTask(pink::TaskFunc func, void* arg) {
@@ -1060,6 +1187,11 @@ void PikaReplicaManager::ScheduleReplClientBGTask(pink::TaskFunc func, void* arg
   pika_repl_client_->Schedule(func, arg);
 }
 
+void PikaReplicaManager::ReplWorkerStats(std::vector<ReplWorkerStat>* binlog_stats,
+                                         std::vector<ReplWorkerStat>* db_stats) {
+  pika_repl_client_->WorkerStats(binlog_stats, db_stats);
+}
+
 void PikaReplicaManager::ScheduleWriteBinlogTask(const std::string& table_partition,
         const std::shared_ptr<InnerMessage::InnerResponse> res,
         std::shared_ptr<pink::PbConn> conn,
@@ -1067,10 +1199,10 @@ void PikaReplicaManager::ScheduleWriteBinlogTask(const std::string& table_partit
   pika_repl_client_->ScheduleWriteBinlogTask(table_partition, res, conn, res_private_data);
 }
 
-void PikaReplicaManager::ScheduleWriteDBTask(const std::string& dispatch_key,
-        PikaCmdArgsType* argv, BinlogItem* binlog_item,
-        const std::string& table_name, uint32_t partition_id) {
-  pika_repl_client_->ScheduleWriteDBTask(dispatch_key, argv, binlog_item, table_name, partition_id);
+void PikaReplicaManager::ScheduleWriteDBTask(const std::shared_ptr<SyncSlavePartition>& slave_partition,
+        const std::string& dispatch_key, bool is_barrier,
+        PikaCmdArgsType* argv, BinlogItem* binlog_item) {
+  pika_repl_client_->ScheduleWriteDBTask(slave_partition, dispatch_key, is_barrier, argv, binlog_item);
 }
 
 void PikaReplicaManager::ReplServerRemoveClientConn(int fd) {
@@ -1082,6 +1214,11 @@ void PikaReplicaManager::ReplServerUpdateClientConnMap(const std::string& ip_por
   pika_repl_server_->UpdateClientConnMap(ip_port, fd);
 }
 
+void PikaReplicaManager::ReplServerUpdateClientCompression(const std::string& ip_port,
+                                                           InnerMessage::CompressionType compression) {
+  pika_repl_server_->UpdateClientCompression(ip_port, compression);
+}
+
 Status PikaReplicaManager::UpdateSyncBinlogStatus(const RmNode& slave, const BinlogOffset& range_start, const BinlogOffset& range_end) {
   slash::RWLock l(&partitions_rw_, false);
   std::shared_ptr<SyncMasterPartition> partition = getSyncMasterPartitionByNameLocked(slave.NodePartitionInfo());
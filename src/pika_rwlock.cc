@@ -0,0 +1,74 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_rwlock.h"
+
+#include <sched.h>
+#include <unistd.h>
+
+// rounds of sched_yield before the writer sleeps between checks
+#define kWriterSpinRounds 100
+#define kWriterSleepUs 100
+
+ScalableRWLock::ScalableRWLock()
+    : writer_(false),
+      wait_cv_(&wait_mu_) {
+  for (size_t i = 0; i < kReaderSlots; ++i) {
+    slots_[i].readers.store(0, std::memory_order_relaxed);
+  }
+}
+
+size_t ScalableRWLock::CurrentThreadSlot() {
+  // threads take slots round robin, so up to kReaderSlots threads
+  // never share a cache line
+  static std::atomic<size_t> next_slot(0);
+  static thread_local size_t slot = next_slot.fetch_add(1) % kReaderSlots;
+  return slot;
+}
+
+void ScalableRWLock::ReadLock() {
+  ReaderSlot& slot = slots_[CurrentThreadSlot()];
+  while (true) {
+    // pairs with the writer which sets writer_ and then reads the slots
+    slot.readers.fetch_add(1, std::memory_order_seq_cst);
+    if (!writer_.load(std::memory_order_seq_cst)) {
+      return;
+    }
+    slot.readers.fetch_sub(1, std::memory_order_seq_cst);
+
+    slash::MutexLock l(&wait_mu_);
+    while (writer_.load()) {
+      wait_cv_.Wait();
+    }
+  }
+}
+
+void ScalableRWLock::ReadUnlock() {
+  slots_[CurrentThreadSlot()].readers.fetch_sub(1, std::memory_order_release);
+}
+
+void ScalableRWLock::WriteLock() {
+  writer_mu_.Lock();
+  writer_.store(true, std::memory_order_seq_cst);
+  for (size_t i = 0; i < kReaderSlots; ++i) {
+    int rounds = 0;
+    while (slots_[i].readers.load(std::memory_order_seq_cst) != 0) {
+      if (rounds++ < kWriterSpinRounds) {
+        sched_yield();
+      } else {
+        usleep(kWriterSleepUs);
+      }
+    }
+  }
+}
+
+void ScalableRWLock::WriteUnlock() {
+  {
+    slash::MutexLock l(&wait_mu_);
+    writer_.store(false);
+    wait_cv_.SignalAll();
+  }
+  writer_mu_.Unlock();
+}
@@ -22,6 +22,8 @@
 
 #include "include/pika_rm.h"
 #include "include/pika_server.h"
+#include "include/pika_bitops.h"
+#include "include/pika_io_throttle.h"
 #include "include/pika_dispatch_thread.h"
 #include "include/pika_cmd_table_manager.h"
 #include "include/pika_utils.h"
@@ -62,7 +64,7 @@ PikaServer::PikaServer() :
   role_(PIKA_ROLE_SINGLE),
   loop_partition_state_machine_(false),
   force_full_sync_(false),
-  slowlog_entry_id_(0) {
+  slowlog_(std::max(g_pika_conf->slowlog_max_len(), 0)) {
 
   //Init server ip host
   if (!ServerInit()) {
@@ -71,6 +73,13 @@ PikaServer::PikaServer() :
 
   InitBlackwidowOptions();
 
+  BitmapKernel bitops_kernel;
+  if (BitmapKernelByName(g_pika_conf->bitops_kernel().c_str(), &bitops_kernel)
+    && !BitmapSetKernel(bitops_kernel)) {
+    LOG(WARNING) << "bitops-kernel " << g_pika_conf->bitops_kernel()
+      << " is not supported by this CPU, using " << BitmapKernelName();
+  }
+
   pthread_rwlockattr_t tables_rw_attr;
   pthread_rwlockattr_init(&tables_rw_attr);
   pthread_rwlockattr_setkind_np(&tables_rw_attr,
@@ -98,10 +107,10 @@ PikaServer::PikaServer() :
                                              g_pika_conf->port() + kPortShiftRSync);
   pika_pubsub_thread_ = new pink::PubSubThread();
   pika_auxiliary_thread_ = new PikaAuxiliaryThread();
+  pika_migrate_thread_ = new PikaMigrateThread();
   pika_thread_pool_ = new pink::ThreadPool(g_pika_conf->thread_pool_size(), 100000);
 
   pthread_rwlock_init(&state_protector_, NULL);
-  pthread_rwlock_init(&slowlog_protector_, NULL);
 }
 
 PikaServer::~PikaServer() {
@@ -122,6 +131,7 @@ PikaServer::~PikaServer() {
 
   delete pika_pubsub_thread_;
   delete pika_auxiliary_thread_;
+  delete pika_migrate_thread_;
   delete pika_rsync_service_;
   delete pika_thread_pool_;
   delete pika_monitor_thread_;
@@ -133,7 +143,6 @@ PikaServer::~PikaServer() {
 
   pthread_rwlock_destroy(&tables_rw_);
   pthread_rwlock_destroy(&state_protector_);
-  pthread_rwlock_destroy(&slowlog_protector_);
 
   LOG(INFO) << "PikaServer " << pthread_self() << " exit!!!";
 }
@@ -253,6 +262,12 @@ void PikaServer::Start() {
     LOG(FATAL) << "Start Auxiliary Thread Error: " << ret << (ret == pink::kCreateThreadError ? ": create thread error " : ": other error");
   }
 
+  ret = pika_migrate_thread_->StartThread();
+  if (ret != pink::kSuccess) {
+    tables_.clear();
+    LOG(FATAL) << "Start Migrate Thread Error: " << ret << (ret == pink::kCreateThreadError ? ": create thread error " : ": other error");
+  }
+
   time(&start_time_s_);
 
   std::string slaveof = g_pika_conf->slaveof();
@@ -393,6 +408,8 @@ void PikaServer::InitTableStruct() {
   std::string log_path = g_pika_conf->log_path();
   std::vector<TableStruct> table_structs = g_pika_conf->table_structs();
   slash::RWLock rwl(&tables_rw_, true);
+  startup_timing_.meta_load_us = g_pika_conf->meta_load_us();
+  uint64_t start_us = slash::NowMicros();
   for (const auto& table : table_structs) {
     std::string name = table.table_name;
     uint32_t num = table.partition_num;
@@ -401,12 +418,42 @@ void PikaServer::InitTableStruct() {
     table_ptr->AddPartitions(table.partition_ids);
     tables_.emplace(name, table_ptr);
   }
+  startup_timing_.partitions_open_us = slash::NowMicros() - start_us;
+  for (const auto& table_item : tables_) {
+    slash::RWLock partition_rwl(&table_item.second->partitions_rw_, false);
+    for (const auto& partition_item : table_item.second->partitions_) {
+      const std::shared_ptr<Partition>& partition = partition_item.second;
+      startup_timing_.partition_num++;
+      startup_timing_.db_open_total_us += partition->db_open_us();
+      startup_timing_.db_open_max_us = std::max(
+          startup_timing_.db_open_max_us, partition->db_open_us());
+      startup_timing_.binlog_load_total_us += partition->binlog_load_us();
+      startup_timing_.binlog_load_max_us = std::max(
+          startup_timing_.binlog_load_max_us, partition->binlog_load_us());
+    }
+  }
 
+  start_us = slash::NowMicros();
   Status s = g_pika_rm->InitSlaveSyncPartitionsMasterTerm();
   if (!s.ok()) {
     LOG(FATAL) << "can't init slave sync partition master term" << s.ToString();
     exit(1);
   }
+  startup_timing_.repl_restore_us = slash::NowMicros() - start_us;
+  LOG(INFO) << "Startup timing: " << startup_timing_.ToString();
+}
+
+std::string StartupTiming::ToString() const {
+  std::stringstream tmp_stream;
+  tmp_stream << "meta_load_ms=" << meta_load_us / 1000
+             << ",partitions=" << partition_num
+             << ",partitions_open_ms=" << partitions_open_us / 1000
+             << ",db_open_total_ms=" << db_open_total_us / 1000
+             << ",db_open_max_ms=" << db_open_max_us / 1000
+             << ",binlog_load_total_ms=" << binlog_load_total_us / 1000
+             << ",binlog_load_max_ms=" << binlog_load_max_us / 1000
+             << ",repl_restore_ms=" << repl_restore_us / 1000;
+  return tmp_stream.str();
 }
 
 std::shared_ptr<Table> PikaServer::GetTable(const std::string &table_name) {
@@ -1105,8 +1152,14 @@ bool PikaServer::HasMonitorClients() {
   return pika_monitor_thread_->HasMonitorClients();
 }
 
-void PikaServer::AddMonitorMessage(const std::string& monitor_message) {
-  pika_monitor_thread_->AddMonitorMessage(monitor_message);
+void PikaServer::AddMonitorMessage(const std::string& table_name,
+                                   const std::string& ip_port,
+                                   const PikaCmdArgsType& argv) {
+  pika_monitor_thread_->AddMonitorMessage(table_name, ip_port, argv);
+}
+
+uint64_t PikaServer::MonitorDroppedMessages() {
+  return pika_monitor_thread_->DroppedMessages();
 }
 
 void PikaServer::AddMonitorClient(std::shared_ptr<PikaClientConn> client_ptr) {
@@ -1114,76 +1167,86 @@ void PikaServer::AddMonitorClient(std::shared_ptr<PikaClientConn> client_ptr) {
 }
 
 void PikaServer::SlowlogTrim() {
-  pthread_rwlock_wrlock(&slowlog_protector_);
-  while (slowlog_list_.size() > static_cast<uint32_t>(g_pika_conf->slowlog_max_len())) {
-    slowlog_list_.pop_back();
-  }
-  pthread_rwlock_unlock(&slowlog_protector_);
+  // entries beyond the new length are hidden, the ring grows if needed
+  slowlog_.SetMaxLen(std::max(g_pika_conf->slowlog_max_len(), 0));
 }
 
 void PikaServer::SlowlogReset() {
-  pthread_rwlock_wrlock(&slowlog_protector_);
-  slowlog_list_.clear();
-  pthread_rwlock_unlock(&slowlog_protector_);
+  slowlog_.Reset();
 }
 
 uint32_t PikaServer::SlowlogLen() {
-  RWLock l(&slowlog_protector_, false);
-  return slowlog_list_.size();
+  return slowlog_.Len();
 }
 
 void PikaServer::SlowlogObtain(int64_t number, std::vector<SlowlogEntry>* slowlogs) {
-  pthread_rwlock_rdlock(&slowlog_protector_);
-  slowlogs->clear();
-  std::list<SlowlogEntry>::const_iterator iter = slowlog_list_.begin();
-  while (number-- && iter != slowlog_list_.end()) {
-    slowlogs->push_back(*iter);
-    iter++;
-  }
-  pthread_rwlock_unlock(&slowlog_protector_);
+  slowlog_.Obtain(number, slowlogs);
 }
 
 void PikaServer::SlowlogPushEntry(const PikaCmdArgsType& argv, int32_t time, int64_t duration) {
-  SlowlogEntry entry;
-  uint32_t slargc = (argv.size() < SLOWLOG_ENTRY_MAX_ARGC)
-      ? argv.size() : SLOWLOG_ENTRY_MAX_ARGC;
-
-  for (uint32_t idx = 0; idx < slargc; ++idx) {
-    if (slargc != argv.size() && idx == slargc - 1) {
-      char buffer[64];
-      sprintf(buffer, "... (%lu more arguments)", argv.size() - slargc + 1);
-      entry.argv.push_back(std::string(buffer));
-    } else {
-      if (argv[idx].size() > SLOWLOG_ENTRY_MAX_STRING) {
-        char buffer[64];
-        sprintf(buffer, "... (%lu more bytes)", argv[idx].size() - SLOWLOG_ENTRY_MAX_STRING);
-        std::string suffix(buffer);
-        std::string brief = argv[idx].substr(0, SLOWLOG_ENTRY_MAX_STRING);
-        entry.argv.push_back(brief + suffix);
-      } else {
-        entry.argv.push_back(argv[idx]);
-      }
-    }
-  }
+  slowlog_.Push(argv, time, duration, g_pika_conf->slowlog_max_arg_len());
+}
+
+void PikaServer::HotKeyAdd(const std::string& table_name,
+                           const std::vector<std::string>& keys, bool is_write) {
+  hotkey_tracker_.Add(table_name, keys, is_write);
+}
+
+void PikaServer::HotKeyReset() {
+  hotkey_tracker_.Reset();
+}
+
+void PikaServer::HotKeyObtain(const std::string& table_name, size_t count,
+                              bool with_read, bool with_write,
+                              std::vector<HotKeyItem>* items) {
+  hotkey_tracker_.GetHotKeys(table_name, count, with_read, with_write, items);
+}
+
+uint64_t PikaServer::HotKeyWindowUs() {
+  return hotkey_tracker_.window_us();
+}
 
-  pthread_rwlock_wrlock(&slowlog_protector_);
-  entry.id = slowlog_entry_id_++;
-  entry.start_time = time;
-  entry.duration = duration;
-  slowlog_list_.push_front(entry);
-  pthread_rwlock_unlock(&slowlog_protector_);
+Status PikaServer::SlotsMigrateAsync(const MigrateDest& dest,
+                                     const std::string& table_name,
+                                     uint32_t slot, int64_t scan_keys) {
+  return pika_migrate_thread_->MigrateSlot(dest, table_name, slot, scan_keys);
+}
+
+void PikaServer::SlotsMigrateStatus(MigrateStatus* status) {
+  pika_migrate_thread_->GetStatus(status);
+}
 
-  SlowlogTrim();
+void PikaServer::SlotsMigrateCancel() {
+  pika_migrate_thread_->Cancel();
+}
+
+Status PikaServer::SlotsMigrateKeys(const MigrateDest& dest,
+                                    const std::string& table_name,
+                                    std::shared_ptr<Partition> partition,
+                                    const std::vector<std::string>& keys,
+                                    int64_t* moved) {
+  return pika_migrate_thread_->MigrateKeys(dest, table_name, partition, keys, moved);
+}
+
+bool PikaServer::SlotsMigrateKeyInflight(const std::string& table_name,
+                                         const std::string& key) {
+  return pika_migrate_thread_->IsKeyInflight(table_name, key);
 }
 
 void PikaServer::ResetStat() {
   statistic_data_.accumulative_connections.store(0);
-  statistic_data_.thread_querynum.store(0);
+  {
+  slash::MutexLock l(&statistic_data_.thread_stats_mu);
+  for (auto thread_stat : statistic_data_.thread_stats) {
+    thread_stat->querynum.store(0);
+  }
+  }
   statistic_data_.last_thread_querynum.store(0);
+  ResetLatency();
 }
 
 uint64_t PikaServer::ServerQueryNum() {
-  return statistic_data_.thread_querynum.load();
+  return ThreadQueryNum();
 }
 
 uint64_t PikaServer::ServerCurrentQps() {
@@ -1201,7 +1264,7 @@ void PikaServer::incr_accumulative_connections() {
 // only one thread invoke this right now
 void PikaServer::ResetLastSecQuerynum() {
   uint64_t last_query = statistic_data_.last_thread_querynum.load();
-  uint64_t cur_query = statistic_data_.thread_querynum.load();
+  uint64_t cur_query = ThreadQueryNum();
   uint64_t last_time_us = statistic_data_.last_time_us.load();
   if (cur_query < last_query) {
     cur_query = last_query;
@@ -1218,28 +1281,143 @@ void PikaServer::ResetLastSecQuerynum() {
   statistic_data_.last_time_us.store(cur_time_us);
 }
 
-void PikaServer::UpdateQueryNumAndExecCountTable(const std::string& command) {
-  std::string cmd(command);
-  statistic_data_.thread_querynum++;
-  statistic_data_.exec_count_table[slash::StringToUpper(cmd)]++;
+void PikaServer::UpdateQueryNumAndExecCountTable(uint32_t cmd_id) {
+  ThreadStatisticData* thread_stat = CurrentThreadStatistic();
+  thread_stat->querynum.fetch_add(1, std::memory_order_relaxed);
+  if (cmd_id < statistic_data_.cmd_names.size()) {
+    thread_stat->cmd_calls[cmd_id].fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void PikaServer::UpdateCmdExecTime(uint32_t cmd_id, uint64_t duration_us) {
+  if (cmd_id < statistic_data_.cmd_names.size()) {
+    ThreadStatisticData* thread_stat = CurrentThreadStatistic();
+    thread_stat->cmd_usecs[cmd_id].fetch_add(duration_us, std::memory_order_relaxed);
+    thread_stat->CmdLatency(cmd_id)->Add(duration_us);
+  }
+}
+
+const char* LatencyStageName(LatencyStage stage) {
+  static const char* kStageNames[kLatencyStageNum] = {"queue", "lock", "do", "binlog"};
+  return stage < kLatencyStageNum ? kStageNames[stage] : "unknown";
+}
+
+void PikaServer::UpdateStageLatency(LatencyStage stage, uint64_t duration_us) {
+  CurrentThreadStatistic()->stage_latency[stage].Add(duration_us);
+}
+
+std::map<std::string, LatencySummary> PikaServer::ServerCmdLatency() {
+  size_t cmd_num = statistic_data_.cmd_names.size();
+  std::vector<std::unique_ptr<LatencyHistogram>> merged(cmd_num);
+  {
+  slash::MutexLock l(&statistic_data_.thread_stats_mu);
+  for (auto thread_stat : statistic_data_.thread_stats) {
+    for (size_t idx = 0; idx < cmd_num; ++idx) {
+      LatencyHistogram* histogram = thread_stat->cmd_latency[idx].load(std::memory_order_acquire);
+      if (histogram == nullptr) {
+        continue;
+      }
+      if (!merged[idx]) {
+        merged[idx].reset(new LatencyHistogram());
+      }
+      merged[idx]->Merge(*histogram);
+    }
+  }
+  }
+  std::map<std::string, LatencySummary> res;
+  for (size_t idx = 0; idx < cmd_num; ++idx) {
+    if (merged[idx] && merged[idx]->Count() != 0) {
+      res[statistic_data_.cmd_names[idx]] = merged[idx]->Summary();
+    }
+  }
+  return res;
+}
+
+std::vector<LatencySummary> PikaServer::ServerStageLatency() {
+  LatencyHistogram merged[kLatencyStageNum];
+  {
+  slash::MutexLock l(&statistic_data_.thread_stats_mu);
+  for (auto thread_stat : statistic_data_.thread_stats) {
+    for (int stage = 0; stage < kLatencyStageNum; ++stage) {
+      merged[stage].Merge(thread_stat->stage_latency[stage]);
+    }
+  }
+  }
+  std::vector<LatencySummary> res;
+  for (int stage = 0; stage < kLatencyStageNum; ++stage) {
+    res.push_back(merged[stage].Summary());
+  }
+  return res;
+}
+
+void PikaServer::ResetLatency() {
+  slash::MutexLock l(&statistic_data_.thread_stats_mu);
+  for (auto thread_stat : statistic_data_.thread_stats) {
+    for (size_t idx = 0; idx < thread_stat->cmd_num; ++idx) {
+      LatencyHistogram* histogram = thread_stat->cmd_latency[idx].load(std::memory_order_acquire);
+      if (histogram != nullptr) {
+        histogram->Clear();
+      }
+    }
+    for (int stage = 0; stage < kLatencyStageNum; ++stage) {
+      thread_stat->stage_latency[stage].Clear();
+    }
+  }
 }
 
 std::unordered_map<std::string, uint64_t> PikaServer::ServerExecCountTable() {
   std::unordered_map<std::string, uint64_t> res;
-  for (auto& cmd : statistic_data_.exec_count_table) {
-    res[cmd.first] = cmd.second.load();
+  std::unordered_map<std::string, CmdExecStat> cmd_stats = ServerCmdExecStat();
+  for (const auto& item : cmd_stats) {
+    res[item.first] = item.second.calls;
   }
   return res;
 }
 
+std::unordered_map<std::string, CmdExecStat> PikaServer::ServerCmdExecStat() {
+  size_t cmd_num = statistic_data_.cmd_names.size();
+  std::vector<CmdExecStat> stats(cmd_num);
+  {
+  slash::MutexLock l(&statistic_data_.thread_stats_mu);
+  for (auto thread_stat : statistic_data_.thread_stats) {
+    for (size_t idx = 0; idx < cmd_num; ++idx) {
+      stats[idx].calls += thread_stat->cmd_calls[idx].load(std::memory_order_relaxed);
+      stats[idx].usecs += thread_stat->cmd_usecs[idx].load(std::memory_order_relaxed);
+    }
+  }
+  }
+  std::unordered_map<std::string, CmdExecStat> res;
+  for (size_t idx = 0; idx < cmd_num; ++idx) {
+    res[statistic_data_.cmd_names[idx]] = stats[idx];
+  }
+  return res;
+}
+
+ThreadStatisticData* PikaServer::CurrentThreadStatistic() {
+  static thread_local ThreadStatisticData* thread_stat = nullptr;
+  if (thread_stat == nullptr) {
+    thread_stat = new ThreadStatisticData(statistic_data_.cmd_names.size());
+    slash::MutexLock l(&statistic_data_.thread_stats_mu);
+    statistic_data_.thread_stats.push_back(thread_stat);
+  }
+  return thread_stat;
+}
+
+uint64_t PikaServer::ThreadQueryNum() {
+  uint64_t querynum = 0;
+  slash::MutexLock l(&statistic_data_.thread_stats_mu);
+  for (auto thread_stat : statistic_data_.thread_stats) {
+    querynum += thread_stat->querynum.load(std::memory_order_relaxed);
+  }
+  return querynum;
+}
+
 int PikaServer::SendToPeer() {
   return g_pika_rm->ConsumeWriteQueue();
 }
 
 void PikaServer::SignalAuxiliary() {
-  pika_auxiliary_thread_->mu_.Lock();
-  pika_auxiliary_thread_->cv_.Signal();
-  pika_auxiliary_thread_->mu_.Unlock();
+  pika_auxiliary_thread_->Wakeup();
 }
 
 Status PikaServer::TriggerSendBinlogSync() {
@@ -1291,6 +1469,8 @@ void PikaServer::DoTimingTask() {
   AutoDeleteExpiredDump();
   // Cheek Rsync Status
   AutoKeepAliveRSync();
+  // Fold the sampled hot keys of the last period
+  AutoMergeHotKeys();
 }
 
 void PikaServer::AutoCompactRange() {
@@ -1469,10 +1649,16 @@ void PikaServer::AutoKeepAliveRSync() {
   }
 }
 
+void PikaServer::AutoMergeHotKeys() {
+  hotkey_tracker_.Merge(g_pika_conf->hotkey_sample_rate());
+}
+
 void PikaServer::InitBlackwidowOptions() {
 
   // For rocksdb::Options
   bw_options_.options.create_if_missing = true;
+  // sst reads of a throttled thread (INFO KEYSPACE 1) are rate limited
+  bw_options_.options.env = IoThrottleEnv();
   bw_options_.options.keep_log_file_num = 10;
   bw_options_.options.max_manifest_file_size = 64 * 1024 * 1024;
   bw_options_.options.max_log_file_size = 512 * 1024 * 1024;
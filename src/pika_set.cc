@@ -91,6 +91,7 @@ void SMembersCmd::Do(std::shared_ptr<Partition> partition) {
     for (const auto& member : members) {
       res_.AppendStringLen(member.size());
       res_.AppendContent(member);
+      FlushReply();
     }
   } else {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
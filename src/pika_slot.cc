@@ -3,6 +3,8 @@
 // LICENSE file in the root directory of this source tree. An additional grant
 // of patent rights can be found in the PATENTS file in the same directory.
 
+#include <algorithm>
+
 #include "include/pika_rm.h"
 #include "include/pika_slot.h"
 #include "include/pika_table.h"
@@ -14,6 +16,79 @@ extern PikaReplicaManager* g_pika_rm;
 extern PikaServer* g_pika_server;
 extern PikaConf* g_pika_conf;
 
+// host port timeout, the first arguments of every migrate command
+static bool ParseMigrateDest(const PikaCmdArgsType& argv, const std::string& cmd_name,
+                             MigrateDest* dest, CmdRes* res) {
+  dest->ip = argv[1];
+  slash::StringToLower(dest->ip);
+  if (!slash::string2l(argv[2].data(), argv[2].size(), &dest->port) || dest->port <= 0) {
+    res->SetRes(CmdRes::kInvalidInt, cmd_name);
+    return false;
+  }
+  if ((dest->ip == "127.0.0.1" || dest->ip == g_pika_server->host()) && dest->port == g_pika_server->port()) {
+    res->SetRes(CmdRes::kErrOther, "destination address error");
+    return false;
+  }
+  if (!slash::string2l(argv[3].data(), argv[3].size(), &dest->timeout_ms)) {
+    res->SetRes(CmdRes::kInvalidInt, cmd_name);
+    return false;
+  }
+  if (dest->timeout_ms <= 0) {
+    dest->timeout_ms = kMigrateDefaultTimeoutMs;
+  }
+  return true;
+}
+
+static bool ParseSlotNum(const std::string& arg, int64_t* slot_num) {
+  return slash::string2l(arg.data(), arg.size(), slot_num)
+    && *slot_num >= 0 && *slot_num < g_pika_conf->default_slot_num();
+}
+
+// Move key on the calling thread, reply the number of keys moved
+static void MigrateOneKey(const MigrateDest& dest, const std::string& key, CmdRes* res) {
+  std::string table_name = g_pika_conf->default_table();
+  std::shared_ptr<Partition> partition = g_pika_server->GetTablePartitionByKey(table_name, key);
+  if (!partition) {
+    res->SetRes(CmdRes::kErrOther, "Partition not found");
+    return;
+  }
+  int64_t moved = 0;
+  Status s = g_pika_server->SlotsMigrateKeys(dest, table_name, partition, {key}, &moved);
+  if (!s.ok()) {
+    res->SetRes(CmdRes::kErrOther, s.ToString());
+    return;
+  }
+  res->AppendInteger(moved);
+}
+
+// Move a key of the slot on the calling thread, reply the number of keys
+// moved and whether any key is left, counting them needs a full scan
+static void MigrateSlotOneKey(const MigrateDest& dest, int64_t slot_num, CmdRes* res) {
+  std::string table_name = g_pika_conf->default_table();
+  std::shared_ptr<Table> table_ptr = g_pika_server->GetTable(table_name);
+  std::shared_ptr<Partition> partition =
+      table_ptr ? table_ptr->GetPartitionById(slot_num) : nullptr;
+  if (!partition) {
+    res->SetRes(CmdRes::kErrOther, "Partition not found");
+    return;
+  }
+  std::vector<std::string> keys;
+  partition->db()->Scan(blackwidow::DataType::kAll, 0, "*", 1, &keys);
+  int64_t moved = 0;
+  if (!keys.empty()) {
+    Status s = g_pika_server->SlotsMigrateKeys(dest, table_name, partition, keys, &moved);
+    if (!s.ok()) {
+      res->SetRes(CmdRes::kErrOther, s.ToString());
+      return;
+    }
+  }
+  keys.clear();
+  partition->db()->Scan(blackwidow::DataType::kAll, 0, "*", 1, &keys);
+  res->AppendArrayLen(2);
+  res->AppendInteger(moved);
+  res->AppendInteger(keys.empty() ? 0 : 1);
+}
+
 // SLOTSINFO
 void SlotsInfoCmd::DoInitial() {
   if (!CheckArg(argv_.size())) {
@@ -96,19 +171,49 @@ void SlotsMgrtSlotAsyncCmd::DoInitial() {
   }
 
   if (g_pika_conf->classic_mode()) {
-    res_.SetRes(CmdRes::kErrOther, "SLOTSMGRTTAGSLOT-ASYNC only support on sharding mode");
+    res_.SetRes(CmdRes::kErrOther, "SLOTSMGRTSLOT-ASYNC only support on sharding mode");
     return;
   }
 
+  if (!ParseMigrateDest(argv_, kCmdNameSlotsMgrtSlotAsync, &dest_, &res_)) {
+    return;
+  }
+  if (!slash::string2l(argv_[4].data(), argv_[4].size(), &dest_.max_bulks)
+    || !slash::string2l(argv_[5].data(), argv_[5].size(), &dest_.max_bytes)
+    || !slash::string2l(argv_[7].data(), argv_[7].size(), &keys_num_)) {
+    res_.SetRes(CmdRes::kInvalidInt, kCmdNameSlotsMgrtSlotAsync);
+    return;
+  }
+  if (dest_.max_bulks <= 0) {
+    dest_.max_bulks = kMigrateDefaultMaxBulks;
+  }
+  if (dest_.max_bytes <= 0) {
+    dest_.max_bytes = kMigrateDefaultMaxBytes;
+  }
+  if (keys_num_ <= 0) {
+    keys_num_ = dest_.max_bulks;
+  }
+  if (!ParseSlotNum(argv_[6], &slot_num_)) {
+    res_.SetRes(CmdRes::kInvalidInt, kCmdNameSlotsMgrtSlotAsync);
+    return;
+  }
   return;
 }
 
 void SlotsMgrtSlotAsyncCmd::Do(std::shared_ptr<Partition> partition) {
-  int64_t moved = 0;
-  int64_t remained = 0;
+  // the keys are moved in the background, the proxy calls again until
+  // none remains
+  Status s = g_pika_server->SlotsMigrateAsync(dest_, g_pika_conf->default_table(),
+                                              slot_num_, keys_num_);
+  if (!s.ok()) {
+    res_.SetRes(CmdRes::kErrOther, s.ToString());
+    return;
+  }
+  MigrateStatus status;
+  g_pika_server->SlotsMigrateStatus(&status);
   res_.AppendArrayLen(2);
-  res_.AppendInteger(moved);
-  res_.AppendInteger(remained);
+  res_.AppendInteger(status.moved);
+  res_.AppendInteger(status.remained);
 }
 
 // SLOTSMGRTTAGSLOT-ASYNC host port timeout maxbulks maxbytes slot numkeys
@@ -330,9 +435,57 @@ void SlotsMgrtExecWrapperCmd::Do(std::shared_ptr<Partition> partition) {
   // return 0 means proxy will request to new slot server
   // return 1 means proxy will keey trying
   // return 2 means return this key directly
-  res_.AppendArrayLen(2);
-  res_.AppendInteger(1);
-  res_.AppendInteger(1);
+  PikaCmdArgsType sub_argv(argv_.begin() + 2, argv_.end());
+  std::shared_ptr<Cmd> sub_cmd = g_pika_cmd_table_manager->GetCmd(sub_argv[0]);
+  if (!sub_cmd || sub_cmd->name() == kCmdNameSlotsMgrtExecWrapper) {
+    res_.SetRes(CmdRes::kErrOther, "unknown or unsupported command '" + sub_argv[0] + "'");
+    return;
+  }
+  sub_cmd->Initial(sub_argv, table_name_);
+  if (!sub_cmd->res().ok()) {
+    res_ = sub_cmd->res();
+    return;
+  }
+
+  std::shared_ptr<Partition> key_partition = g_pika_server->GetTablePartitionByKey(table_name_, key_);
+  if (!key_partition) {
+    res_.SetRes(CmdRes::kErrOther, "Partition not found");
+    return;
+  }
+  std::vector<std::string> keys = sub_cmd->current_key();
+  for (const auto& key : keys) {
+    if (g_pika_server->GetTablePartitionByKey(table_name_, key) != key_partition) {
+      res_.SetRes(CmdRes::kErrOther, "keys of the command are not in the slot of the hashkey");
+      return;
+    }
+  }
+  if (sub_cmd->is_write() && g_pika_server->readonly(table_name_, key_)) {
+    res_.SetRes(CmdRes::kErrOther, "Server in read-only");
+    return;
+  }
+
+  // checked and run under the record locks, so the key can't leave
+  // between the check and the command
+  keys.push_back(key_);
+  slash::lock::MultiRecordLock record_lock(key_partition->LockMgr());
+  record_lock.Lock(keys);
+  std::map<blackwidow::DataType, blackwidow::Status> type_status;
+  if (key_partition->db()->Exists({key_}, &type_status) <= 0) {
+    res_.AppendArrayLen(2);
+    res_.AppendInteger(0);
+    res_.AppendContent("-ERR the specified key doesn't exist");
+  } else if (sub_cmd->is_write()
+    && g_pika_server->SlotsMigrateKeyInflight(table_name_, key_)) {
+    res_.AppendArrayLen(2);
+    res_.AppendInteger(1);
+    res_.AppendContent("-ERR the specified key is being migrated");
+  } else {
+    sub_cmd->ProcessCommandLocked(key_partition);
+    res_.AppendArrayLen(2);
+    res_.AppendInteger(2);
+    res_.AppendStringRaw(sub_cmd->res().message());
+  }
+  record_lock.Unlock(keys);
   return;
 }
 
@@ -352,26 +505,32 @@ void SlotsMgrtAsyncStatusCmd::DoInitial() {
 }
 
 void SlotsMgrtAsyncStatusCmd::Do(std::shared_ptr<Partition> partition) {
-  std::string status;
+  MigrateStatus status;
+  g_pika_server->SlotsMigrateStatus(&status);
   std::string ip = "none";
-  int64_t port = -1, slot = -1, moved = -1, remained = -1;
-  std::string mstatus = "no";
-  res_.AppendArrayLen(5);
-  status = "dest server: " + ip + ":" + std::to_string(port);
-  res_.AppendStringLen(status.size());
-  res_.AppendContent(status);
-  status = "slot number: " + std::to_string(slot);
-  res_.AppendStringLen(status.size());
-  res_.AppendContent(status);
-  status = "migrating  : " + mstatus;
-  res_.AppendStringLen(status.size());
-  res_.AppendContent(status);
-  status = "moved keys : " + std::to_string(moved);
-  res_.AppendStringLen(status.size());
-  res_.AppendContent(status);
-  status = "remain keys: " + std::to_string(remained);
-  res_.AppendStringLen(status.size());
-  res_.AppendContent(status);
+  int64_t port = -1, moved = -1, remained = -1;
+  if (status.slot >= 0) {
+    ip = status.dest.ip;
+    port = status.dest.port;
+    moved = status.moved;
+    remained = status.remained;
+  }
+  uint64_t elapsed_us = std::max<uint64_t>(status.elapsed_us, 1);
+  std::vector<std::string> lines;
+  lines.push_back("dest server: " + ip + ":" + std::to_string(port));
+  lines.push_back("slot number: " + std::to_string(status.slot));
+  lines.push_back("migrating  : " + std::string(status.migrating ? "yes" : "no"));
+  lines.push_back("moved keys : " + std::to_string(moved));
+  lines.push_back("remain keys: " + std::to_string(remained));
+  lines.push_back("elapsed ms : " + std::to_string(status.elapsed_us / 1000));
+  lines.push_back("keys/sec   : " + std::to_string(status.moved * 1000000 / elapsed_us));
+  lines.push_back("bytes/sec  : " + std::to_string(status.sent_bytes * 1000000 / elapsed_us));
+  lines.push_back("last error : " + (status.error.empty() ? std::string("none") : status.error));
+  res_.AppendArrayLen(lines.size());
+  for (const auto& line : lines) {
+    res_.AppendStringLen(line.size());
+    res_.AppendContent(line);
+  }
   return;
 }
 
@@ -391,46 +550,113 @@ void SlotsMgrtAsyncCancelCmd::DoInitial() {
 }
 
 void SlotsMgrtAsyncCancelCmd::Do(std::shared_ptr<Partition> partition) {
+  g_pika_server->SlotsMigrateCancel();
   res_.SetRes(CmdRes::kOk);
   return;
 }
 
 // slotsmgrtslot host port timeout slot
 void SlotsMgrtSlotCmd::DoInitial() {
-  res_.SetRes(CmdRes::kErrOther, kCmdNameSlotsMgrtSlot + " NOT supported");
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameSlotsMgrtSlot);
+    return;
+  }
+
+  if (g_pika_conf->classic_mode()) {
+    res_.SetRes(CmdRes::kErrOther, "SLOTSMGRTSLOT only support on sharding mode");
+    return;
+  }
+
+  if (!ParseMigrateDest(argv_, kCmdNameSlotsMgrtSlot, &dest_, &res_)) {
+    return;
+  }
+  if (!ParseSlotNum(argv_[4], &slot_num_)) {
+    res_.SetRes(CmdRes::kInvalidInt, kCmdNameSlotsMgrtSlot);
+    return;
+  }
   return;
 }
 
 void SlotsMgrtSlotCmd::Do(std::shared_ptr<Partition> partition) {
+  MigrateSlotOneKey(dest_, slot_num_, &res_);
   return;
 }
 
 // slotsmgrttagslot host port timeout slot
 void SlotsMgrtTagSlotCmd::DoInitial() {
-  res_.SetRes(CmdRes::kErrOther, kCmdNameSlotsMgrtTagSlot + " NOT supported");
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameSlotsMgrtTagSlot);
+    return;
+  }
+
+  if (g_pika_conf->classic_mode()) {
+    res_.SetRes(CmdRes::kErrOther, "SLOTSMGRTTAGSLOT only support on sharding mode");
+    return;
+  }
+
+  if (!ParseMigrateDest(argv_, kCmdNameSlotsMgrtTagSlot, &dest_, &res_)) {
+    return;
+  }
+  if (!ParseSlotNum(argv_[4], &slot_num_)) {
+    res_.SetRes(CmdRes::kInvalidInt, kCmdNameSlotsMgrtTagSlot);
+    return;
+  }
   return;
 }
 
+// keys are distributed without their hash tag, so the tag group of a
+// key is the key itself
 void SlotsMgrtTagSlotCmd::Do(std::shared_ptr<Partition> partition) {
+  MigrateSlotOneKey(dest_, slot_num_, &res_);
   return;
 }
 
 // slotsmgrtone host port timeout key
 void SlotsMgrtOneCmd::DoInitial() {
-  res_.SetRes(CmdRes::kErrOther, kCmdNameSlotsMgrtOne + " NOT supported");
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameSlotsMgrtOne);
+    return;
+  }
+
+  if (g_pika_conf->classic_mode()) {
+    res_.SetRes(CmdRes::kErrOther, "SLOTSMGRTONE only support on sharding mode");
+    return;
+  }
+
+  if (!ParseMigrateDest(argv_, kCmdNameSlotsMgrtOne, &dest_, &res_)) {
+    return;
+  }
+  key_ = argv_[4];
   return;
 }
 
 void SlotsMgrtOneCmd::Do(std::shared_ptr<Partition> partition) {
+  MigrateOneKey(dest_, key_, &res_);
   return;
 }
 
 // slotsmgrttagone host port timeout key
 void SlotsMgrtTagOneCmd::DoInitial() {
-  res_.SetRes(CmdRes::kErrOther, kCmdNameSlotsMgrtTagOne + " NOT supported");
+  if (!CheckArg(argv_.size())) {
+    res_.SetRes(CmdRes::kWrongNum, kCmdNameSlotsMgrtTagOne);
+    return;
+  }
+
+  if (g_pika_conf->classic_mode()) {
+    res_.SetRes(CmdRes::kErrOther, "SLOTSMGRTTAGONE only support on sharding mode");
+    return;
+  }
+
+  if (!ParseMigrateDest(argv_, kCmdNameSlotsMgrtTagOne, &dest_, &res_)) {
+    return;
+  }
+  key_ = argv_[4];
   return;
 }
 
+// keys are distributed without their hash tag, so the tag group of a
+// key is the key itself
 void SlotsMgrtTagOneCmd::Do(std::shared_ptr<Partition> partition) {
+  MigrateOneKey(dest_, key_, &res_);
   return;
 }
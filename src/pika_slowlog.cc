@@ -0,0 +1,138 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_slowlog.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <string>
+
+static size_t RoundUpPowerOfTwo(size_t n) {
+  size_t res = 1;
+  while (res < n) {
+    res <<= 1;
+  }
+  return res;
+}
+
+void SlowlogRing::Slot::Lock() {
+  while (busy.exchange(true, std::memory_order_acquire)) {
+    sched_yield();
+  }
+}
+
+SlowlogRing::SlowlogRing(uint32_t max_len)
+    : capacity_(RoundUpPowerOfTwo(std::max<uint32_t>(max_len, 1))),
+      max_len_(max_len),
+      next_id_(0),
+      reset_id_(0) {
+  slots_ = new Slot[capacity_];
+}
+
+SlowlogRing::~SlowlogRing() {
+  delete[] slots_;
+}
+
+void SlowlogRing::Push(const pink::RedisCmdArgsType& argv, int32_t start_time,
+                       int64_t duration, uint32_t max_arg_len) {
+  if (max_len_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  // built out of any lock, the buffers come from the entry this
+  // thread overwrote last time
+  static thread_local SlowlogEntry staging;
+  size_t argc = std::min<size_t>(argv.size(), SLOWLOG_ENTRY_MAX_ARGC);
+  staging.argv.resize(argc);
+  for (size_t idx = 0; idx < argc; ++idx) {
+    std::string& arg = staging.argv[idx];
+    if (argc != argv.size() && idx == argc - 1) {
+      arg.assign("... (");
+      arg.append(std::to_string(argv.size() - argc + 1));
+      arg.append(" more arguments)");
+    } else if (idx != 0 && argv[idx].size() > max_arg_len) {
+      arg.assign(argv[idx], 0, max_arg_len);
+      arg.append("... (");
+      arg.append(std::to_string(argv[idx].size() - max_arg_len));
+      arg.append(" more bytes)");
+    } else {
+      arg.assign(argv[idx]);
+    }
+  }
+  staging.start_time = start_time;
+  staging.duration = duration;
+
+  ScalableRWLockGuard l(&resize_lock_, false);
+  staging.id = next_id_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[staging.id & (capacity_ - 1)];
+  slot.Lock();
+  // a newer pusher may have lapped us on a tiny ring
+  if (slot.entry.id < staging.id) {
+    std::swap(slot.entry, staging);
+  }
+  slot.Unlock();
+}
+
+void SlowlogRing::SetMaxLen(uint32_t max_len) {
+  size_t capacity = RoundUpPowerOfTwo(std::max<uint32_t>(max_len, 1));
+  if (capacity != capacity_) {
+    ScalableRWLockGuard l(&resize_lock_, true);
+    if (capacity != capacity_) {
+      // when shrinking, entries of the same new slot keep the newest
+      Slot* slots = new Slot[capacity];
+      for (size_t i = 0; i < capacity_; ++i) {
+        int64_t id = slots_[i].entry.id;
+        if (id >= 0 && id > slots[id & (capacity - 1)].entry.id) {
+          std::swap(slots[id & (capacity - 1)].entry, slots_[i].entry);
+        }
+      }
+      delete[] slots_;
+      slots_ = slots;
+      capacity_ = capacity;
+    }
+  }
+  uint32_t old_max_len = max_len_.exchange(max_len);
+  if (max_len < old_max_len) {
+    // entries beyond the new length are gone, growing back later must
+    // not bring them back
+    int64_t oldest_id = next_id_.load() - max_len;
+    int64_t reset_id = reset_id_.load();
+    while (reset_id < oldest_id
+      && !reset_id_.compare_exchange_weak(reset_id, oldest_id)) {
+    }
+  }
+}
+
+void SlowlogRing::Reset() {
+  reset_id_.store(next_id_.load());
+}
+
+int64_t SlowlogRing::OldestId(int64_t next_id) {
+  int64_t len = std::min<int64_t>(max_len_.load(), capacity_);
+  return std::max(reset_id_.load(), next_id - len);
+}
+
+uint32_t SlowlogRing::Len() {
+  ScalableRWLockGuard l(&resize_lock_, false);
+  int64_t next_id = next_id_.load();
+  return next_id - std::min(OldestId(next_id), next_id);
+}
+
+void SlowlogRing::Obtain(int64_t number, std::vector<SlowlogEntry>* entries) {
+  entries->clear();
+  ScalableRWLockGuard l(&resize_lock_, false);
+  int64_t next_id = next_id_.load();
+  int64_t oldest_id = OldestId(next_id);
+  for (int64_t id = next_id - 1; id >= oldest_id && number > 0; --id) {
+    Slot& slot = slots_[id & (capacity_ - 1)];
+    slot.Lock();
+    // skip entries which are not published yet or already overwritten
+    if (slot.entry.id == id) {
+      entries->push_back(slot.entry);
+      --number;
+    }
+    slot.Unlock();
+  }
+}
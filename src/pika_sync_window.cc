@@ -0,0 +1,101 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+#include "include/pika_sync_window.h"
+
+#include <glog/logging.h>
+
+#include "slash/include/env.h"
+
+// initial ring size, grown on demand up to sync-window-size
+#define kSyncWindowInitSize 1024
+
+SyncWindow::SyncWindow()
+  : ring_(kSyncWindowInitSize), head_(0), size_(0) {
+}
+
+void SyncWindow::Push(const SyncWinItem& item) {
+  if (size_ == ring_.size()) {
+    Grow();
+  }
+  At(size_) = item;
+  size_++;
+}
+
+void SyncWindow::Grow() {
+  std::vector<SyncWinItem> ring(ring_.size() * 2);
+  for (size_t i = 0; i < size_; ++i) {
+    ring[i] = At(i);
+  }
+  ring_.swap(ring);
+  head_ = 0;
+}
+
+bool SyncWindow::LocateStart(const BinlogOffset& offset, size_t* index) const {
+  if (size_ == 0) {
+    return false;
+  }
+  if (At(0).offset_ == offset) {
+    *index = 0;
+    return true;
+  }
+  size_t low = 1, high = size_;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (At(mid).offset_ < offset) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low == size_ || !(At(low).offset_ == offset)) {
+    return false;
+  }
+  *index = low;
+  return true;
+}
+
+bool SyncWindow::Update(const SyncWinItem& start_item,
+    const SyncWinItem& end_item, BinlogOffset* acked_offset,
+    uint64_t* ack_latency, LatencyHistogram* item_latency) {
+  size_t start_pos = 0, end_pos = 0;
+  bool found = LocateStart(start_item.offset_, &start_pos)
+    && !(At(size_ - 1).offset_ < end_item.offset_);
+  if (found) {
+    // walk the acked range once, end is within the window
+    end_pos = start_pos;
+    while (At(end_pos).offset_ < end_item.offset_) {
+      end_pos++;
+    }
+    found = At(end_pos).offset_ == end_item.offset_;
+  }
+  if (!found) {
+    LOG(WARNING) << "Ack offset Start: " <<
+      start_item.ToString() << "End: " << end_item.ToString() <<
+      " not found in binlog controller window." <<
+      std::endl << "window status "<< std::endl << ToStringStatus();
+    return false;
+  }
+  for (size_t i = start_pos; i <= end_pos; ++i) {
+    At(i).acked_ = true;
+  }
+  uint64_t now = slash::NowMicros();
+  *ack_latency = now > At(end_pos).send_time_ ? now - At(end_pos).send_time_ : 0;
+  while (size_ > 0 && At(0).acked_) {
+    const SyncWinItem& item = At(0);
+    *acked_offset = item.offset_;
+    if (item_latency != NULL && now > item.send_time_) {
+      item_latency->Add(now - item.send_time_);
+    }
+    head_ = (head_ + 1) & (ring_.size() - 1);
+    size_--;
+  }
+  return true;
+}
+
+int SyncWindow::Remainings(int window_size) const {
+  int remaining_size = window_size - static_cast<int>(size_);
+  return remaining_size > 0 ? remaining_size : 0;
+}
@@ -5,9 +5,15 @@
 
 #include "include/pika_table.h"
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include "include/pika_server.h"
+#include "include/pika_io_throttle.h"
 #include "include/pika_cmd_table_manager.h"
 
+extern PikaConf* g_pika_conf;
 extern PikaServer* g_pika_server;
 extern PikaCmdTableManager* g_pika_cmd_table_manager;
 
@@ -23,7 +29,8 @@ Table::Table(const std::string& table_name,
              const std::string& db_path,
              const std::string& log_path) :
   table_name_(table_name),
-  partition_num_(partition_num) {
+  partition_num_(partition_num),
+  key_scan_throttle_(NULL) {
 
   db_path_ = TablePath(db_path, table_name_);
   log_path_ = TablePath(log_path, "log_" + table_name_);
@@ -108,9 +115,30 @@ Status Table::AddPartitions(const std::set<uint32_t>& partition_ids) {
     }
   }
 
-  for (const uint32_t& id : partition_ids) {
-    partitions_.emplace(id, std::make_shared<Partition>(
-          table_name_, id, db_path_, log_path_));
+  // Opening a partition is dominated by rocksdb recovery, open them
+  // on at most thread-pool-size threads
+  std::vector<uint32_t> ids(partition_ids.begin(), partition_ids.end());
+  std::vector<std::shared_ptr<Partition>> opened(ids.size());
+  std::atomic<size_t> next(0);
+  auto open_partitions = [&]() {
+    for (size_t i = next++; i < ids.size(); i = next++) {
+      opened[i] = std::make_shared<Partition>(
+          table_name_, ids[i], db_path_, log_path_);
+    }
+  };
+  size_t thread_num = std::min(ids.size(),
+      static_cast<size_t>(std::max(g_pika_conf->thread_pool_size(), 1)));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_num; ++i) {
+    threads.push_back(std::thread(open_partitions));
+  }
+  open_partitions();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < ids.size(); ++i) {
+    partitions_.emplace(ids[i], opened[i]);
   }
   return Status::OK();
 }
@@ -149,35 +177,90 @@ bool Table::IsKeyScaning() {
   return key_scan_info_.key_scaning_;
 }
 
+static void AddKeyInfos(const std::vector<blackwidow::KeyInfo>& from,
+                        std::vector<blackwidow::KeyInfo>* to) {
+  for (size_t idx = 0; idx < from.size() && idx < to->size(); ++idx) {
+    (*to)[idx].keys += from[idx].keys;
+    (*to)[idx].expires += from[idx].expires;
+    (*to)[idx].avg_ttl += from[idx].avg_ttl;
+    (*to)[idx].invaild_keys += from[idx].invaild_keys;
+  }
+}
+
 void Table::RunKeyScan() {
-  Status s;
   std::vector<blackwidow::KeyInfo> new_key_infos(5);
 
-  InitKeyScan();
   slash::RWLock rwl(&partitions_rw_, false);
+  std::vector<std::shared_ptr<Partition>> partitions;
   for (const auto& item : partitions_) {
-    std::vector<blackwidow::KeyInfo> tmp_key_infos;
-    s = item.second->GetKeyNum(&tmp_key_infos);
-    if (s.ok()) {
-      for (size_t idx = 0; idx < tmp_key_infos.size(); ++idx) {
-        new_key_infos[idx].keys += tmp_key_infos[idx].keys;
-        new_key_infos[idx].expires += tmp_key_infos[idx].expires;
-        new_key_infos[idx].avg_ttl += tmp_key_infos[idx].avg_ttl;
-        new_key_infos[idx].invaild_keys += tmp_key_infos[idx].invaild_keys;
+    partitions.push_back(item.second);
+  }
+  // Partitions are scanned by keyscan-concurrency threads, their sst
+  // reads sleep inside the scan once they run ahead of keyscan-bytes-per-sec
+  IoThrottle throttle([]() { return g_pika_conf->keyscan_bytes_per_sec(); });
+  {
+    slash::MutexLock lm(&key_scan_protector_);
+    InitKeyScan();
+    key_scan_info_.partitions_total = partitions.size();
+    key_scan_throttle_ = &throttle;
+  }
+
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  auto scan_partitions = [&]() {
+    ScopedIoThrottle scoped_throttle(&throttle);
+    for (size_t i = next++; i < partitions.size() && !failed; i = next++) {
+      std::vector<blackwidow::KeyInfo> tmp_key_infos;
+      Status s = partitions[i]->GetKeyNum(&tmp_key_infos);
+      if (!s.ok()) {
+        failed = true;
+        break;
       }
-    } else {
-      break;
+      uint64_t keys = 0;
+      for (const auto& key_info : tmp_key_infos) {
+        keys += key_info.keys;
+      }
+      slash::MutexLock lm(&key_scan_protector_);
+      AddKeyInfos(tmp_key_infos, &new_key_infos);
+      key_scan_info_.partitions_done++;
+      key_scan_info_.keys_scanned += keys;
     }
+  };
+  size_t thread_num = std::min(partitions.size(),
+      static_cast<size_t>(g_pika_conf->keyscan_concurrency()));
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < thread_num; ++i) {
+    threads.push_back(std::thread(scan_partitions));
+  }
+  scan_partitions();
+  for (auto& thread : threads) {
+    thread.join();
   }
-  key_scan_info_.duration = time(NULL) - key_scan_info_.start_time;
 
   slash::MutexLock lm(&key_scan_protector_);
-  if (s.ok()) {
+  key_scan_throttle_ = NULL;
+  key_scan_info_.bytes_read = throttle.BytesRead();
+  key_scan_info_.duration = time(NULL) - key_scan_info_.start_time;
+  if (!failed) {
     key_scan_info_.key_infos = new_key_infos;
   }
   key_scan_info_.key_scaning_ = false;
 }
 
+Status Table::GetApproximateKeyNum(std::vector<blackwidow::KeyInfo>* key_infos) {
+  key_infos->assign(5, blackwidow::KeyInfo());
+  slash::RWLock rwl(&partitions_rw_, false);
+  for (const auto& item : partitions_) {
+    std::vector<blackwidow::KeyInfo> tmp_key_infos;
+    Status s = item.second->GetApproximateKeyNum(&tmp_key_infos);
+    if (!s.ok()) {
+      return s;
+    }
+    AddKeyInfos(tmp_key_infos, key_infos);
+  }
+  return Status::OK();
+}
+
 void Table::StopKeyScan() {
   slash::RWLock rwl(&partitions_rw_, false);
   slash::MutexLock ml(&key_scan_protector_);
@@ -205,6 +288,9 @@ Status Table::GetPartitionsKeyScanInfo(std::map<uint32_t, KeyScanInfo>* infos) {
 
 KeyScanInfo Table::GetKeyScanInfo() {
   slash::MutexLock lm(&key_scan_protector_);
+  if (key_scan_throttle_ != NULL) {
+    key_scan_info_.bytes_read = key_scan_throttle_->BytesRead();
+  }
   return key_scan_info_;
 }
 
@@ -222,6 +308,10 @@ void Table::DoKeyScan(void *arg) {
 }
 
 void Table::InitKeyScan() {
+  key_scan_info_.partitions_total = 0;
+  key_scan_info_.partitions_done = 0;
+  key_scan_info_.keys_scanned = 0;
+  key_scan_info_.bytes_read = 0;
   key_scan_info_.start_time = time(NULL);
   char s_time[32];
   int len = strftime(s_time, sizeof(s_time), "%Y-%m-%d %H:%M:%S", localtime(&key_scan_info_.start_time));
@@ -5,6 +5,10 @@
 
 #include "include/pika_zset.h"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
 #include "slash/include/slash_string.h"
 
 void ZAddCmd::DoInitial() {
@@ -195,12 +199,14 @@ void ZRangeCmd::Do(std::shared_ptr<Partition> partition) {
         len = slash::d2string(buf, sizeof(buf), sm.score);
         res_.AppendStringLen(len);
         res_.AppendContent(buf);
+        FlushReply();
       }
     } else {
       res_.AppendArrayLen(score_members.size());
       for (const auto& sm : score_members) {
         res_.AppendStringLen(sm.member.size());
         res_.AppendContent(sm.member);
+        FlushReply();
       }
     }
   } else {
@@ -231,12 +237,14 @@ void ZRevrangeCmd::Do(std::shared_ptr<Partition> partition) {
         len = slash::d2string(buf, sizeof(buf), sm.score);
         res_.AppendStringLen(len);
         res_.AppendContent(buf);
+        FlushReply();
       }
     } else {
       res_.AppendArrayLen(score_members.size());
       for (const auto& sm : score_members) {
         res_.AppendStringLen(sm.member.size());
         res_.AppendContent(sm.member);
+        FlushReply();
       }
     }
   } else {
@@ -275,7 +283,106 @@ int32_t DoScoreStrRange(std::string begin_score, std::string end_score, bool *le
 static void FitLimit(int64_t &count, int64_t &offset, const int64_t size) {
   count = count >= 0 ? count : size;
   offset = (offset >= 0 && offset < size) ? offset : size;
-  count = (offset + count < size) ? count : size - offset;
+  count = (count < size - offset) ? count : size - offset;
+}
+
+// Ranks [offset, offset + count) as blackwidow takes them, it reads a
+// rank range only up to the stop rank. count is at least 1
+static void LimitToRanks(int64_t offset, int64_t count, int32_t* start, int32_t* stop) {
+  *start = static_cast<int32_t>(std::min<int64_t>(offset, INT32_MAX));
+  *stop = count - 1 >= INT32_MAX - *start ? INT32_MAX : static_cast<int32_t>(*start + count - 1);
+}
+
+// Probes of a score range with a bounded start, see ZRangebyscoreLimit
+#define kZsetLimitProbes 16
+// larger LIMIT windows read the score range whole
+#define kZsetLimitProbeMaxWindow 1024
+
+/*
+ * blackwidow reads a score range to its end before LIMIT applies, while
+ * a rank range stops at its stop rank. When the range starts at the first
+ * member in the direction of the reply (-inf ascending, +inf descending)
+ * the window of LIMIT is the ranks [offset, offset + count), which are
+ * read and cut at the other bound.
+ *
+ * Otherwise small windows are found by probing growing score ranges
+ * from the start bound, width doubling from 1/2^16 of the range (of
+ * the start score when the range is unbounded), until one of them holds
+ * the window. A probe reads fewer members than the window unless it is
+ * the last one, which bounds the extra reads to 16 windows.
+ *
+ * Returns false if the range has to be read as a whole, else
+ * score_members is the LIMIT window
+ */
+static bool ZRangebyscoreLimit(std::shared_ptr<Partition> partition, const std::string& key,
+                               double min, double max, bool left_close, bool right_close,
+                               bool reverse, int64_t offset, int64_t count,
+                               std::vector<blackwidow::ScoreMember>* score_members,
+                               rocksdb::Status* s) {
+  if (offset < 0 || count < 0) {
+    return false;
+  }
+  score_members->clear();
+  if (count == 0) {
+    *s = rocksdb::Status::OK();
+    return true;
+  }
+  if (reverse ? (max == blackwidow::ZSET_SCORE_MAX && right_close)
+    : (min == blackwidow::ZSET_SCORE_MIN && left_close)) {
+    int32_t start, stop;
+    LimitToRanks(offset, count, &start, &stop);
+    if (reverse) {
+      *s = partition->db()->ZRevrange(key, start, stop, score_members);
+    } else {
+      *s = partition->db()->ZRange(key, start, stop, score_members);
+    }
+    auto out = score_members->begin();
+    for (; out != score_members->end(); ++out) {
+      if (reverse ? (out->score < min || (out->score == min && !left_close))
+        : (out->score > max || (out->score == max && !right_close))) {
+        break;
+      }
+    }
+    score_members->erase(out, score_members->end());
+    return true;
+  }
+
+  if (count > kZsetLimitProbeMaxWindow || offset > kZsetLimitProbeMaxWindow - count) {
+    return false;
+  }
+  size_t window = static_cast<size_t>(offset + count);
+  double from = reverse ? max : min;
+  double to = reverse ? min : max;
+  bool unbounded = reverse ? min == blackwidow::ZSET_SCORE_MIN : max == blackwidow::ZSET_SCORE_MAX;
+  double span = unbounded ? std::max(std::fabs(from), 1.0) : std::fabs(to - from);
+  double width = span / (1 << kZsetLimitProbes);
+  for (int probe = 0; probe < kZsetLimitProbes; ++probe) {
+    width *= 2;
+    double bound = reverse ? from - width : from + width;
+    // the last probe of a bounded range is the range itself
+    bool last = !unbounded && (probe == kZsetLimitProbes - 1
+      || (reverse ? bound <= to : bound >= to));
+    if (reverse) {
+      *s = last ? partition->db()->ZRevrangebyscore(key, min, max, left_close, right_close, score_members)
+                : partition->db()->ZRevrangebyscore(key, bound, max, true, right_close, score_members);
+    } else {
+      *s = last ? partition->db()->ZRangebyscore(key, min, max, left_close, right_close, score_members)
+                : partition->db()->ZRangebyscore(key, min, bound, left_close, true, score_members);
+    }
+    if (!s->ok() || last || score_members->size() >= window) {
+      break;
+    }
+  }
+  if (s->ok() && score_members->size() < window && unbounded) {
+    // not within 16 probes, the window is far from the start score
+    return false;
+  }
+  if (score_members->size() > window) {
+    score_members->resize(window);
+  }
+  score_members->erase(score_members->begin(),
+      score_members->begin() + std::min(score_members->size(), static_cast<size_t>(offset)));
+  return true;
 }
 
 void ZsetRangebyscoreParentCmd::DoInitial() {
@@ -330,7 +437,14 @@ void ZRangebyscoreCmd::Do(std::shared_ptr<Partition> partition) {
     return;
   }
   std::vector<blackwidow::ScoreMember> score_members;
-  rocksdb::Status s = partition->db()->ZRangebyscore(key_, min_score_, max_score_, left_close_, right_close_, &score_members);
+  rocksdb::Status s;
+  if (ZRangebyscoreLimit(partition, key_, min_score_, max_score_, left_close_, right_close_,
+                         false, offset_, count_, &score_members, &s)) {
+    offset_ = 0;
+    count_ = -1;
+  } else {
+    s = partition->db()->ZRangebyscore(key_, min_score_, max_score_, left_close_, right_close_, &score_members);
+  }
   if (!s.ok() && !s.IsNotFound()) {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
     return;
@@ -381,7 +495,14 @@ void ZRevrangebyscoreCmd::Do(std::shared_ptr<Partition> partition) {
     return;
   }
   std::vector<blackwidow::ScoreMember> score_members;
-  rocksdb::Status s = partition->db()->ZRevrangebyscore(key_, min_score_, max_score_, left_close_, right_close_, &score_members);
+  rocksdb::Status s;
+  if (ZRangebyscoreLimit(partition, key_, min_score_, max_score_, left_close_, right_close_,
+                         true, offset_, count_, &score_members, &s)) {
+    offset_ = 0;
+    count_ = -1;
+  } else {
+    s = partition->db()->ZRevrangebyscore(key_, min_score_, max_score_, left_close_, right_close_, &score_members);
+  }
   if (!s.ok() && !s.IsNotFound()) {
     res_.SetRes(CmdRes::kErrOther, s.ToString());
     return;
@@ -705,6 +826,9 @@ void ZRangebylexCmd::Do(std::shared_ptr<Partition> partition) {
     res_.AppendContent("*0");
     return;
   }
+  // Known gap: LIMIT is applied after reading the whole lex range, as
+  // blackwidow has no bounded lex read and a rank range only matches it
+  // while every score is equal, which Do can't check without a record lock
   std::vector<std::string> members;
   rocksdb::Status s = partition->db()->ZRangebylex(key_, min_member_, max_member_, left_close_, right_close_, &members);
   if (!s.ok() && !s.IsNotFound()) {
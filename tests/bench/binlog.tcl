@@ -0,0 +1,60 @@
+# Write path benchmarks, not part of the test suite, run them with
+# ./pikabench.sh binlog
+start_server {tags {"bench"}} {
+    test {Write throughput with and without binlog-group-commit} {
+        if {$::accurate} {set num 1000000} else {set num 100000}
+        set clients 8
+        foreach mode {no yes} {
+            r flushdb
+            r config set binlog-group-commit $mode
+            set rds {}
+            for {set i 0} {$i < $clients} {incr i} {
+                lappend rds [redis_deferring_client]
+            }
+            set start [clock milliseconds]
+            # every client pipelines its share so the writers overlap
+            set i 0
+            foreach rd $rds {
+                for {set j 0} {$j < $num / $clients} {incr j} {
+                    $rd set "group:$i:$j" $j
+                }
+                incr i
+            }
+            foreach rd $rds {
+                for {set j 0} {$j < $num / $clients} {incr j} {
+                    $rd read
+                }
+                $rd close
+            }
+            set elapsed [expr {max([clock milliseconds] - $start, 1)}]
+            puts "SET x $num from $clients clients, binlog-group-commit $mode: $elapsed ms, [expr {$num * 1000 / $elapsed}] ops/s"
+        }
+        r config set binlog-group-commit no
+    } {OK}
+
+    test {Binlog encoding cost by argv shape} {
+        if {$::accurate} {set num 200000} else {set num 20000}
+        set mset {}
+        for {set j 0} {$j < 50} {incr j} {
+            lappend mset "enc:mset:$j" [string repeat x 16]
+        }
+        set zadd {}
+        for {set j 0} {$j < 10} {incr j} {
+            lappend zadd [expr {$j * 1.5}] "member:$j"
+        }
+        set shapes [list \
+            set [list set enc:small foo] \
+            mset [concat mset $mset] \
+            hset [list hset enc:hash field [string repeat v 64]] \
+            zadd [concat zadd enc:zset $zadd] \
+            large [list set enc:large [string repeat x 65536]]]
+        foreach {shape cmd} $shapes {
+            set start [clock milliseconds]
+            for {set j 0} {$j < $num} {incr j} {
+                r {*}$cmd
+            }
+            set elapsed [expr {[clock milliseconds] - $start}]
+            puts "Write with $shape argv: [expr {$elapsed * 1000000.0 / $num}] ns/op"
+        }
+    }
+}
@@ -0,0 +1,32 @@
+# BITCOUNT and BITOP benchmark of every bitops kernel, run it with
+# ./pikabench.sh bitops, see also tools/bench/bitops_bench
+start_server {tags {"bench"}} {
+    test {BITCOUNT and BITOP OR of 3 keys on 1KB, 1MB and 64MB bitmaps} {
+        foreach size {1024 1048576 67108864} {
+            r del big1 big2 big3
+            r setrange big1 [expr {$size - 1}] "\x01"
+            r setrange big2 [expr {$size - 1}] "\x03"
+            r setrange big3 [expr {$size / 2}] "\xff"
+            set num [expr {$size > 1048576 ? 10 : 100}]
+            foreach kernel {scalar sse4.2 avx2} {
+                if {[catch {r config set bitops-kernel $kernel}]} {
+                    puts "$size bytes ($kernel): not supported by this CPU"
+                    continue
+                }
+                set start [clock milliseconds]
+                for {set j 0} {$j < $num} {incr j} {
+                    r bitcount big2
+                }
+                set count_ms [expr {([clock milliseconds] - $start) / double($num)}]
+                set start [clock milliseconds]
+                for {set j 0} {$j < $num} {incr j} {
+                    r bitop or dest big1 big2 big3
+                }
+                set op_ms [expr {([clock milliseconds] - $start) / double($num)}]
+                puts "$size bytes ($kernel): BITCOUNT $count_ms ms, BITOP OR of 3 keys $op_ms ms"
+            }
+        }
+        r config set bitops-kernel auto
+        r del big1 big2 big3 dest
+    }
+}
@@ -0,0 +1,28 @@
+# Command dispatch benchmark, run it with ./pikabench.sh dispatch
+start_server {tags {"bench"}} {
+    proc format_command {args} {
+        set cmd "*[llength $args]\r\n"
+        foreach a $args {
+            append cmd "$[string length $a]\r\n$a\r\n"
+        }
+        set _ $cmd
+    }
+
+    test "Dispatch path cost of pipelined commands" {
+        if {$::accurate} {set num 1000000} else {set num 100000}
+        reconnect
+        r set dispatch:key bar
+        foreach cmd {PING {GET dispatch:key} {get dispatch:key} {ExIsTs dispatch:key}} {
+            set start [clock milliseconds]
+            for {set j 0} {$j < $num} {incr j} {
+                r write [format_command {*}$cmd]
+            }
+            r flush
+            for {set j 0} {$j < $num} {incr j} {
+                r read
+            }
+            set elapsed [expr {[clock milliseconds] - $start}]
+            puts "Dispatch of '$cmd': [expr {$elapsed * 1000000.0 / $num}] ns/op"
+        }
+    }
+}
@@ -0,0 +1,49 @@
+# GEORADIUS COUNT benchmark, run it with ./pikabench.sh geo,
+# 1M points by default, 10M with --accurate
+start_server {tags {"bench"}} {
+    proc format_command {args} {
+        set cmd "*[llength $args]\r\n"
+        foreach a $args {
+            append cmd "$[string length $a]\r\n$a\r\n"
+        }
+        set _ $cmd
+    }
+
+    test {GEORADIUS COUNT 10 on a large geoset} {
+        if {$::accurate} {set points 10000000} else {set points 1000000}
+        r del bigpoints
+        set batches 0
+        for {set j 0} {$j < $points} {incr j 1000} {
+            set args {}
+            for {set k $j} {$k < $j + 1000} {incr k} {
+                lappend args [expr {100 + rand()*20}] [expr {20 + rand()*20}] p$k
+            }
+            r write [format_command geoadd bigpoints {*}$args]
+            incr batches
+            # keep a bounded number of replies in flight
+            if {$batches == 100} {
+                r flush
+                for {set b 0} {$b < $batches} {incr b} {
+                    r read
+                }
+                set batches 0
+            }
+        }
+        r flush
+        for {set b 0} {$b < $batches} {incr b} {
+            r read
+        }
+        foreach km {1 10 100} {
+            set start [clock milliseconds]
+            set in_radius [llength [r georadius bigpoints 110 30 $km km ASC]]
+            set full [expr {[clock milliseconds] - $start}]
+            set start [clock milliseconds]
+            for {set j 0} {$j < 20} {incr j} {
+                r georadius bigpoints 110 30 $km km COUNT 10 ASC
+            }
+            set elapsed [expr {[clock milliseconds] - $start}]
+            puts "GEORADIUS $km km over $points points, $in_radius in radius:\
+                  [expr {$elapsed / 20.0}] ms with COUNT 10 ASC, $full ms without"
+        }
+    }
+}
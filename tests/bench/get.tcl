@@ -0,0 +1,28 @@
+# GET scaling benchmark, run it with ./pikabench.sh get
+start_server {tags {"bench"}} {
+    test {GET throughput from 1 to 8 concurrent clients} {
+        if {$::accurate} {set per_client 50000} else {set per_client 5000}
+        r set scaling:key bar
+        foreach clients {1 2 4 8} {
+            set rds {}
+            for {set i 0} {$i < $clients} {incr i} {
+                lappend rds [redis_deferring_client]
+            }
+            set start [clock milliseconds]
+            # every client pipelines its GETs so the worker threads overlap
+            foreach rd $rds {
+                for {set j 0} {$j < $per_client} {incr j} {
+                    $rd get scaling:key
+                }
+            }
+            foreach rd $rds {
+                for {set j 0} {$j < $per_client} {incr j} {
+                    $rd read
+                }
+                $rd close
+            }
+            set elapsed [expr {max([clock milliseconds] - $start, 1)}]
+            puts "GET from $clients clients: [expr {$clients * $per_client * 1000 / $elapsed}] ops/s"
+        }
+    }
+}
@@ -0,0 +1,28 @@
+# PFCOUNT benchmark, run it with ./pikabench.sh hyperloglog
+start_server {tags {"bench"}} {
+    test {PFCOUNT of 1, 10 and 100 keys} {
+        set keys {}
+        for {set j 0} {$j < 100} {incr j} {
+            set args {}
+            for {set k 0} {$k < 1000} {incr k} {
+                lappend args "$j-$k"
+            }
+            r pfadd pfbench$j {*}$args
+            lappend keys pfbench$j
+        }
+        if {$::accurate} {set num_counts 10000} else {set num_counts 1000}
+        foreach num {1 10 100} {
+            set args [lrange $keys 0 [expr {$num - 1}]]
+            # a write between the counts makes every count miss the cache
+            foreach {name write} {cached 0 uncached 1} {
+                set start [clock milliseconds]
+                for {set j 0} {$j < $num_counts} {incr j} {
+                    if {$write} {r pfadd pfbench0 "miss-$j"}
+                    r pfcount {*}$args
+                }
+                set elapsed [expr {[clock milliseconds] - $start}]
+                puts "PFCOUNT of $num keys, $name: [expr {$elapsed * 1000.0 / $num_counts}] us"
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+# Replication benchmark, run it with ./pikabench.sh replication
+start_server {tags {"bench"}} {
+    start_server {} {
+        set master [srv -1 client]
+        set master_host [srv -1 host]
+        set master_port [srv -1 port]
+        set slave [srv 0 client]
+
+        test {Slave catch-up rate of a pipelined write burst} {
+            $slave slaveof $master_host $master_port
+            wait_for_condition 50 100 {
+                [string match {*master_link_status:up*} [$slave info replication]]
+            } else {
+                fail "Can't turn the instance into a slave"
+            }
+
+            if {$::accurate} {set num 2000000} else {set num 200000}
+            foreach type {set hset} {
+                set rd [redis_deferring_client -1]
+                set start [clock milliseconds]
+                # distinct keys or fields so the slave combines them
+                for {set j 0} {$j < $num} {incr j} {
+                    if {$type eq {set}} {
+                        $rd set "catchup:$j" $j
+                    } else {
+                        $rd hset catchup:hash "f$j" $j
+                    }
+                }
+                for {set j 0} {$j < $num} {incr j} {
+                    $rd read
+                }
+                set written [expr {[clock milliseconds] - $start}]
+                set last [expr {$num - 1}]
+                wait_for_condition 6000 10 {
+                    ($type eq {set} && [$slave get "catchup:$last"] eq $last) ||
+                    ($type eq {hset} && [$slave hget catchup:hash "f$last"] eq $last)
+                } else {
+                    fail "Slave did not catch up with the write burst"
+                }
+                set elapsed [expr {max([clock milliseconds] - $start, 1)}]
+                $rd close
+                puts "[string toupper $type] x $num: master took $written ms, slave caught up in $elapsed ms ([expr {$num * 1000 / $elapsed}] ops/s)"
+            }
+        }
+    }
+}
@@ -0,0 +1,49 @@
+# Multi-key command split benchmark, run it with ./pikabench.sh split
+proc bench_split {mode} {
+    if {$::accurate} {set num 100000} else {set num 10000}
+    foreach nkeys {1 10 100} {
+        set keys {}
+        set pairs {}
+        for {set j 0} {$j < $nkeys} {incr j} {
+            lappend keys split:$j
+            lappend pairs split:$j $j
+        }
+        foreach cmd [list [list mset {*}$pairs] [list mget {*}$keys] \\
+                          [list exists {*}$keys] [list del {*}$keys]] {
+            set start [clock milliseconds]
+            for {set j 0} {$j < $num} {incr j} {
+                r write [format_command {*}$cmd]
+            }
+            r flush
+            for {set j 0} {$j < $num} {incr j} {
+                r read
+            }
+            set elapsed [expr {max([clock milliseconds] - $start, 1)}]
+            puts "$mode [lindex $cmd 0] of $nkeys keys: [expr {$num * 1000 / $elapsed}] ops/s"
+        }
+    }
+}
+
+proc format_command {args} {
+    set cmd "*[llength $args]\r\n"
+    foreach a $args {
+        append cmd "$[string length $a]\r\n$a\r\n"
+    }
+    set _ $cmd
+}
+
+start_server {tags {"bench"}} {
+    test {Multi-key commands on a single partition} {
+        bench_split classic
+    }
+}
+
+set sharding_overrides {instance-mode {: sharding} default-slot-num {: 16}}
+
+start_server [list tags {"bench"} overrides $sharding_overrides] {
+    r pkcluster addslots 0-15
+
+    test {Multi-key commands split across 16 partitions} {
+        bench_split sharding
+    }
+}
@@ -0,0 +1,31 @@
+# ZRANGEBYSCORE LIMIT benchmark, run it with ./pikabench.sh zset
+start_server {tags {"bench"}} {
+    test {ZRANGEBYSCORE LIMIT 0 10 over a large sorted set} {
+        if {$::accurate} {set size 1000000} else {set size 100000}
+        r del zset zlex
+        for {set j 0} {$j < $size} {incr j 1000} {
+            set args {}
+            set lexargs {}
+            for {set k $j} {$k < $j + 1000} {incr k} {
+                lappend args $k m$k
+                lappend lexargs 0 [format "m%08d" $k]
+            }
+            r zadd zset {*}$args
+            r zadd zlex {*}$lexargs
+        }
+        set mid [expr {$size / 2}]
+        foreach {name cmd} [list \
+            "from -inf" [list zrangebyscore zset -inf +inf LIMIT 0 10] \
+            "from a bounded min" [list zrangebyscore zset $mid $size LIMIT 0 10] \
+            "from a bounded min to +inf" [list zrangebyscore zset $mid +inf LIMIT 0 10] \
+            "from a bounded max, reversed" [list zrevrangebyscore zset $mid 0 LIMIT 0 10] \
+            "by lex from -" [list zrangebylex zlex - + LIMIT 0 10]] {
+            set start [clock milliseconds]
+            for {set j 0} {$j < 100} {incr j} {
+                r {*}$cmd
+            }
+            set elapsed [expr {[clock milliseconds] - $start}]
+            puts "100 x LIMIT 0 10 over $size members $name: $elapsed ms"
+        }
+    }
+}
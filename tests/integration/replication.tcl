@@ -213,3 +213,50 @@ foreach dl {no yes} {
         }
     }
 }
+
+start_server {tags {"repl"}} {
+    start_server {} {
+        set master [srv -1 client]
+        set master_host [srv -1 host]
+        set master_port [srv -1 port]
+        set slave [srv 0 client]
+
+        test {Slave applies a pipelined SET/HSET burst and logs it} {
+            $slave slaveof $master_host $master_port
+            wait_for_condition 50 100 {
+                [string match {*master_link_status:up*} [$slave info replication]]
+            } else {
+                fail "Can't turn the instance into a slave"
+            }
+            $slave config set slowlog-log-slower-than 0
+            $slave config set slowlog-max-len 10000
+            $slave slowlog reset
+
+            # distinct keys and fields, which the slave combines into batches
+            set num 2000
+            set rd [redis_deferring_client -1]
+            for {set j 0} {$j < $num} {incr j} {
+                $rd set "catchup:$j" $j
+                $rd hset catchup:hash "f$j" $j
+            }
+            for {set j 0} {$j < $num * 2} {incr j} {
+                $rd read
+            }
+            $rd close
+            wait_for_condition 500 10 {
+                [$slave hget catchup:hash "f[expr {$num - 1}]"] eq [expr {$num - 1}] &&
+                [$slave get "catchup:[expr {$num - 1}]"] eq [expr {$num - 1}]
+            } else {
+                fail "Slave did not catch up with the write burst"
+            }
+            set logged {}
+            foreach entry [$slave slowlog get 10000] {
+                lappend logged [string tolower [lindex [lindex $entry 3] 0]]
+            }
+            $slave config set slowlog-log-slower-than 10000
+            $slave config set slowlog-max-len 128
+            list [$slave get catchup:0] [$slave hlen catchup:hash] \
+                 [expr {[lsearch $logged set] >= 0 || [lsearch $logged hset] >= 0}]
+        } {0 2000 1}
+    }
+}
@@ -0,0 +1,73 @@
+set sharding_overrides {instance-mode {: sharding} default-slot-num {: 16}}
+
+start_server [list tags {"sharding"} overrides $sharding_overrides] {
+    r pkcluster addslots 0-15
+
+    set keys {}
+    set slots {}
+    for {set j 0} {$j < 8} {incr j} {
+        lappend keys split:$j
+        lappend slots [lindex [r slotshashkey split:$j] 0]
+    }
+
+    test {Multi-key commands span several partitions} {
+        expr {[llength [lsort -unique $slots]] > 1}
+    } {1}
+
+    test {MSET and MGET split across partitions keep the request order} {
+        set args {}
+        foreach key $keys {
+            lappend args $key "v:$key"
+        }
+        r mset {*}$args
+        r mget {*}$keys split:none
+    } {v:split:0 v:split:1 v:split:2 v:split:3 v:split:4 v:split:5 v:split:6 v:split:7 {}}
+
+    test {EXISTS split across partitions counts every partition} {
+        r exists {*}$keys split:none
+    } {8}
+
+    test {DEL split across partitions deletes on every partition} {
+        set deleted [r del {*}[lrange $keys 0 3] split:none]
+        list $deleted [r mget {*}$keys]
+    } {4 {{} {} {} {} v:split:4 v:split:5 v:split:6 v:split:7}}
+
+    test {CONFIG SET keyscan-concurrency is bounded} {
+        set aux {}
+        catch {r config set keyscan-concurrency 0} e
+        lappend aux [string match {*ERR*} $e]
+        catch {r config set keyscan-concurrency 65} e
+        lappend aux [string match {*ERR*} $e]
+        catch {r config set keyscan-bytes-per-sec -1} e
+        lappend aux [string match {*ERR*} $e]
+        r config set keyscan-concurrency 4
+        r config set keyscan-bytes-per-sec 1048576
+        lappend aux [lindex [r config get keyscan-concurrency] 1]
+        lappend aux [lindex [r config get keyscan-bytes-per-sec] 1]
+    } {1 1 1 4 1048576}
+
+    test {INFO KEYSPACE 1 counts the keys of every partition in parallel} {
+        r hset split:hash f v
+        r info keyspace 1
+        wait_for_condition 50 100 {
+            [regexp {# Duration: \d+s} [r info keyspace]]
+        } else {
+            fail "Key scan did not finish"
+        }
+        set info [r info keyspace]
+        r config set keyscan-concurrency 1
+        r config set keyscan-bytes-per-sec 0
+        list [regexp {db0 Strings_keys=4,} $info] [regexp {db0 Hashes_keys=1,} $info]
+    } {1 1}
+
+    test {INFO KEYSPACE approx estimates the keys without a scan} {
+        for {set j 0} {$j < 100} {incr j} {
+            r set approx:$j $j
+        }
+        set info [r info keyspace approx]
+        assert_match {*Approximate*} $info
+        assert {[regexp {db0 Strings_keys=(\d+)} $info -> strings]}
+        assert {[regexp {db0 Sets_keys=\d+} $info]}
+        expr {$strings >= 100}
+    } {1}
+}
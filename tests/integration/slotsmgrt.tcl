@@ -0,0 +1,81 @@
+set sharding_overrides {instance-mode {: sharding} default-slot-num {: 16}}
+
+start_server [list tags {"slotsmgrt"} overrides $sharding_overrides] {
+    start_server [list overrides $sharding_overrides] {
+        set src_host [srv -1 host]
+        set dst_host [srv 0 host]
+        set dst_port [srv 0 port]
+        r -1 pkcluster addslots 0-15
+        r pkcluster addslots 0-15
+
+        test {SLOTSMGRTONE moves one key of each type} {
+            r -1 set mgrt:str foo
+            r -1 expire mgrt:str 1000
+            r -1 hmset mgrt:hash f1 v1 f2 v2
+            r -1 rpush mgrt:list a b c
+            r -1 sadd mgrt:set x y
+            r -1 zadd mgrt:zset 1.5 m1 2 m2
+            foreach key {mgrt:str mgrt:hash mgrt:list mgrt:set mgrt:zset} {
+                assert_equal 1 [r -1 slotsmgrtone $dst_host $dst_port 1000 $key]
+                assert_equal 0 [r -1 exists $key]
+            }
+            assert_equal 0 [r -1 slotsmgrtone $dst_host $dst_port 1000 mgrt:none]
+            list [r get mgrt:str] [expr {[r ttl mgrt:str] > 0}] \
+                 [lsort [r hgetall mgrt:hash]] [r lrange mgrt:list 0 -1] \
+                 [lsort [r smembers mgrt:set]] [r zrange mgrt:zset 0 -1 withscores]
+        } {foo 1 {f1 f2 v1 v2} {a b c} {x y} {m1 1.5 m2 2}}
+
+        test {SLOTSMGRT-EXEC-WRAPPER sends the proxy to the destination once the key left} {
+            r -1 set mgrt:wrapped bar
+            set here [r -1 slotsmgrt-exec-wrapper mgrt:wrapped get mgrt:wrapped]
+            r -1 slotsmgrtone $dst_host $dst_port 1000 mgrt:wrapped
+            # the error element of the reply is raised by the client
+            catch {r -1 slotsmgrt-exec-wrapper mgrt:wrapped get mgrt:wrapped} gone
+            assert_match {*doesn't exist*} $gone
+            set here
+        } {2 bar}
+
+        test {SLOTSMGRTSLOT-ASYNC moves the whole slot and reports throughput} {
+            set slot [lindex [r -1 slotshashkey mgrt:key:0] 0]
+            set numkeys 0
+            set hkeys {}
+            for {set j 0} {$j < 20000} {incr j} {
+                set key mgrt:key:$j
+                if {[lindex [r -1 slotshashkey $key] 0] == $slot} {
+                    r -1 set $key $j
+                    incr numkeys
+                }
+                set hkey mgrt:hkey:$j
+                if {[lindex [r -1 slotshashkey $hkey] 0] == $slot} {
+                    r -1 hset $hkey f $j
+                    lappend hkeys $j
+                    incr numkeys
+                }
+            }
+
+            set start [clock milliseconds]
+            r -1 slotsmgrtslot-async $dst_host $dst_port 5000 200 1048576 $slot 500
+            wait_for_condition 600 100 {
+                [lindex [r -1 slotsmgrtslot-async $dst_host $dst_port 5000 200 1048576 $slot 500] 1] == 0
+            } else {
+                fail "Slot $slot was not migrated: [r -1 slotsmgrt-async-status]"
+            }
+            set elapsed [expr {max([clock milliseconds] - $start, 1)}]
+            set status [r -1 slotsmgrt-async-status]
+            puts "Migrated $numkeys keys in $elapsed ms, [expr {$numkeys * 1000 / $elapsed}] keys/s"
+            puts [join $status "\n"]
+
+            assert_equal {last error : none} [lindex $status end]
+            assert_equal 0 [llength [lindex [r -1 slotsscan $slot 0 count 100] 1]]
+            for {set j 0} {$j < 20000} {incr j 97} {
+                set key mgrt:key:$j
+                if {[lindex [r -1 slotshashkey $key] 0] != $slot} continue
+                assert_equal $j [r get $key]
+            }
+            assert {[llength $hkeys] > 0}
+            foreach j $hkeys {
+                assert_equal $j [r hget mgrt:hkey:$j f]
+            }
+        }
+    }
+}
@@ -37,6 +37,8 @@ set ::all_tests {
     integration/aof
     integration/rdb
     integration/convert-zipmap-hash-on-load
+    integration/slotsmgrt
+    integration/sharding
     unit/pubsub
     unit/slowlog
     unit/scripting
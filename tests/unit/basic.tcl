@@ -780,4 +780,26 @@ start_server {tags {"basic"}} {
         r set foo bar
         r getrange foo 0 4294967297
     } {bar}
+
+    test {GET from 8 concurrent clients reads the same value} {
+        r set scaling:key bar
+        set rds {}
+        for {set i 0} {$i < 8} {incr i} {
+            lappend rds [redis_deferring_client]
+        }
+        # every client pipelines its GETs so the worker threads overlap
+        foreach rd $rds {
+            for {set j 0} {$j < 100} {incr j} {
+                $rd get scaling:key
+            }
+        }
+        set wrong 0
+        foreach rd $rds {
+            for {set j 0} {$j < 100} {incr j} {
+                if {[$rd read] ne {bar}} {incr wrong}
+            }
+            $rd close
+        }
+        set wrong
+    } {0}
 }
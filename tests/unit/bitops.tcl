@@ -338,4 +338,82 @@ start_server {tags {"bitops"}} {
             }
         }
     }
+
+    test {BITCOUNT, BITPOS and BITOP on large bitmaps} {
+        set sizes {1024 1048576}
+        if {$::accurate} {lappend sizes 67108864}
+        foreach size $sizes {
+            r del big1 big2 big3
+            r setrange big1 [expr {$size - 1}] "\x01"
+            r setrange big2 [expr {$size - 1}] "\x03"
+            r setrange big3 [expr {$size / 2}] "\xff"
+            assert_equal 1 [r bitcount big1]
+            assert_equal [expr {$size * 8 - 1}] [r bitpos big1 1]
+            assert_equal [expr {$size / 2 * 8}] [r bitpos big3 1]
+            r bitop or dest big1 big2 big3
+            assert_equal 10 [r bitcount dest]
+            r bitop and dest big1 big2 big3
+            assert_equal 0 [r bitcount dest]
+            r bitop and dest big1 big2
+            assert_equal 1 [r bitcount dest]
+        }
+        r del big1 big2 big3 dest
+    }
+
+    test {CONFIG SET bitops-kernel rejects unknown kernels} {
+        catch {r config set bitops-kernel avx512} e
+        set e
+    } {*ERR*Invalid argument*}
+
+    test {Every bitops kernel matches the scalar one on random lengths} {
+        # lengths around the 16 and 32 byte vectors and their unrolled
+        # loops, so every kernel also runs its unaligned tails
+        set lengths {0 1 7 8 15 16 17 31 32 33 63 64 65 127 128 129 255 256 257}
+        for {set j 0} {$j < 30} {incr j} {
+            lappend lengths [randomInt 4096]
+        }
+        set cmds {}
+        foreach len $lengths {
+            set a [randstring $len $len binary]
+            set b [randstring $len $len binary]
+            set c [randstring [randomInt 300] 300 binary]
+            # long runs of 0x00 and 0xff before a single flipped bit
+            set zeros [string repeat "\x00" $len]\x10
+            set ones [string repeat "\xff" $len]\xef
+            set start [randomInt [expr {$len + 1}]]
+            set end [expr {$start + [randomInt [expr {$len + 1}]]}]
+            lappend cmds [list set a $a] [list set b $b] [list set c $c] \
+                [list set zeros $zeros] [list set ones $ones] \
+                [list bitcount a] [list bitcount a $start $end] \
+                [list bitcount a -[expr {$end + 1}] -1] [list bitcount ones 1 -1] \
+                [list bitpos a 1] [list bitpos a 0 $start] \
+                [list bitpos zeros 1] [list bitpos zeros 1 $start] \
+                [list bitpos ones 0] [list bitpos ones 0 $start $end] \
+                [list bitop and dest a b c] [list get dest] \
+                [list bitop or dest a b c] [list get dest] \
+                [list bitop xor dest a b c] [list get dest] \
+                [list bitop not dest a] [list get dest] \
+                [list bitop not dest zeros] [list bitcount dest]
+        }
+        set kernels 0
+        foreach kernel {scalar sse4.2 avx2} {
+            if {[catch {r config set bitops-kernel $kernel} e]} {
+                assert_match {*not supported*} $e
+                continue
+            }
+            incr kernels
+            set res {}
+            foreach cmd $cmds {
+                lappend res [r {*}$cmd]
+            }
+            if {$kernel eq {scalar}} {
+                set expected $res
+            } elseif {$res ne $expected} {
+                fail "$kernel kernel differs from the scalar one"
+            }
+        }
+        r config set bitops-kernel auto
+        r del a b c zeros ones dest
+        expr {$kernels >= 1}
+    } {1}
 }
@@ -223,6 +223,25 @@ start_server {tags {"geo"}} {
         assert {[lindex $res 0] eq "Catania"}
     }
 
+    test {GEORADIUS COUNT on a large geoset} {
+        if {$::accurate} {set points 100000} else {set points 10000}
+        r del bigpoints
+        for {set j 0} {$j < $points} {incr j 1000} {
+            set args {}
+            for {set k $j} {$k < $j + 1000} {incr k} {
+                lappend args [expr {100 + rand()*20}] [expr {20 + rand()*20}] p$k
+            }
+            r geoadd bigpoints {*}$args
+        }
+        foreach km {1 10 100} {
+            set all [r georadius bigpoints 110 30 $km km ASC]
+            assert_equal [lrange $all 0 9] [r georadius bigpoints 110 30 $km km COUNT 10 ASC]
+            assert_equal [lrange [lreverse $all] 0 9] [r georadius bigpoints 110 30 $km km COUNT 10 DESC]
+            assert_equal [expr {min(10, [llength $all])}] \
+                [llength [r georadius bigpoints 110 30 $km km COUNT 10]]
+        }
+    }
+
     test {GEOADD + GEORANGE randomized test} {
         set attempt 30
         while {[incr attempt -1]} {
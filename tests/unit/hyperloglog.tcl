@@ -151,6 +151,58 @@ start_server {tags {"hll"}} {
         }
     }
 
+    test {PFCOUNT cached cardinality follows writes of any kind} {
+        r del hll hll1
+        r pfadd hll a b c
+        r pfadd hll1 a b c d e f g
+        assert_equal 3 [r pfcount hll]
+        assert_equal 3 [r pfcount hll]
+        r pfadd hll d
+        assert_equal 4 [r pfcount hll]
+        r set hll [r get hll1]
+        assert_equal 7 [r pfcount hll]
+        assert_equal 7 [r pfcount hll hll1]
+        r pfadd hll1 h
+        assert_equal 8 [r pfcount hll hll1]
+        r del hll
+        assert_equal 0 [r pfcount hll]
+        r pfmerge hll hll1
+        assert_equal 8 [r pfcount hll]
+    }
+
+    test {PFCOUNT after DEL of keys whose miss was counted} {
+        r del hll hll2
+        r pfadd hll a b c
+        set res {}
+        lappend res [r pfcount hll2] [r pfcount hll hll2]
+        r pfadd hll2 d e
+        lappend res [r pfcount hll2] [r pfcount hll hll2]
+        r del hll2
+        lappend res [r pfcount hll2] [r pfcount hll hll2]
+        r del hll
+        lappend res [r pfcount hll] [r pfcount hll hll2]
+    } {0 3 2 5 0 3 0 0}
+
+    test {PFCOUNT of 1, 10 and 100 keys} {
+        set keys {}
+        for {set j 0} {$j < 100} {incr j} {
+            r del pfkeys$j
+            set args {}
+            for {set k 0} {$k < 1000} {incr k} {
+                lappend args "$j-$k"
+            }
+            r pfadd pfkeys$j {*}$args
+            lappend keys pfkeys$j
+        }
+        foreach num {1 10 100} {
+            set card [r pfcount {*}[lrange $keys 0 [expr {$num - 1}]]]
+            set err [expr {abs($card - $num * 1000)}]
+            assert {$err < (double($card)/100)*5}
+            # the second count is served from the cache
+            assert_equal $card [r pfcount {*}[lrange $keys 0 [expr {$num - 1}]]]
+        }
+    }
+
     test {HYPERLOGLOG press test: 5w, 10w, 15w, 20w, 30w, 50w, 100w} {
         r del hll1
         for {set x 1} {$x <= 1000000} {incr x} {
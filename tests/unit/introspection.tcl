@@ -56,4 +56,10 @@ start_server {tags {"introspection"}} {
             fail "Client still listed in CLIENT LIST after SETNAME."
         }
     }
+
+    test {INFO commandstats counts executed commands} {
+        r set foo bar
+        r set foo bar
+        r info commandstats
+    } {*cmdstat_set:calls=*,usec=*,usec_per_call=*}
 }
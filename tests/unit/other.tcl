@@ -227,6 +227,115 @@ start_server {tags {"other"}} {
         set _ $err
     } {}
 
+    test {CONFIG SET/GET binlog-group-commit} {
+        set aux {}
+        r config set binlog-group-commit yes
+        lappend aux [lindex [r config get binlog-group-commit] 1]
+        r config set binlog-group-commit no
+        lappend aux [lindex [r config get binlog-group-commit] 1]
+        catch {r config set binlog-group-commit maybe} e
+        lappend aux [string match {*ERR*} $e]
+    } {yes no 1}
+
+    test {Writes of concurrent clients are all applied with binlog-group-commit} {
+        set clients 8
+        set num 100
+        r config set binlog-group-commit yes
+        set rds {}
+        for {set i 0} {$i < $clients} {incr i} {
+            lappend rds [redis_deferring_client]
+        }
+        # every client pipelines its writes so they join the same groups
+        set i 0
+        foreach rd $rds {
+            for {set j 0} {$j < $num} {incr j} {
+                $rd set "group:$i:$j" $j
+            }
+            incr i
+        }
+        foreach rd $rds {
+            for {set j 0} {$j < $num} {incr j} {
+                assert_equal OK [$rd read]
+            }
+            $rd close
+        }
+        r config set binlog-group-commit no
+        set missing 0
+        for {set i 0} {$i < $clients} {incr i} {
+            for {set j 0} {$j < $num} {incr j} {
+                if {[r get "group:$i:$j"] ne $j} {incr missing}
+            }
+        }
+        set missing
+    } {0}
+
+    test {Writes of every argv shape are applied} {
+        set mset {}
+        for {set j 0} {$j < 50} {incr j} {
+            lappend mset "enc:mset:$j" [string repeat x 16]
+        }
+        r set enc:small foo
+        r mset {*}$mset
+        r hset enc:hash field [string repeat v 64]
+        r zadd enc:zset 1.5 m1 2 m2
+        r set enc:large [string repeat x 65536]
+        list [r get enc:small] [r get enc:mset:49] [string length [r hget enc:hash field]] \
+             [r zrange enc:zset 0 -1 withscores] [string length [r get enc:large]]
+    } [list foo [string repeat x 16] 64 {m1 1.5 m2 2} 65536]
+
+    test {Streamed replies are complete and keep the pipeline order} {
+        r flushdb
+        r config set reply-stream-budget 1024
+        for {set j 0} {$j < 1000} {incr j} {
+            r rpush stream:list $j
+            r hset stream:hash f$j $j
+            r sadd stream:set $j
+            r zadd stream:zset $j m$j
+        }
+        set rd [redis_deferring_client]
+        $rd keys stream:*
+        $rd lrange stream:list 0 -1
+        $rd hgetall stream:hash
+        $rd smembers stream:set
+        $rd zrange stream:zset 0 -1 withscores
+        $rd ping
+        set res {}
+        lappend res [llength [$rd read]]
+        lappend res [lindex [$rd read] 999]
+        lappend res [llength [$rd read]]
+        lappend res [llength [$rd read]]
+        lappend res [lrange [$rd read] end-1 end]
+        lappend res [$rd read]
+        $rd close
+        r config set reply-stream-budget 1048576
+        set res
+    } {4 999 2000 1000 {m999 999} PONG}
+
+    test {A client not reading its streamed reply does not stall FLUSHDB} {
+        r flushdb
+        r config set reply-stream-budget 1024
+        # far more than the socket buffers can hold
+        set prefix [string repeat x 100]
+        for {set j 0} {$j < 100000} {incr j 1000} {
+            set args {}
+            for {set k $j} {$k < $j + 1000} {incr k} {
+                lappend args $prefix:$k 1
+            }
+            r mset {*}$args
+        }
+        set rd [redis_deferring_client]
+        $rd keys *
+        # the reply is stuck in the socket while FLUSHDB takes the db lock
+        after 500
+        set start [clock milliseconds]
+        r flushdb
+        set elapsed [expr {[clock milliseconds] - $start}]
+        set keys [llength [$rd read]]
+        $rd close
+        r config set reply-stream-budget 1048576
+        list [expr {$elapsed < 5000}] $keys [r exists $prefix:0]
+    } {1 100000 0}
+
     # Leave the user with a clean DB before to exit
     test {FLUSHDB} {
         set aux {}
@@ -114,4 +114,34 @@ start_server {tags {"regression"}} {
         $rd rpush nolist a
         $rd read
     }
+
+    proc format_command {args} {
+        set cmd "*[llength $args]\r\n"
+        foreach a $args {
+            append cmd "$[string length $a]\r\n$a\r\n"
+        }
+        set _ $cmd
+    }
+
+    test "Pipelined commands in any case reuse pooled commands correctly" {
+        reconnect
+        r set dispatch:a 1
+        r set dispatch:b 2
+        set cmds {{GET dispatch:a} {get dispatch:b} {GeT dispatch:none} {ExIsTs dispatch:a dispatch:b} PING}
+        for {set j 0} {$j < 100} {incr j} {
+            foreach cmd $cmds {
+                r write [format_command {*}$cmd]
+            }
+        }
+        r flush
+        set wrong 0
+        for {set j 0} {$j < 100} {incr j} {
+            set replies {}
+            foreach cmd $cmds {
+                lappend replies [r read]
+            }
+            if {$replies ne {1 2 {} 2 PONG}} {incr wrong}
+        }
+        set wrong
+    } {0}
 }
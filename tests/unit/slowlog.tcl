@@ -20,6 +20,41 @@ start_server {tags {"slowlog"} overrides {slowlog-log-slower-than 1000000}} {
         r slowlog len
     } {10}
 
+    test {SLOWLOG - entries dropped by a shrink stay dropped after growing} {
+        r config set slowlog-log-slower-than 100000
+        r config set slowlog-max-len 4
+        set aux [r slowlog len]
+        r config set slowlog-max-len 10
+        lappend aux [r slowlog len]
+        r config set slowlog-log-slower-than 0
+        for {set i 0} {$i < 100} {incr i} {
+            r ping
+        }
+        lappend aux [r slowlog len]
+    } {4 4 10}
+
+    test {SLOWLOG - shrinking the ring keeps the newest entries} {
+        r config set slowlog-max-len 1000
+        for {set i 0} {$i < 600} {incr i} {
+            r set slowlog:shrink $i
+        }
+        r config set slowlog-max-len 3
+        set e [r slowlog get 3]
+        list [llength $e] [lindex $e 1 3] [lindex $e 2 3]
+    } {3 {set slowlog:shrink 599} {set slowlog:shrink 598}}
+
+    test {SLOWLOG - slowlog-max-len is bounded} {
+        set aux {}
+        catch {r config set slowlog-max-len 1048577} e
+        lappend aux [string match {*ERR*} $e]
+        catch {r config set slowlog-max-len 9999999999999} e
+        lappend aux [string match {*ERR*} $e]
+        r config set slowlog-max-len 1048576
+        lappend aux [lindex [r config get slowlog-max-len] 1]
+        r config set slowlog-max-len 10
+        set aux
+    } {1 1 1048576}
+
     test {SLOWLOG - GET optional argument to limit output len works} {
         llength [r slowlog get 5]
     } {5}
@@ -56,6 +91,16 @@ start_server {tags {"slowlog"} overrides {slowlog-log-slower-than 1000000}} {
         lindex $e 3
     } {sadd set foo {AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA... (1 more bytes)}}
 
+    test {SLOWLOG - slowlog-max-arg-len limits the copied bytes} {
+        r config set slowlog-log-slower-than 0
+        r config set slowlog-max-arg-len 4
+        r slowlog reset
+        r sadd set foobar
+        set e [lindex [r slowlog get] 0]
+        r config set slowlog-max-arg-len 128
+        lindex $e 3
+    } {sadd set {foob... (2 more bytes)}}
+
     test {SLOWLOG - EXEC is not logged, just executed commands} {
         r config set slowlog-log-slower-than 100000
         r slowlog reset
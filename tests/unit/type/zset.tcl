@@ -852,6 +852,59 @@ start_server {tags {"zset"}} {
             }
         }
 
+        test "ZRANGEBYSCORE LIMIT windows of a large sorted set - $encoding" {
+            set size [expr {$elements * 100}]
+            r del zset
+            for {set j 0} {$j < $size} {incr j 100} {
+                set args {}
+                for {set k $j} {$k < $j + 100} {incr k} {
+                    lappend args $k m$k
+                }
+                r zadd zset {*}$args
+            }
+            set offset [expr {$size / 2}]
+            set max 9223372036854775807
+            # read as rank ranges from the first member
+            assert_equal [r zrange zset $offset [expr {$offset + 9}]] \
+                [r zrangebyscore zset -inf +inf LIMIT $offset 10]
+            assert_equal [r zrevrange zset $offset [expr {$offset + 9}]] \
+                [r zrevrangebyscore zset +inf -inf LIMIT $offset 10]
+            assert_equal {m0 m1} [r zrangebyscore zset -inf (2 LIMIT 0 10]
+            assert_equal [list m[expr {$size - 1}]] [r zrevrangebyscore zset +inf [expr {$size - 1}] LIMIT 0 10]
+            assert_equal {m1 m2} [r zrangebyscore zset -inf 2 LIMIT 1 $max]
+            # probed from a bounded start
+            assert_equal [lrange [r zrangebyscore zset 100 200] 5 14] \
+                [r zrangebyscore zset 100 200 LIMIT 5 10]
+            assert_equal [lrange [r zrevrangebyscore zset 200 (100] 5 14] \
+                [r zrevrangebyscore zset 200 (100 LIMIT 5 10]
+            assert_equal {m101 m102 m103} [r zrangebyscore zset (100 +inf LIMIT 0 3]
+            assert_equal {m99 m98 m97} [r zrevrangebyscore zset (100 -inf LIMIT 0 3]
+            assert_equal {m1 m2 m3} [r zrangebyscore zset 0.5 +inf LIMIT 0 3]
+            assert_equal {m199 m200} [r zrangebyscore zset 198 200 LIMIT 1 $max]
+            assert_equal {} [r zrangebyscore zset 198 200 LIMIT 3 10]
+            assert_equal [lrange [r zrangebyscore zset 100 2000] 1000 1099] \
+                [r zrangebyscore zset 100 2000 LIMIT 1000 100]
+        }
+
+        # LIMIT of ZRANGEBYLEX still applies after reading the whole lex range
+        test "ZRANGEBYLEX LIMIT windows of a large sorted set - $encoding" {
+            set size [expr {$elements * 100}]
+            r del zlex
+            for {set j 0} {$j < $size} {incr j 100} {
+                set lexargs {}
+                for {set k $j} {$k < $j + 100} {incr k} {
+                    lappend lexargs 0 [format "m%08d" $k]
+                }
+                r zadd zlex {*}$lexargs
+            }
+            set offset [expr {$size / 2}]
+            assert_equal [r zrange zlex $offset [expr {$offset + 9}]] \
+                [r zrangebylex zlex - + LIMIT $offset 10]
+            assert_equal [r zrevrange zlex $offset [expr {$offset + 9}]] \
+                [r zrevrangebylex zlex + - LIMIT $offset 10]
+            assert_equal {m00000000 m00000001} [r zrangebylex zlex - (m00000002 LIMIT 0 10]
+        }
+
         test "ZREMRANGEBYLEX fuzzy test, 100 ranges in $elements element sorted set - $encoding" {
             set lexset {}
             r del zset zsetcopy
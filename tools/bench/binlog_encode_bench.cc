@@ -0,0 +1,100 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+/*
+ * Allocations and ns per op of encoding a command binlog item, the one
+ * pass BinlogEncodeArgv against the former content string + BinlogEncode.
+ *
+ *   make bench && ./tools/bench/binlog_encode_bench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "include/pika_binlog_transverter.h"
+#include "include/pika_command.h"
+
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+// Cmd::ToBinlog before BinlogEncodeArgv
+static std::string EncodeByContent(const std::vector<std::string>& argv) {
+  std::string content;
+  content.reserve(1024 * 1024);
+  RedisAppendLen(content, argv.size(), "*");
+  for (const auto& v : argv) {
+    RedisAppendLen(content, v.size(), "$");
+    RedisAppendContent(content, v);
+  }
+  return PikaBinlogTransverter::BinlogEncode(BinlogType::TypeFirst, 1, 1, 1, 1, 1, content, {});
+}
+
+static std::string EncodeByArgv(const std::vector<std::string>& argv) {
+  return PikaBinlogTransverter::BinlogEncodeArgv(BinlogType::TypeFirst, 1, 1, 1, 1, 1, argv);
+}
+
+static void Run(const char* shape, const std::vector<std::string>& argv, int iterations) {
+  if (EncodeByContent(argv) != EncodeByArgv(argv)) {
+    fprintf(stderr, "%s: the two encodings differ\n", shape);
+    exit(1);
+  }
+  struct {
+    const char* name;
+    std::string (*encode)(const std::vector<std::string>&);
+  } ways[] = {{"content", EncodeByContent}, {"argv", EncodeByArgv}};
+  for (const auto& way : ways) {
+    size_t bytes = 0;
+    uint64_t allocs = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+      bytes += way.encode(argv).size();
+    }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    allocs = allocations.load() - allocs;
+    printf("%-6s %-8s %10.1f ns/op %6.2f allocs/op %8zu bytes/op\n", shape, way.name,
+           static_cast<double>(ns) / iterations,
+           static_cast<double>(allocs) / iterations, bytes / iterations);
+  }
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+
+  std::vector<std::string> mset = {"mset"};
+  for (int i = 0; i < 50; i++) {
+    mset.push_back("key:" + std::to_string(i));
+    mset.push_back(std::string(16, 'x'));
+  }
+  std::vector<std::string> zadd = {"zadd", "zset"};
+  for (int i = 0; i < 10; i++) {
+    zadd.push_back(std::to_string(i * 1.5));
+    zadd.push_back("member:" + std::to_string(i));
+  }
+
+  Run("set", {"set", "key", "value"}, iterations);
+  Run("mset", mset, iterations);
+  Run("hset", {"hset", "hash", "field", std::string(64, 'v')}, iterations);
+  Run("zadd", zadd, iterations);
+  Run("large", {"set", "key", std::string(64 * 1024, 'v')}, iterations / 10);
+  return 0;
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+/*
+ * GB/s of the BITCOUNT, BITPOS and BITOP kernels of every bitmap kernel
+ * the CPU supports, on bitmaps of 1KB, 1MB and 64MB. An iteration is one
+ * pass over 1MB, smaller and larger bitmaps are passed over as many times
+ * as it takes to read the same bytes.
+ *
+ *   make bench && ./tools/bench/bitops_bench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+#include "include/pika_bitops.h"
+
+static const char* const kKernelNames[] = {"scalar", "sse4.2", "avx2"};
+
+template <typename Op>
+static double GBPerSec(size_t size, uint64_t passes, Op op) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < passes; i++) {
+    op();
+  }
+  std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+  return static_cast<double>(size) * passes / elapsed.count();
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t iterations = argc > 1 ? strtoull(argv[1], NULL, 10) : 1000;
+  const size_t sizes[] = {1 << 10, 1 << 20, 64 << 20};
+  printf("%-10s %-8s %10s %10s %10s %10s\n", "bytes", "kernel",
+         "BITCOUNT", "BITPOS", "BITOP AND", "BITOP NOT");
+  for (size_t size : sizes) {
+    std::string src(size, 0), dst(size, 0);
+    for (size_t i = 0; i < size; i++) {
+      src[i] = static_cast<char>(rand());
+    }
+    // the only set bit is the last one, so BITPOS scans the whole bitmap
+    std::string sparse(size, 0);
+    sparse[size - 1] = 1;
+    uint64_t passes = std::max<uint64_t>(1, iterations * (1 << 20) / size);
+
+    int64_t expect_count = -1;
+    for (int k = kBitmapKernelScalar; k <= kBitmapKernelAVX2; k++) {
+      if (!BitmapSetKernel(static_cast<BitmapKernel>(k))) {
+        printf("%-10lu %-8s not supported by this CPU\n", size, kKernelNames[k]);
+        continue;
+      }
+      int64_t count = BitmapPopcount(src.data(), size);
+      if (expect_count == -1) {
+        expect_count = count;
+      }
+      if (count != expect_count
+        || BitmapFirstBit(sparse.data(), size, 1) != static_cast<int64_t>(size * 8 - 1)) {
+        fprintf(stderr, "%s kernel differs from scalar\n", kKernelNames[k]);
+        exit(1);
+      }
+
+      volatile int64_t sink = 0;
+      double count_gbs = GBPerSec(size, passes, [&]() {
+        sink += BitmapPopcount(src.data(), size);
+      });
+      double pos_gbs = GBPerSec(size, passes, [&]() {
+        sink += BitmapFirstBit(sparse.data(), size, 1);
+      });
+      double and_gbs = GBPerSec(size, passes, [&]() {
+        BitmapAnd(&dst[0], src.data(), size);
+      });
+      double not_gbs = GBPerSec(size, passes, [&]() {
+        BitmapNot(&dst[0], src.data(), size);
+      });
+      printf("%-10lu %-8s %10.2f %10.2f %10.2f %10.2f\n", size, BitmapKernelName(),
+             count_gbs, pos_gbs, and_gbs, not_gbs);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,64 @@
+// Copyright (c) 2019-present, Qihoo, Inc.  All rights reserved.
+// This source code is licensed under the BSD-style license found in the
+// LICENSE file in the root directory of this source tree. An additional grant
+// of patent rights can be found in the PATENTS file in the same directory.
+
+/*
+ * ns per item of pushing binlog offsets to a full SyncWindow and acking
+ * them in order, for window sizes 9k (default), 90k and 900k (max),
+ * acking one item and one 40 item packet at a time.
+ *
+ *   make bench && ./tools/bench/sync_window_bench [iterations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "include/pika_sync_window.h"
+
+static double Bench(int window_size, int ack_batch, uint64_t iterations) {
+  SyncWindow win;
+  LatencyHistogram latency;
+  BinlogOffset acked;
+  uint64_t ack_latency = 0;
+  uint64_t pushed = 0, next_ack = 0;
+  while (win.Remainings(window_size) > 0) {
+    win.Push(SyncWinItem(0, pushed++));
+  }
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < iterations; i += ack_batch) {
+    win.Update(SyncWinItem(0, next_ack), SyncWinItem(0, next_ack + ack_batch - 1),
+               &acked, &ack_latency, &latency);
+    next_ack += ack_batch;
+    while (win.Remainings(window_size) > 0) {
+      win.Push(SyncWinItem(0, pushed++));
+    }
+  }
+  std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+  if (acked.offset != next_ack - 1) {
+    fprintf(stderr, "acked %lu, expect %lu\n", acked.offset, next_ack - 1);
+    exit(1);
+  }
+  return static_cast<double>(elapsed.count()) / next_ack;
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t iterations = argc > 1 ? strtoull(argv[1], NULL, 10) : 10000000;
+  const int windows[] = {9000, 90000, 900000};
+  const int batches[] = {1, 40};
+  printf("%-8s %-6s %12s %10s\n", "window", "batch", "ns/item", "ring KB");
+  for (int window : windows) {
+    for (int batch : batches) {
+      double ns = Bench(window, batch, iterations);
+      size_t ring = 1024;
+      while (ring < static_cast<size_t>(window)) {
+        ring *= 2;
+      }
+      printf("%-8d %-6d %12.1f %10lu\n", window, batch, ns,
+             ring * sizeof(SyncWinItem) >> 10);
+    }
+  }
+  return 0;
+}